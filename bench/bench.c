@@ -0,0 +1,620 @@
+/**
+ * @file bench.c
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan - Operating System Kernel
+ * Copyright (C) 2023-2025 awewsomegamer
+ *
+ * This file is part of Arctan.
+ *
+ * Arctan is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+ * Microbenchmarks of the VFS core, run hosted against the in-memory driver.
+ * Every scenario reports its throughput and the 99th percentile latency of a
+ * single operation.
+*/
+#include <bench.h>
+#include <fs/vfs.h>
+#include <fs/nsimage.h>
+#include <fs/tmpfs.h>
+#include <lib/perms.h>
+#include <abi-bits/fcntl.h>
+#include <mm/allocator.h>
+#include <global.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define BENCH_DEEP_LEVELS 16
+#define BENCH_WIDE_ENTRIES 10000
+#define BENCH_MAX_THREADS 64
+
+struct bench_scenario {
+	const char *name;
+	int (*setup)(uint32_t threads);
+	int (*op)(uint32_t thread, uint64_t i);
+	/// Zero runs on as many threads as asked for on the command line.
+	uint32_t threads;
+};
+
+struct bench_thread {
+	pthread_t handle;
+	struct bench_scenario *scenario;
+	uint32_t id;
+	uint64_t ops;
+	uint64_t failed;
+	uint64_t *lat;
+};
+
+static char bench_deep_path[BENCH_DEEP_LEVELS * 4 + 16];
+static struct ARC_File *bench_read_file = NULL;
+
+static uint64_t bench_now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int bench_mkdir(char *path) {
+	struct ARC_VFSNodeInfo info = { .type = ARC_VFS_N_DIR, .mode = ARC_STD_PERM, .driver_index = (uint64_t)-1 };
+
+	return vfs_create(path, &info);
+}
+
+static int bench_mkfile(char *path) {
+	struct ARC_VFSNodeInfo info = { .type = ARC_VFS_N_FILE, .mode = ARC_STD_PERM, .driver_index = (uint64_t)-1 };
+
+	return vfs_create(path, &info);
+}
+
+static int setup_deep(uint32_t threads) {
+	(void)threads;
+
+	size_t len = sprintf(bench_deep_path, "/deep");
+
+	for (int i = 0; i < BENCH_DEEP_LEVELS; i++) {
+		len += sprintf(bench_deep_path + len, "/d%d", i);
+	}
+
+	if (bench_mkdir(bench_deep_path) != 0) {
+		return -1;
+	}
+
+	sprintf(bench_deep_path + len, "/file");
+
+	return bench_mkfile(bench_deep_path);
+}
+
+static int op_deep(uint32_t thread, uint64_t i) {
+	(void)thread;
+	(void)i;
+
+	struct stat stat;
+
+	return vfs_stat(bench_deep_path, &stat);
+}
+
+static struct ARC_File *bench_deep_cwd = NULL;
+
+static int setup_deep_at(uint32_t threads) {
+	(void)threads;
+
+	// The directory of the file made by deep_lookup
+	char *last = strrchr(bench_deep_path, '/');
+
+	if (last == NULL) {
+		return -1;
+	}
+
+	*last = 0;
+	int err = vfs_chdir(&bench_deep_cwd, bench_deep_path);
+	*last = '/';
+
+	return err;
+}
+
+static int op_deep_at(uint32_t thread, uint64_t i) {
+	(void)thread;
+	(void)i;
+
+	struct stat stat;
+
+	return vfs_statat(bench_deep_cwd, "file", &stat);
+}
+
+static int setup_wide(uint32_t threads) {
+	(void)threads;
+
+	char path[32];
+
+	for (int i = 0; i < BENCH_WIDE_ENTRIES; i++) {
+		sprintf(path, "/wide/f%d", i);
+
+		if (bench_mkfile(path) != 0) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static int op_wide(uint32_t thread, uint64_t i) {
+	char path[32];
+	sprintf(path, "/wide/f%"PRIu64, (i * 7919 + thread) % BENCH_WIDE_ENTRIES);
+
+	struct stat stat;
+
+	return vfs_stat(path, &stat);
+}
+
+static int setup_churn(uint32_t threads) {
+	(void)threads;
+
+	return bench_mkfile("/churn/file");
+}
+
+static int op_churn(uint32_t thread, uint64_t i) {
+	(void)thread;
+	(void)i;
+
+	struct ARC_File *file = NULL;
+
+	if (vfs_open("/churn/file", 0, ARC_STD_PERM, &file) != 0) {
+		return -1;
+	}
+
+	return vfs_close(file);
+}
+
+static int setup_read(uint32_t threads) {
+	(void)threads;
+
+	if (vfs_open("/data/file", O_CREAT, ARC_STD_PERM, &bench_read_file) != 0) {
+		return -1;
+	}
+
+	static char block[BENCH_FILE_SIZE];
+	memset(block, 'A', sizeof(block));
+
+	return vfs_write(block, 1, sizeof(block), bench_read_file) == sizeof(block) ? 0 : -2;
+}
+
+static int op_read(uint32_t thread, uint64_t i) {
+	(void)thread;
+
+	char buffer[512];
+	long offset = (long)((i * sizeof(buffer)) % BENCH_FILE_SIZE);
+
+	return vfs_pread(buffer, 1, sizeof(buffer), offset, bench_read_file) == sizeof(buffer) ? 0 : -1;
+}
+
+static int setup_storm(uint32_t threads) {
+	(void)threads;
+
+	return bench_mkdir("/storm");
+}
+
+static int op_storm(uint32_t thread, uint64_t i) {
+	char path[48];
+	sprintf(path, "/storm/t%u_%"PRIu64, thread, i);
+
+	if (bench_mkfile(path) != 0) {
+		return -1;
+	}
+
+	return vfs_remove(path, 0);
+}
+
+static int setup_scratch(uint32_t threads) {
+	(void)threads;
+
+	return bench_mkdir("/scratch");
+}
+
+// A short lived memory file: a few records cut back to part of the first, and
+// one far past it
+static int op_scratch(uint32_t thread, uint64_t i) {
+	char path[48];
+	sprintf(path, "/scratch/t%u_%"PRIu64, thread, i);
+
+	struct ARC_File *file = NULL;
+
+	if (vfs_open(path, O_CREAT, ARC_STD_PERM, &file) != 0) {
+		return -1;
+	}
+
+	char record[64];
+	memset(record, 'S', sizeof(record));
+
+	int ret = 0;
+
+	for (int j = 0; j < 4 && ret == 0; j++) {
+		if (vfs_write(record, 1, sizeof(record), file) != sizeof(record)) {
+			ret = -2;
+		}
+	}
+
+	// What is left after the cut has to survive it
+	char kept[10] = { 0 };
+
+	if (ret == 0 && (vfs_tmpfs_truncate(file->node, sizeof(kept)) != 0
+	    || vfs_pread(kept, 1, sizeof(kept), 0, file) != sizeof(kept)
+	    || memcmp(kept, record, sizeof(kept)) != 0)) {
+		ret = -4;
+	}
+
+	if (ret == 0 && (vfs_pwrite(record, 1, sizeof(record), 4 * BENCH_FILE_SIZE, file) != sizeof(record)
+	    || vfs_pread(record, 1, sizeof(record), 0, file) != sizeof(record))) {
+		ret = -2;
+	}
+
+	vfs_close(file);
+
+	return vfs_remove(path, 0) == 0 ? ret : -3;
+}
+
+// Every operation builds a small tree, as boot would for /dev, and removes it
+#define BENCH_BOOT_DIRS 4
+#define BENCH_BOOT_FILES 7
+#define BENCH_BOOT_ENTRIES (1 + BENCH_BOOT_DIRS * (1 + BENCH_BOOT_FILES) + 1)
+
+static struct {
+	struct ARC_VFSImageHeader header;
+	struct ARC_VFSImageEntry entries[BENCH_BOOT_ENTRIES];
+	char strings[128];
+} bench_boot_image;
+
+static int setup_boot_image(uint32_t threads) {
+	(void)threads;
+
+	struct ARC_VFSImageEntry *entries = bench_boot_image.entries;
+	char *strings = bench_boot_image.strings;
+	uint32_t n = 0;
+
+	// The name of the top is rewritten by every operation
+	uint32_t len = sprintf(strings, "b00000000") + 1;
+	uint32_t link_name = len;
+	len += sprintf(strings + len, "l") + 1;
+	uint32_t link_target = len;
+	len += sprintf(strings + len, "d0/f0") + 1;
+
+	entries[n++] = (struct ARC_VFSImageEntry){ .parent = ARC_VFS_IMAGE_TOP, .name = 0, .target = ARC_VFS_IMAGE_NONE,
+	                                           .type = ARC_VFS_N_DIR, .mode = ARC_STD_PERM, .driver_index = (uint64_t)-1 };
+
+	for (uint32_t d = 0; d < BENCH_BOOT_DIRS; d++) {
+		entries[n++] = (struct ARC_VFSImageEntry){ .parent = 0, .name = len, .target = ARC_VFS_IMAGE_NONE,
+		                                           .type = ARC_VFS_N_DIR, .mode = ARC_STD_PERM, .driver_index = (uint64_t)-1 };
+		len += sprintf(strings + len, "d%u", d) + 1;
+	}
+
+	for (uint32_t d = 0; d < BENCH_BOOT_DIRS; d++) {
+		for (uint32_t f = 0; f < BENCH_BOOT_FILES; f++) {
+			entries[n++] = (struct ARC_VFSImageEntry){ .parent = 1 + d, .name = len, .target = ARC_VFS_IMAGE_NONE,
+			                                           .type = ARC_VFS_N_FILE, .mode = ARC_STD_PERM, .driver_index = (uint64_t)-1 };
+			len += sprintf(strings + len, "f%u", f) + 1;
+		}
+	}
+
+	entries[n++] = (struct ARC_VFSImageEntry){ .parent = 0, .name = link_name, .target = link_target,
+	                                           .type = ARC_VFS_N_LINK, .mode = ARC_STD_PERM, .driver_index = (uint64_t)-1 };
+
+	bench_boot_image.header = (struct ARC_VFSImageHeader){
+		.magic = ARC_VFS_IMAGE_MAGIC,
+		.version = ARC_VFS_IMAGE_VERSION,
+		.entry_count = n,
+		.entries = offsetof(typeof(bench_boot_image), entries),
+		.strings = offsetof(typeof(bench_boot_image), strings),
+		.strings_size = len,
+	};
+
+	return 0;
+}
+
+// The link resolves, then the whole tree goes
+static int bench_boot_check(char *top) {
+	char path[sizeof(bench_boot_image.strings) + 3];
+	snprintf(path, sizeof(path), "%s/l", top);
+
+	struct stat stat;
+
+	return vfs_stat(path, &stat) == 0 && vfs_remove(top, 1) == 0 ? 0 : -1;
+}
+
+static int op_boot_image(uint32_t thread, uint64_t i) {
+	(void)thread;
+
+	char *top = bench_boot_image.strings;
+	sprintf(top, "b%08"PRIu64, i % 100000000);
+
+	if (vfs_load_image(&bench_boot_image, sizeof(bench_boot_image)) != 0) {
+		return -1;
+	}
+
+	char path[sizeof(bench_boot_image.strings) + 1];
+	snprintf(path, sizeof(path), "/%s", top);
+
+	return bench_boot_check(path) == 0 ? 0 : -2;
+}
+
+static int op_boot_paths(uint32_t thread, uint64_t i) {
+	(void)thread;
+
+	char top[16];
+	char path[48];
+	sprintf(top, "/b%08"PRIu64, i % 100000000);
+
+	for (uint32_t d = 0; d < BENCH_BOOT_DIRS; d++) {
+		sprintf(path, "%s/d%u", top, d);
+
+		if (bench_mkdir(path) != 0) {
+			return -1;
+		}
+
+		for (uint32_t f = 0; f < BENCH_BOOT_FILES; f++) {
+			sprintf(path, "%s/d%u/f%u", top, d, f);
+
+			if (bench_mkfile(path) != 0) {
+				return -1;
+			}
+		}
+	}
+
+	char target[48];
+	sprintf(target, "%s/d0/f0", top);
+	sprintf(path, "%s/l", top);
+
+	if (vfs_link(target, path, -1) != 0) {
+		return -2;
+	}
+
+	return bench_boot_check(top) == 0 ? 0 : -3;
+}
+
+// Every operation creates and removes this many files in one batch
+#define BENCH_BATCH_FILES 64
+
+static int setup_batch(uint32_t threads) {
+	(void)threads;
+
+	return bench_mkdir("/batch");
+}
+
+static int op_batch(uint32_t thread, uint64_t i) {
+	struct ARC_VFSBatchOp ops[BENCH_BATCH_FILES * 2];
+	char paths[BENCH_BATCH_FILES][48];
+
+	memset(ops, 0, sizeof(ops));
+
+	for (int j = 0; j < BENCH_BATCH_FILES; j++) {
+		sprintf(paths[j], "/batch/t%u_%"PRIu64"_%d", thread, i, j);
+
+		ops[j].op = ARC_VFS_BATCH_CREATE;
+		ops[j].path = paths[j];
+		ops[j].info.type = ARC_VFS_N_FILE;
+		ops[j].info.mode = ARC_STD_PERM;
+		ops[j].info.driver_index = (uint64_t)-1;
+
+		ops[BENCH_BATCH_FILES + j].op = ARC_VFS_BATCH_REMOVE;
+		ops[BENCH_BATCH_FILES + j].path = paths[j];
+	}
+
+	return vfs_batch(ops, BENCH_BATCH_FILES * 2);
+}
+
+static int setup_root(uint32_t threads) {
+	char path[32];
+
+	for (uint32_t i = 0; i < threads; i++) {
+		sprintf(path, "/root%u", i);
+
+		if (bench_mkfile(path) != 0) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static int op_root(uint32_t thread, uint64_t i) {
+	(void)i;
+
+	char path[32];
+	sprintf(path, "/root%u", thread);
+
+	struct ARC_File *file = NULL;
+
+	if (vfs_open(path, 0, ARC_STD_PERM, &file) != 0) {
+		return -1;
+	}
+
+	return vfs_close(file);
+}
+
+static int setup_shared(uint32_t threads) {
+	(void)threads;
+
+	return bench_mkfile("/shared/file");
+}
+
+// Lookups in one directory while its first thread keeps changing it
+static int op_shared(uint32_t thread, uint64_t i) {
+	if (thread == 0) {
+		char path[48];
+		sprintf(path, "/shared/t%"PRIu64, i);
+
+		if (bench_mkfile(path) != 0) {
+			return -1;
+		}
+
+		return vfs_remove(path, 0);
+	}
+
+	struct stat stat;
+
+	return vfs_stat("/shared/file", &stat);
+}
+
+static int setup_symlink(uint32_t threads) {
+	(void)threads;
+
+	if (bench_mkfile("/links/target") != 0 || bench_mkdir("/links/dir") != 0) {
+		return -1;
+	}
+
+	return vfs_link("/links/target", "/links/dir/link", -1);
+}
+
+static int op_symlink(uint32_t thread, uint64_t i) {
+	(void)thread;
+	(void)i;
+
+	struct stat stat;
+
+	return vfs_stat("/links/dir/link", &stat);
+}
+
+static struct bench_scenario bench_scenarios[] = {
+	{ .name = "deep_lookup", .setup = setup_deep, .op = op_deep, .threads = 1 },
+	// NOTE: Needs the tree of deep_lookup
+	{ .name = "deep_lookup_at", .setup = setup_deep_at, .op = op_deep_at, .threads = 1 },
+	{ .name = "wide_lookup", .setup = setup_wide, .op = op_wide, .threads = 1 },
+	{ .name = "open_close", .setup = setup_churn, .op = op_churn, .threads = 1 },
+	{ .name = "read", .setup = setup_read, .op = op_read, .threads = 1 },
+	{ .name = "create_delete", .setup = setup_storm, .op = op_storm, .threads = 1 },
+	{ .name = "scratch_file", .setup = setup_scratch, .op = op_scratch, .threads = 1 },
+	{ .name = "boot_image", .setup = setup_boot_image, .op = op_boot_image, .threads = 1 },
+	{ .name = "boot_paths", .setup = NULL, .op = op_boot_paths, .threads = 1 },
+	{ .name = "batch_64", .setup = setup_batch, .op = op_batch, .threads = 1 },
+	{ .name = "root_contention", .setup = setup_root, .op = op_root, .threads = 0 },
+	{ .name = "shared_dir", .setup = setup_shared, .op = op_shared, .threads = 0 },
+	{ .name = "symlink", .setup = setup_symlink, .op = op_symlink, .threads = 1 },
+};
+
+static void *bench_thread_main(void *arg) {
+	struct bench_thread *thread = (struct bench_thread *)arg;
+	bench_processor_id = thread->id;
+
+	for (uint64_t i = 0; i < thread->ops; i++) {
+		uint64_t start = bench_now();
+
+		if (thread->scenario->op(thread->id, i) != 0) {
+			thread->failed++;
+		}
+
+		thread->lat[i] = bench_now() - start;
+	}
+
+	return NULL;
+}
+
+static int bench_compare(const void *a, const void *b) {
+	uint64_t x = *(const uint64_t *)a;
+	uint64_t y = *(const uint64_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+static int bench_run(struct bench_scenario *scenario, uint32_t threads, uint64_t ops) {
+	threads = scenario->threads == 0 ? threads : scenario->threads;
+
+	if (scenario->setup != NULL && scenario->setup(threads) != 0) {
+		printf("%-16s setup failed\n", scenario->name);
+		return -1;
+	}
+
+	struct bench_thread workers[BENCH_MAX_THREADS] = { 0 };
+	uint64_t *lat = (uint64_t *)alloc(sizeof(*lat) * ops * threads);
+
+	if (lat == NULL) {
+		return -2;
+	}
+
+	uint64_t start = bench_now();
+
+	for (uint32_t i = 0; i < threads; i++) {
+		workers[i].scenario = scenario;
+		workers[i].id = i;
+		workers[i].ops = ops;
+		workers[i].lat = lat + i * ops;
+		pthread_create(&workers[i].handle, NULL, bench_thread_main, &workers[i]);
+	}
+
+	uint64_t failed = 0;
+
+	for (uint32_t i = 0; i < threads; i++) {
+		pthread_join(workers[i].handle, NULL);
+		failed += workers[i].failed;
+	}
+
+	uint64_t elapsed = bench_now() - start;
+	uint64_t total = ops * threads;
+
+	qsort(lat, total, sizeof(*lat), bench_compare);
+
+	double rate = (double)total * 1e9 / (double)(elapsed == 0 ? 1 : elapsed);
+	printf("%-16s %3u thread(s) %12.0f ops/s  p50 %8"PRIu64" ns  p99 %8"PRIu64" ns", scenario->name, threads, rate, lat[total / 2], lat[total * 99 / 100]);
+
+	if (failed > 0) {
+		printf("  (%"PRIu64" failed)", failed);
+	}
+
+	printf("\n");
+	free(lat);
+
+	return failed == 0 ? 0 : -3;
+}
+
+// Usage: bench [-n ops per thread] [-t threads] [scenario ...]
+int main(int argc, char **argv) {
+	uint64_t ops = 100000;
+	uint32_t threads = 4;
+	int first = 1;
+
+	while (first + 1 < argc && argv[first][0] == '-') {
+		if (strcmp(argv[first], "-n") == 0) {
+			ops = strtoull(argv[first + 1], NULL, 10);
+		} else if (strcmp(argv[first], "-t") == 0) {
+			threads = (uint32_t)strtoul(argv[first + 1], NULL, 10);
+		}
+
+		first += 2;
+	}
+
+	if (ops == 0 || threads == 0 || threads > BENCH_MAX_THREADS) {
+		printf("Need at least one operation and 1 to %d threads\n", BENCH_MAX_THREADS);
+		return 1;
+	}
+
+	init_vfs();
+
+	int ret = 0;
+
+	for (size_t i = 0; i < sizeof(bench_scenarios) / sizeof(*bench_scenarios); i++) {
+		int selected = first >= argc;
+
+		for (int j = first; j < argc && !selected; j++) {
+			selected = strcmp(argv[j], bench_scenarios[i].name) == 0;
+		}
+
+		if (selected && bench_run(&bench_scenarios[i], threads, ops) != 0) {
+			ret = 1;
+		}
+	}
+
+	return ret;
+}
@@ -0,0 +1,157 @@
+/**
+ * @file driver.c
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan - Operating System Kernel
+ * Copyright (C) 2023-2025 awewsomegamer
+ *
+ * This file is part of Arctan.
+ *
+ * Arctan is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+ * An in-memory resource driver standing in for the kernel's driver table,
+ * every file keeps its contents in a buffer of its own.
+*/
+#include <bench.h>
+#include <fs/vfs.h>
+#include <drivers/dri_defs.h>
+#include <lib/resource.h>
+#include <mm/allocator.h>
+#include <lib/util.h>
+#include <global.h>
+
+__thread uint32_t bench_processor_id = 0;
+
+struct bench_file {
+	size_t size;
+	char data[BENCH_FILE_SIZE];
+};
+
+static size_t bench_driver_read(void *buffer, size_t size, size_t count, struct ARC_File *file, struct ARC_Resource *res) {
+	struct bench_file *state = (struct bench_file *)res->driver_state;
+	size_t offset = file->offset < 0 ? 0 : (size_t)file->offset;
+
+	if (offset >= state->size) {
+		return 0;
+	}
+
+	size_t len = min(size * count, state->size - offset);
+	memcpy(buffer, state->data + offset, len);
+
+	return len;
+}
+
+static size_t bench_driver_write(void *buffer, size_t size, size_t count, struct ARC_File *file, struct ARC_Resource *res) {
+	struct bench_file *state = (struct bench_file *)res->driver_state;
+	size_t offset = file->offset < 0 ? 0 : (size_t)file->offset;
+
+	if (offset >= BENCH_FILE_SIZE) {
+		return 0;
+	}
+
+	size_t len = min(size * count, BENCH_FILE_SIZE - offset);
+	memcpy(state->data + offset, buffer, len);
+	state->size = max(state->size, offset + len);
+
+	return len;
+}
+
+static int bench_driver_stat(struct ARC_Resource *res, char *filename, struct stat *stat) {
+	(void)filename;
+
+	struct bench_file *state = (struct bench_file *)res->driver_state;
+
+	memset(stat, 0, sizeof(*stat));
+	stat->st_mode = (res->dri_index == ARC_DRIDEF_BUFFER_DIR ? S_IFDIR : S_IFREG) | 0700;
+	stat->st_size = state == NULL ? 0 : state->size;
+
+	return 0;
+}
+
+static void *bench_driver_locate(struct ARC_Resource *res, char *filename) {
+	(void)res;
+	(void)filename;
+
+	return NULL;
+}
+
+static int bench_driver_create(struct ARC_Resource *res, char *path, uint32_t mode, int type) {
+	(void)res;
+	(void)path;
+	(void)mode;
+	(void)type;
+
+	return 0;
+}
+
+static int bench_driver_remove(struct ARC_Resource *res, char *path) {
+	(void)res;
+	(void)path;
+
+	return 0;
+}
+
+static struct ARC_DriverDef bench_driver_def = {
+	.read = bench_driver_read,
+	.write = bench_driver_write,
+	.stat = bench_driver_stat,
+	.locate = bench_driver_locate,
+	.create = bench_driver_create,
+	.remove = bench_driver_remove,
+};
+
+struct ARC_Resource *init_resource(uint64_t dri_index, void *args) {
+	(void)args;
+
+	if (dri_index != ARC_DRIDEF_BUFFER_DIR && dri_index != ARC_DRIDEF_BUFFER_FILE) {
+		return NULL;
+	}
+
+	struct ARC_Resource *res = (struct ARC_Resource *)alloc(sizeof(*res));
+
+	if (res == NULL) {
+		return NULL;
+	}
+
+	memset(res, 0, sizeof(*res));
+	res->dri_index = dri_index;
+	res->driver = &bench_driver_def;
+
+	if (dri_index == ARC_DRIDEF_BUFFER_FILE) {
+		res->driver_state = alloc(sizeof(struct bench_file));
+
+		if (res->driver_state == NULL) {
+			free(res);
+			return NULL;
+		}
+
+		memset(res->driver_state, 0, sizeof(struct bench_file));
+	}
+
+	return res;
+}
+
+int uninit_resource(struct ARC_Resource *resource) {
+	if (resource == NULL) {
+		return -1;
+	}
+
+	free(resource->driver_state);
+	free(resource);
+
+	return 0;
+}
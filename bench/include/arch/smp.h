@@ -0,0 +1,38 @@
+/**
+ * @file smp.h
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan - Operating System Kernel
+ * Copyright (C) 2023-2025 awewsomegamer
+ *
+ * This file is part of Arctan.
+ *
+ * Arctan is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+ * Hosted stand-in for the kernel's processor identification, and for giving
+ * up the processor to another thread.
+*/
+#ifndef ARC_BENCH_ARCH_SMP_H
+#define ARC_BENCH_ARCH_SMP_H
+
+#include <bench.h>
+#include <sched.h>
+
+#define get_processor_id() (bench_processor_id)
+#define smp_yield() sched_yield()
+
+#endif
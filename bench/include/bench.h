@@ -0,0 +1,39 @@
+/**
+ * @file bench.h
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan - Operating System Kernel
+ * Copyright (C) 2023-2025 awewsomegamer
+ *
+ * This file is part of Arctan.
+ *
+ * Arctan is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+ * Shared definitions of the VFS microbenchmarks.
+*/
+#ifndef ARC_BENCH_H
+#define ARC_BENCH_H
+
+#include <stdint.h>
+
+/// Capacity of every file of the in-memory driver.
+#define BENCH_FILE_SIZE 4096
+
+/// Processor the calling thread pretends to be on.
+extern __thread uint32_t bench_processor_id;
+
+#endif
@@ -0,0 +1,35 @@
+/**
+ * @file dri_defs.h
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan - Operating System Kernel
+ * Copyright (C) 2023-2025 awewsomegamer
+ *
+ * This file is part of Arctan.
+ *
+ * Arctan is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+ * Hosted stand-in for the kernel's driver indices.
+*/
+#ifndef ARC_BENCH_DRIVERS_DRI_DEFS_H
+#define ARC_BENCH_DRIVERS_DRI_DEFS_H
+
+#define ARC_DRIDEF_BUFFER_DIR  0
+#define ARC_DRIDEF_BUFFER_FILE 1
+#define ARC_DRIDEF_BENCH       2
+
+#endif
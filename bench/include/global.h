@@ -0,0 +1,43 @@
+/**
+ * @file global.h
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan - Operating System Kernel
+ * Copyright (C) 2023-2025 awewsomegamer
+ *
+ * This file is part of Arctan.
+ *
+ * Arctan is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+ * Hosted stand-in for the kernel's global.h, used by the benchmarks.
+*/
+#ifndef ARC_BENCH_GLOBAL_H
+#define ARC_BENCH_GLOBAL_H
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <stdbool.h>
+
+// The VFS reports its failures through here, benchmarks provoke plenty of them
+#ifdef ARC_BENCH_VERBOSE
+#define ARC_DEBUG(level, fmt, ...) printf("[" #level "] " fmt, ##__VA_ARGS__)
+#else
+#define ARC_DEBUG(level, fmt, ...)
+#endif
+
+#endif
@@ -0,0 +1,47 @@
+/**
+ * @file atomics.h
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan - Operating System Kernel
+ * Copyright (C) 2023-2025 awewsomegamer
+ *
+ * This file is part of Arctan.
+ *
+ * Arctan is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+ * Hosted stand-in for the kernel's locks and atomics, built on pthreads.
+*/
+#ifndef ARC_BENCH_LIB_ATOMICS_H
+#define ARC_BENCH_LIB_ATOMICS_H
+
+#include <pthread.h>
+
+typedef pthread_mutex_t ARC_GenericMutex;
+typedef pthread_spinlock_t ARC_GenericSpinlock;
+
+#define ARC_ATOMIC_INC(x) __atomic_add_fetch(&(x), 1, __ATOMIC_SEQ_CST)
+#define ARC_ATOMIC_DEC(x) __atomic_sub_fetch(&(x), 1, __ATOMIC_SEQ_CST)
+
+#define init_static_mutex(mutex) pthread_mutex_init((mutex), NULL)
+#define mutex_lock(mutex) pthread_mutex_lock(mutex)
+#define mutex_unlock(mutex) pthread_mutex_unlock(mutex)
+
+#define init_static_spinlock(lock) pthread_spin_init((lock), PTHREAD_PROCESS_PRIVATE)
+#define spinlock_lock(lock) pthread_spin_lock(lock)
+#define spinlock_unlock(lock) pthread_spin_unlock(lock)
+
+#endif
@@ -0,0 +1,67 @@
+/**
+ * @file resource.h
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan - Operating System Kernel
+ * Copyright (C) 2023-2025 awewsomegamer
+ *
+ * This file is part of Arctan.
+ *
+ * Arctan is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+ * Hosted stand-in for the kernel's resources and file descriptors.
+*/
+#ifndef ARC_BENCH_LIB_RESOURCE_H
+#define ARC_BENCH_LIB_RESOURCE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+struct ARC_Resource;
+
+struct ARC_File {
+	struct ARC_VFSNode *node;
+	long offset;
+	uint32_t mode;
+	int ref_count;
+};
+
+struct ARC_DriverDef {
+	int (*init)(struct ARC_Resource *res, void *args);
+	int (*uninit)(struct ARC_Resource *res);
+	size_t (*read)(void *buffer, size_t size, size_t count, struct ARC_File *file, struct ARC_Resource *res);
+	size_t (*write)(void *buffer, size_t size, size_t count, struct ARC_File *file, struct ARC_Resource *res);
+	int (*seek)(struct ARC_File *file, struct ARC_Resource *res);
+	int (*rename)(char *a, char *b, struct ARC_Resource *res);
+	int (*stat)(struct ARC_Resource *res, char *filename, struct stat *stat);
+	void *(*locate)(struct ARC_Resource *res, char *filename);
+	int (*create)(struct ARC_Resource *res, char *path, uint32_t mode, int type);
+	int (*remove)(struct ARC_Resource *res, char *path);
+};
+
+struct ARC_Resource {
+	uint64_t dri_index;
+	struct ARC_DriverDef *driver;
+	void *driver_state;
+};
+
+/// Provided by the benchmarks, stands in for the kernel's driver table.
+struct ARC_Resource *init_resource(uint64_t dri_index, void *args);
+int uninit_resource(struct ARC_Resource *resource);
+
+#endif
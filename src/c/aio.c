@@ -0,0 +1,335 @@
+/**
+ * @file aio.c
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan - Operating System Kernel
+ * Copyright (C) 2023-2025 awewsomegamer
+ *
+ * This file is part of Arctan.
+ *
+ * Arctan is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+ * Rings of asynchronous requests and the queue of work for the VFS workers.
+*/
+#include <fs/aio.h>
+#include <fs/vfs.h>
+#include <fs/graph.h>
+#include <fs/pcache.h>
+#include <fs/driver_ext.h>
+#include <global.h>
+#include <mm/allocator.h>
+#include <lib/util.h>
+
+// Ticks of vfs_cpu_clock between two flushes of aged pages by idle workers
+#define ARC_VFS_AIO_FLUSH_TICKS (ARC_VFS_PCACHE_DIRTY_TICKS / 8)
+
+static struct ARC_VFSIORequest *vfs_aio_queue_head = NULL;
+static struct ARC_VFSIORequest *vfs_aio_queue_tail = NULL;
+static ARC_GenericSpinlock vfs_aio_queue_lock = 0;
+/// vfs_cpu_clock of the last flush of aged pages by an idle worker.
+static uint64_t vfs_aio_flush_last = 0;
+
+int init_vfs_aio() {
+	init_static_spinlock(&vfs_aio_queue_lock);
+
+	return 0;
+}
+
+struct ARC_VFSIORing *vfs_aio_create(uint32_t entries) {
+	if (entries == 0 || entries > ARC_VFS_AIO_MAX_ENTRIES) {
+		return NULL;
+	}
+
+	uint32_t size = 1;
+	while (size < entries) {
+		size <<= 1;
+	}
+
+	struct ARC_VFSIORing *ring = (struct ARC_VFSIORing *)alloc(sizeof(*ring));
+
+	if (ring == NULL) {
+		return NULL;
+	}
+
+	memset(ring, 0, sizeof(*ring));
+	ring->entries = size;
+	ring->sq = (struct ARC_VFSIOSqe *)alloc(size * sizeof(struct ARC_VFSIOSqe));
+	ring->cq = (struct ARC_VFSIOCqe *)alloc(size * sizeof(struct ARC_VFSIOCqe));
+
+	if (ring->sq == NULL || ring->cq == NULL) {
+		ARC_DEBUG(ERR, "Failed to allocate ring of %u entries\n", size);
+		free(ring->sq);
+		free(ring->cq);
+		free(ring);
+		return NULL;
+	}
+
+	init_static_spinlock(&ring->cq_lock);
+
+	return ring;
+}
+
+int vfs_aio_destroy(struct ARC_VFSIORing *ring) {
+	if (ring == NULL) {
+		return -1;
+	}
+
+	if (__atomic_load_n(&ring->inflight, __ATOMIC_ACQUIRE) > 0) {
+		return -2;
+	}
+
+	free(ring->sq);
+	free(ring->cq);
+	free(ring);
+
+	return 0;
+}
+
+struct ARC_VFSIOSqe *vfs_aio_get_sqe(struct ARC_VFSIORing *ring) {
+	if (ring == NULL || ring->sq_tail - ring->sq_head >= ring->entries) {
+		return NULL;
+	}
+
+	struct ARC_VFSIOSqe *sqe = &ring->sq[ring->sq_tail & (ring->entries - 1)];
+	memset(sqe, 0, sizeof(*sqe));
+	ring->sq_tail++;
+
+	return sqe;
+}
+
+void vfs_aio_complete(struct ARC_VFSIORequest *req, long result) {
+	if (req == NULL) {
+		return;
+	}
+
+	struct ARC_VFSIORing *ring = req->ring;
+
+	if (req->sqe.op == ARC_VFS_AIO_WRITE && result > 0) {
+		// Before the completion is seen, a stat after it must not be stale
+		vfs_node_stat_invalidate(req->desc.node);
+	}
+
+	// NOTE: Also before, whoever reaps the completion may close the file
+	//       right away and must not find it still in use
+	if (req->sqe.file != NULL) {
+		ARC_ATOMIC_DEC(req->sqe.file->ref_count);
+	}
+
+	spinlock_lock(&ring->cq_lock);
+	// NOTE: Cannot overflow, submission holds back anything that would not
+	//       fit next to what has not been reaped yet
+	struct ARC_VFSIOCqe *cqe = &ring->cq[ring->cq_tail & (ring->entries - 1)];
+	cqe->user_data = req->sqe.user_data;
+	cqe->result = result;
+	__atomic_store_n(&ring->cq_tail, ring->cq_tail + 1, __ATOMIC_RELEASE);
+	spinlock_unlock(&ring->cq_lock);
+
+	free(req);
+}
+
+static long vfs_aio_perform(struct ARC_VFSIORequest *req) {
+	struct ARC_VFSIOSqe *sqe = &req->sqe;
+
+	switch (sqe->op) {
+		case ARC_VFS_AIO_NOP: {
+			return 0;
+		}
+
+		case ARC_VFS_AIO_READ: {
+			return vfs_pread(sqe->buffer, 1, sqe->len, sqe->offset, sqe->file);
+		}
+
+		case ARC_VFS_AIO_WRITE: {
+			return vfs_pwrite(sqe->buffer, 1, sqe->len, sqe->offset, sqe->file);
+		}
+
+		case ARC_VFS_AIO_SYNC: {
+			return vfs_fsync(sqe->file);
+		}
+
+		case ARC_VFS_AIO_DATASYNC: {
+			return vfs_fdatasync(sqe->file);
+		}
+	}
+
+	return -1;
+}
+
+static void vfs_aio_enqueue(struct ARC_VFSIORequest *req) {
+	req->next = NULL;
+
+	spinlock_lock(&vfs_aio_queue_lock);
+
+	if (vfs_aio_queue_tail != NULL) {
+		vfs_aio_queue_tail->next = req;
+	} else {
+		vfs_aio_queue_head = req;
+	}
+
+	vfs_aio_queue_tail = req;
+
+	spinlock_unlock(&vfs_aio_queue_lock);
+}
+
+int vfs_aio_work(int max) {
+	int done = 0;
+
+	while (done < max) {
+		spinlock_lock(&vfs_aio_queue_lock);
+
+		struct ARC_VFSIORequest *req = vfs_aio_queue_head;
+
+		if (req != NULL) {
+			vfs_aio_queue_head = req->next;
+
+			if (vfs_aio_queue_head == NULL) {
+				vfs_aio_queue_tail = NULL;
+			}
+		}
+
+		spinlock_unlock(&vfs_aio_queue_lock);
+
+		if (req == NULL) {
+			// Idle, catch up on pages that have been dirty for too long.
+			// NOTE: vfs_aio_wait comes through here in a loop, only one
+			//       idle pass in a while gets to flush
+			uint64_t now = vfs_cpu_clock();
+			uint64_t last = __atomic_load_n(&vfs_aio_flush_last, __ATOMIC_RELAXED);
+
+			if (now - last > ARC_VFS_AIO_FLUSH_TICKS
+			    && __atomic_compare_exchange_n(&vfs_aio_flush_last, &last, now, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				vfs_pcache_flush_aged();
+			}
+
+			break;
+		}
+
+		vfs_aio_complete(req, vfs_aio_perform(req));
+		done++;
+	}
+
+	return done;
+}
+
+// Hand one request to its driver or to the workers
+static void vfs_aio_dispatch(struct ARC_VFSIORequest *req) {
+	struct ARC_VFSIOSqe *sqe = &req->sqe;
+
+	if (sqe->file == NULL || sqe->file->node == NULL) {
+		vfs_aio_complete(req, sqe->op == ARC_VFS_AIO_NOP ? 0 : -1);
+		return;
+	}
+
+	struct ARC_VFSNode *node = sqe->file->node;
+
+	if (node->link != NULL) {
+		node = node->link;
+	}
+
+	memcpy(&req->desc, sqe->file, sizeof(req->desc));
+	req->desc.node = node;
+	req->desc.offset = sqe->offset;
+
+	// The descriptor is used by the request until it completes
+	ARC_ATOMIC_INC(sqe->file->ref_count);
+
+	struct ARC_Resource *res = node->resource;
+
+	// NOTE: Cached files stay with the workers, going around the page cache
+	//       would miss dirty pages, and hits do not need the device at all
+	if (res != NULL && !vfs_pcache_usable(node) && (sqe->op == ARC_VFS_AIO_READ || sqe->op == ARC_VFS_AIO_WRITE)) {
+		struct ARC_VFSDriverExt *ext = vfs_driver_ext(res->driver);
+
+		if (ext != NULL && ext->submit != NULL && ext->submit(req, &req->desc, res) == 0) {
+			return;
+		}
+	}
+
+	vfs_aio_enqueue(req);
+}
+
+int vfs_aio_submit(struct ARC_VFSIORing *ring) {
+	if (ring == NULL) {
+		return -1;
+	}
+
+	int submitted = 0;
+
+	while (ring->sq_head != ring->sq_tail) {
+		if (__atomic_load_n(&ring->inflight, __ATOMIC_ACQUIRE) >= ring->entries) {
+			// The completion ring could not take it
+			break;
+		}
+
+		struct ARC_VFSIORequest *req = (struct ARC_VFSIORequest *)alloc(sizeof(*req));
+
+		if (req == NULL) {
+			ARC_DEBUG(ERR, "Failed to allocate request\n");
+			break;
+		}
+
+		memset(req, 0, sizeof(*req));
+		req->ring = ring;
+		memcpy(&req->sqe, &ring->sq[ring->sq_head & (ring->entries - 1)], sizeof(req->sqe));
+		ring->sq_head++;
+
+		ARC_ATOMIC_INC(ring->inflight);
+		vfs_aio_dispatch(req);
+		submitted++;
+	}
+
+	return submitted;
+}
+
+int vfs_aio_reap(struct ARC_VFSIORing *ring, struct ARC_VFSIOCqe *cqes, int max) {
+	if (ring == NULL || cqes == NULL || max <= 0) {
+		return 0;
+	}
+
+	uint32_t tail = __atomic_load_n(&ring->cq_tail, __ATOMIC_ACQUIRE);
+	int count = 0;
+
+	while (ring->cq_head != tail && count < max) {
+		memcpy(&cqes[count], &ring->cq[ring->cq_head & (ring->entries - 1)], sizeof(*cqes));
+		ring->cq_head++;
+		count++;
+	}
+
+	if (count > 0) {
+		__atomic_sub_fetch(&ring->inflight, count, __ATOMIC_RELEASE);
+	}
+
+	return count;
+}
+
+int vfs_aio_wait(struct ARC_VFSIORing *ring, uint32_t min) {
+	if (ring == NULL) {
+		return 0;
+	}
+
+	while (1) {
+		uint32_t ready = __atomic_load_n(&ring->cq_tail, __ATOMIC_ACQUIRE) - ring->cq_head;
+
+		if (ready >= min || ready >= __atomic_load_n(&ring->inflight, __ATOMIC_ACQUIRE)) {
+			// Either enough, or everything that was submitted is done
+			return ready;
+		}
+
+		// Rather than spin, help the workers, the request waited on may be queued
+		vfs_aio_work(1);
+	}
+}
@@ -0,0 +1,206 @@
+/**
+ * @file dcache.c
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan - Operating System Kernel
+ * Copyright (C) 2023-2025 awewsomegamer
+ *
+ * This file is part of Arctan.
+ *
+ * Arctan is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+ * The global (parent, component) lookup cache.
+ *
+ * Entries are keyed on the parent's id rather than its address so that an
+ * entry left behind by a freed parent can never match a node that is later
+ * allocated at the same address. Positive entries are always dropped before
+ * the node they point to is freed (see vfs_detach_node), which is what makes
+ * taking a reference under the bucket lock safe.
+*/
+#include <fs/dcache.h>
+#include <fs/graph.h>
+#include <fs/ref.h>
+#include <global.h>
+#include <lib/util.h>
+
+// Must be a power of two
+#define ARC_VFS_DCACHE_BUCKETS 1024
+#define ARC_VFS_DCACHE_WAYS 4
+
+struct ARC_VFSDentry {
+	uint64_t parent_id;
+	/// The node that was found, NULL for a negative entry.
+	struct ARC_VFSNode *node;
+	uint32_t hash;
+	/// Length of the name, zero if the entry is free.
+	uint8_t len;
+	char name[ARC_VFS_DCACHE_NAME_MAX];
+};
+
+struct ARC_VFSDcacheBucket {
+	ARC_GenericSpinlock lock;
+	/// The next way to replace when the bucket is full.
+	uint32_t victim;
+	struct ARC_VFSDentry entries[ARC_VFS_DCACHE_WAYS];
+};
+
+static struct ARC_VFSDcacheBucket vfs_dcache[ARC_VFS_DCACHE_BUCKETS] = { 0 };
+
+static struct ARC_VFSDcacheBucket *vfs_dcache_bucket(uint64_t parent_id, uint32_t hash) {
+	uint64_t key = (parent_id * 0x9E3779B97F4A7C15) ^ hash;
+	return &vfs_dcache[(key ^ (key >> 32)) & (ARC_VFS_DCACHE_BUCKETS - 1)];
+}
+
+static struct ARC_VFSDentry *vfs_dcache_find(struct ARC_VFSDcacheBucket *bucket, uint64_t parent_id, uint32_t hash, char *name, size_t len) {
+	for (int i = 0; i < ARC_VFS_DCACHE_WAYS; i++) {
+		struct ARC_VFSDentry *entry = &bucket->entries[i];
+
+		if (entry->len == len && entry->hash == hash && entry->parent_id == parent_id
+		    && vfs_name_equal(entry->name, name, len)) {
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+int init_vfs_dcache() {
+	for (int i = 0; i < ARC_VFS_DCACHE_BUCKETS; i++) {
+		init_static_spinlock(&vfs_dcache[i].lock);
+	}
+
+	return 0;
+}
+
+int vfs_dcache_lookup(struct ARC_VFSNode *parent, char *name, size_t len, uint32_t hash, struct ARC_VFSNode **ret) {
+	if (parent == NULL || name == NULL || len == 0 || len > ARC_VFS_DCACHE_NAME_MAX) {
+		return ARC_VFS_DCACHE_MISS;
+	}
+
+	struct ARC_VFSDcacheBucket *bucket = vfs_dcache_bucket(parent->id, hash);
+
+	spinlock_lock(&bucket->lock);
+
+	struct ARC_VFSDentry *entry = vfs_dcache_find(bucket, parent->id, hash, name, len);
+
+	if (entry == NULL) {
+		spinlock_unlock(&bucket->lock);
+		return ARC_VFS_DCACHE_MISS;
+	}
+
+	if (entry->node == NULL) {
+		spinlock_unlock(&bucket->lock);
+		return ARC_VFS_DCACHE_NEGATIVE;
+	}
+
+	if (ret != NULL) {
+		*ret = entry->node;
+		vfs_node_get(entry->node);
+	}
+
+	spinlock_unlock(&bucket->lock);
+
+	return ARC_VFS_DCACHE_HIT;
+}
+
+int vfs_dcache_insert(struct ARC_VFSNode *parent, char *name, size_t len, uint32_t hash, struct ARC_VFSNode *node) {
+	if (parent == NULL || name == NULL || len == 0 || len > ARC_VFS_DCACHE_NAME_MAX) {
+		return -1;
+	}
+
+	struct ARC_VFSDcacheBucket *bucket = vfs_dcache_bucket(parent->id, hash);
+
+	spinlock_lock(&bucket->lock);
+
+	struct ARC_VFSDentry *entry = vfs_dcache_find(bucket, parent->id, hash, name, len);
+
+	if (entry == NULL) {
+		for (int i = 0; i < ARC_VFS_DCACHE_WAYS; i++) {
+			if (bucket->entries[i].len == 0) {
+				entry = &bucket->entries[i];
+				break;
+			}
+		}
+	}
+
+	if (entry == NULL) {
+		entry = &bucket->entries[bucket->victim];
+		bucket->victim = (bucket->victim + 1) % ARC_VFS_DCACHE_WAYS;
+	}
+
+	entry->parent_id = parent->id;
+	entry->node = node;
+	entry->hash = hash;
+	entry->len = len;
+	memcpy(entry->name, name, len);
+
+	spinlock_unlock(&bucket->lock);
+
+	return 0;
+}
+
+void vfs_dcache_invalidate(struct ARC_VFSNode *parent, char *name, size_t len, uint32_t hash) {
+	if (parent == NULL || name == NULL || len == 0 || len > ARC_VFS_DCACHE_NAME_MAX) {
+		return;
+	}
+
+	struct ARC_VFSDcacheBucket *bucket = vfs_dcache_bucket(parent->id, hash);
+
+	spinlock_lock(&bucket->lock);
+
+	struct ARC_VFSDentry *entry = vfs_dcache_find(bucket, parent->id, hash, name, len);
+
+	if (entry != NULL) {
+		memset(entry, 0, sizeof(*entry));
+	}
+
+	spinlock_unlock(&bucket->lock);
+}
+
+void vfs_dcache_invalidate_dir(struct ARC_VFSNode *parent) {
+	if (parent == NULL) {
+		return;
+	}
+
+	// NOTE: The entries of one parent are spread over every bucket
+	for (int i = 0; i < ARC_VFS_DCACHE_BUCKETS; i++) {
+		struct ARC_VFSDcacheBucket *bucket = &vfs_dcache[i];
+
+		spinlock_lock(&bucket->lock);
+
+		for (int j = 0; j < ARC_VFS_DCACHE_WAYS; j++) {
+			struct ARC_VFSDentry *entry = &bucket->entries[j];
+
+			if (entry->len != 0 && entry->parent_id == parent->id) {
+				memset(entry, 0, sizeof(*entry));
+			}
+		}
+
+		spinlock_unlock(&bucket->lock);
+	}
+}
+
+void vfs_dcache_flush() {
+	for (int i = 0; i < ARC_VFS_DCACHE_BUCKETS; i++) {
+		struct ARC_VFSDcacheBucket *bucket = &vfs_dcache[i];
+
+		spinlock_lock(&bucket->lock);
+		memset(bucket->entries, 0, sizeof(bucket->entries));
+		bucket->victim = 0;
+		spinlock_unlock(&bucket->lock);
+	}
+}
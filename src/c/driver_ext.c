@@ -0,0 +1,93 @@
+/**
+ * @file driver_ext.c
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan - Operating System Kernel
+ * Copyright (C) 2023-2025 awewsomegamer
+ *
+ * This file is part of Arctan.
+ *
+ * Arctan is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+ * Registry of the extended driver entry points. Lookups happen on every I/O
+ * request and do not take a lock, entries are only ever appended.
+*/
+#include <fs/driver_ext.h>
+#include <global.h>
+#include <lib/atomics.h>
+
+struct vfs_driver_ext_entry {
+	struct ARC_DriverDef *def;
+	struct ARC_VFSDriverExt *ext;
+};
+
+static struct vfs_driver_ext_entry vfs_driver_exts[ARC_VFS_MAX_DRIVER_EXT] = { 0 };
+static uint32_t vfs_driver_ext_count = 0;
+static ARC_GenericSpinlock vfs_driver_ext_lock = 0;
+
+int init_vfs_driver_ext() {
+	init_static_spinlock(&vfs_driver_ext_lock);
+
+	return 0;
+}
+
+int vfs_register_driver_ext(struct ARC_DriverDef *def, struct ARC_VFSDriverExt *ext) {
+	if (def == NULL || ext == NULL) {
+		return -1;
+	}
+
+	spinlock_lock(&vfs_driver_ext_lock);
+
+	uint32_t count = vfs_driver_ext_count;
+
+	for (uint32_t i = 0; i < count; i++) {
+		if (vfs_driver_exts[i].def == def) {
+			__atomic_store_n(&vfs_driver_exts[i].ext, ext, __ATOMIC_RELEASE);
+			spinlock_unlock(&vfs_driver_ext_lock);
+
+			return 0;
+		}
+	}
+
+	if (count >= ARC_VFS_MAX_DRIVER_EXT) {
+		spinlock_unlock(&vfs_driver_ext_lock);
+		ARC_DEBUG(ERR, "No room to register driver extensions\n");
+
+		return -2;
+	}
+
+	vfs_driver_exts[count].def = def;
+	vfs_driver_exts[count].ext = ext;
+	// Publish the entry only once it is filled in
+	__atomic_store_n(&vfs_driver_ext_count, count + 1, __ATOMIC_RELEASE);
+
+	spinlock_unlock(&vfs_driver_ext_lock);
+
+	return 0;
+}
+
+struct ARC_VFSDriverExt *vfs_driver_ext(struct ARC_DriverDef *def) {
+	uint32_t count = __atomic_load_n(&vfs_driver_ext_count, __ATOMIC_ACQUIRE);
+
+	for (uint32_t i = 0; i < count; i++) {
+		if (vfs_driver_exts[i].def == def) {
+			return __atomic_load_n(&vfs_driver_exts[i].ext, __ATOMIC_ACQUIRE);
+		}
+	}
+
+	return NULL;
+}
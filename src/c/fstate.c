@@ -0,0 +1,121 @@
+/**
+ * @file fstate.c
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan - Operating System Kernel
+ * Copyright (C) 2023-2025 awewsomegamer
+ *
+ * This file is part of Arctan.
+ *
+ * Arctan is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+ * Chained hash table of per-file state, one spinlock per bucket.
+*/
+#include <fs/fstate.h>
+#include <global.h>
+#include <mm/allocator.h>
+#include <lib/atomics.h>
+#include <lib/util.h>
+
+struct vfs_fstate_bucket {
+	ARC_GenericSpinlock lock;
+	struct ARC_VFSFileState *head;
+};
+
+static struct vfs_fstate_bucket vfs_fstate_table[ARC_VFS_FSTATE_BUCKETS] = { 0 };
+
+static struct vfs_fstate_bucket *vfs_fstate_bucket(struct ARC_File *file) {
+	// Descriptors are allocated, so the low bits carry nothing
+	uint64_t key = ((uintptr_t)file >> 4) * 0x9E3779B97F4A7C15ULL;
+	return &vfs_fstate_table[(key >> 32) % ARC_VFS_FSTATE_BUCKETS];
+}
+
+int init_vfs_fstate() {
+	for (int i = 0; i < ARC_VFS_FSTATE_BUCKETS; i++) {
+		init_static_spinlock(&vfs_fstate_table[i].lock);
+	}
+
+	return 0;
+}
+
+struct ARC_VFSFileState *vfs_fstate_create(struct ARC_File *file) {
+	if (file == NULL) {
+		return NULL;
+	}
+
+	struct ARC_VFSFileState *state = (struct ARC_VFSFileState *)alloc(sizeof(*state));
+
+	if (state == NULL) {
+		ARC_DEBUG(ERR, "Failed to allocate file state\n");
+		return NULL;
+	}
+
+	memset(state, 0, sizeof(*state));
+	state->file = file;
+
+	struct vfs_fstate_bucket *bucket = vfs_fstate_bucket(file);
+
+	spinlock_lock(&bucket->lock);
+	state->next = bucket->head;
+	bucket->head = state;
+	spinlock_unlock(&bucket->lock);
+
+	return state;
+}
+
+struct ARC_VFSFileState *vfs_fstate_get(struct ARC_File *file) {
+	if (file == NULL) {
+		return NULL;
+	}
+
+	struct vfs_fstate_bucket *bucket = vfs_fstate_bucket(file);
+
+	spinlock_lock(&bucket->lock);
+
+	struct ARC_VFSFileState *state = bucket->head;
+	while (state != NULL && state->file != file) {
+		state = state->next;
+	}
+
+	spinlock_unlock(&bucket->lock);
+
+	return state;
+}
+
+void vfs_fstate_destroy(struct ARC_File *file) {
+	if (file == NULL) {
+		return;
+	}
+
+	struct vfs_fstate_bucket *bucket = vfs_fstate_bucket(file);
+
+	spinlock_lock(&bucket->lock);
+
+	struct ARC_VFSFileState **link = &bucket->head;
+	while (*link != NULL && (*link)->file != file) {
+		link = &(*link)->next;
+	}
+
+	struct ARC_VFSFileState *state = *link;
+	if (state != NULL) {
+		*link = state->next;
+	}
+
+	spinlock_unlock(&bucket->lock);
+
+	free(state);
+}
@@ -27,18 +27,84 @@
 */
 #include <fs/graph.h>
 #include <fs/vfs.h>
+#include <fs/dcache.h>
+#include <fs/rcu.h>
+#include <fs/slab.h>
+#include <fs/ncache.h>
+#include <fs/pcache.h>
+#include <fs/tmpfs.h>
+#include <fs/driver_ext.h>
+#include <fs/ref.h>
+#include <fs/mount.h>
+#include <fs/stats.h>
 #include <mm/allocator.h>
 #include <lib/util.h>
 #include <lib/perms.h>
 #include <global.h>
 #include <drivers/dri_defs.h>
 
+// Number of children a directory must have before it is indexed
+#define ARC_VFS_INDEX_THRESHOLD 32
+// Number of slots in a freshly built index, must be a power of two
+#define ARC_VFS_INDEX_MIN_SIZE 64
+// Marks a slot whose node was removed, probing must continue past it
+#define ARC_VFS_INDEX_TOMB ((struct ARC_VFSNode *)1)
+
+struct ARC_VFSIndexSlot {
+	struct ARC_VFSNode *node;
+	uint32_t hash;
+};
+
+struct ARC_VFSNodeIndex {
+	struct ARC_VFSRCUHead rcu;
+	/// Number of slots (power of two).
+	size_t size;
+	/// Number of slots holding a node.
+	size_t used;
+	/// Number of slots holding a tombstone.
+	size_t tombs;
+	struct ARC_VFSIndexSlot slots[];
+};
+
+// Most nodes a cached link resolution may go through
+#define ARC_VFS_LINK_TRAIL 16
+
+// Every node a link resolution went through, the last one is the target
+struct ARC_VFSLinkCache {
+	uint32_t count;
+	uint8_t overflow;
+	struct ARC_VFSNode *nodes[ARC_VFS_LINK_TRAIL];
+	uint64_t gens[ARC_VFS_LINK_TRAIL];
+};
+
+// The root is node 0
+static uint64_t vfs_node_id_counter = 0;
+static uint64_t vfs_gen_counter = 0;
+static uint64_t vfs_attach_counter = 0;
+static struct ARC_VFSSlabCache vfs_node_slab = { 0 };
+
+// Paths up to this length are built without allocating
+#define ARC_VFS_PATH_INLINE 128
+
+// Path from base to the node a walk stands on, kept terminated for drivers
+struct vfs_path_builder {
+	struct ARC_VFSNode *base;
+	char *buf;
+	size_t len;
+	size_t cap;
+	// Set once the path could not be grown, until the next reset
+	uint8_t broken;
+	char inline_buf[ARC_VFS_PATH_INLINE];
+};
+
 struct callback_args {
 	struct ARC_VFSNode *node;
 	char *comp;
-	char *mount_path;
+	struct vfs_path_builder *path;
 	void *caller_args;
 	size_t comp_len;
+	/// vfs_name_hash of comp.
+	uint32_t comp_hash;
 };
 
 static int vfs_mode2type(mode_t mode) {
@@ -81,7 +147,8 @@ static int vfs_type2stat(int type) {
 	}
 }
 
-static int vfs_infer_driver(struct ARC_VFSNode *mount, struct ARC_VFSNodeInfo *info) {
+// NOTE: mount is the resource of the mount the node is to be created in
+static int vfs_infer_driver(struct ARC_Resource *mount, struct ARC_VFSNodeInfo *info) {
 	if (info == NULL) {
 		ARC_DEBUG(ERR, "Failed to infer driver, no information provided\n");
 		return -1;
@@ -91,440 +158,2111 @@ static int vfs_infer_driver(struct ARC_VFSNode *mount, struct ARC_VFSNodeInfo *i
 		return 0;
 	}
 
-	if (mount == NULL) {
+	if (mount == NULL && (info->type == ARC_VFS_N_FILE || info->type == ARC_VFS_N_LINK)) {
+		info->driver_index = ARC_VFS_TMPFS_DRIVER;
+	} else if (mount == NULL) {
 		info->driver_index = ARC_DRIDEF_BUFFER_FILE - (info->type == ARC_VFS_N_DIR);
 	} else if (info->type == ARC_VFS_N_DIR) {
-		info->driver_index = mount->resource->dri_index + 1;
+		info->driver_index = mount->dri_index + 1;
 	} else {
-		info->driver_index = mount->resource->dri_index + 2;
+		info->driver_index = mount->dri_index + 2;
 	}
 
 	return 0;
 }
 
-int vfs_delete_node(struct ARC_VFSNode *node, uint32_t flags) {
-        // Flags:
-        //  Bit | Description
-        //  0   | 1: Prune upwards
-        //  1   | 1: Delete physically
-	// TODO: Figure out return values
-	int loop_count = -1;
+// Whether paths under node are given to a resource of its own, rather than to
+// that of its mount. A mountpoint's resource is the mount's
+static int vfs_node_own_resource(struct ARC_VFSNode *node) {
+	return node->resource != NULL && node->type != ARC_VFS_N_MOUNT;
+}
 
-	top:;
-	if (node == NULL) {
-		return loop_count;
-	}
+uint32_t vfs_name_hash(char *name, size_t len) {
+	// FNV-1a
+	uint32_t hash = 2166136261;
 
-	if (node->type == ARC_VFS_N_DIR && node->children != NULL) {
-		ARC_DEBUG(ERR, "Directory node, \"%s\", still has children, aborting\n", node->name);
-		return -2;
+	for (size_t i = 0; i < len; i++) {
+		hash ^= (uint8_t)name[i];
+		hash *= 16777619;
 	}
 
-	if (node->mount == NULL && MASKED_READ(flags, 1, 1) != 1) {
-		// Do not delete nodes that are have their data stored
-		// in memory unless explicitly specified
-		ARC_DEBUG(ERR, "Cannot delete memory-based node, \"%s\", without physical delete set\n", node->name);
-		return -3;
-	}
+	return hash;
+}
 
-	struct ARC_VFSNode *parent = node->parent;
-	mutex_lock(&parent->branch_lock);
+// NOTE: Most mismatches are caught by the hash and length, which sit in the
+//       node's second cache line, without following name
+static bool vfs_name_matches(struct ARC_VFSNode *node, char *name, size_t name_len, uint32_t hash) {
+	return node->name_hash == hash && node->name_len == name_len && vfs_name_equal(node->name, name, name_len);
+}
 
-	if (node->ref_count > 0) {
-		ARC_DEBUG(ERR, "Node is still in use\n");
-		mutex_unlock(&parent->branch_lock);
+static struct ARC_VFSNodeIndex *vfs_index_alloc(size_t size) {
+	size_t bytes = sizeof(struct ARC_VFSNodeIndex) + size * sizeof(struct ARC_VFSIndexSlot);
+	struct ARC_VFSNodeIndex *index = (struct ARC_VFSNodeIndex *)alloc(bytes);
 
-		return -5;
+	if (index == NULL) {
+		return NULL;
 	}
 
-	if (node->prev != NULL) {
-		node->prev->next = node->next;
-	} else {
-		parent->children = node->next;
-	}
+	memset(index, 0, bytes);
+	index->size = size;
 
-	if (node->next != NULL) {
-		node->next->prev = node->prev;
-	}
+	return index;
+}
 
-	if (node->type == ARC_VFS_N_LINK && node->link != NULL) {
-		ARC_ATOMIC_DEC(node->link->ref_count);
+// NOTE: The caller is expected to have made sure that there is at least one free slot
+static void vfs_index_place(struct ARC_VFSNodeIndex *index, struct ARC_VFSNode *node, uint32_t hash) {
+	size_t mask = index->size - 1;
+	size_t i = hash & mask;
+
+	while (index->slots[i].node != NULL && index->slots[i].node != ARC_VFS_INDEX_TOMB) {
+		i = (i + 1) & mask;
 	}
 
-	if (node->resource != NULL) {
-		uninit_resource(node->resource);
+	if (index->slots[i].node == ARC_VFS_INDEX_TOMB) {
+		index->tombs--;
 	}
 
-	if (node->mount != NULL && MASKED_READ(flags, 1, 1) == 1) {
-		struct ARC_DriverDef *def = parent->resource == NULL ? node->mount->resource->driver : parent->resource->driver;
-		// TODO: Consider if def->remove fails
-		def->remove(parent->resource == NULL ? node->mount->resource : parent->resource,
-			    parent->resource == NULL ? vfs_get_path_from_nodes(node->mount, node) : node->name);
+	index->slots[i].hash = hash;
+	__atomic_store_n(&index->slots[i].node, node, __ATOMIC_RELEASE);
+	index->used++;
+}
+
+static void vfs_index_reclaim(struct ARC_VFSRCUHead *head) {
+	free(head);
+}
+
+static void vfs_index_retire(struct ARC_VFSNodeIndex *index) {
+	if (index != NULL) {
+		vfs_rcu_retire(&index->rcu, vfs_index_reclaim);
 	}
+}
 
-	ARC_DEBUG(INFO, "Deleted node, \"%s\", successfully\n", node->name);
+static void vfs_index_destroy(struct ARC_VFSNode *parent) {
+	struct ARC_VFSNodeIndex *index = parent->index;
+	__atomic_store_n(&parent->index, NULL, __ATOMIC_RELEASE);
+	vfs_index_retire(index);
+}
 
-	free(node->name);
-	free(node);
+// Build a new index of the given size out of the parent's children list
+static int vfs_index_build(struct ARC_VFSNode *parent, size_t size) {
+	struct ARC_VFSNodeIndex *index = vfs_index_alloc(size);
 
-	mutex_unlock(&parent->branch_lock);
+	if (index == NULL) {
+		ARC_DEBUG(WARN, "Failed to allocate index for \"%s\", falling back to linear lookup\n", parent->name);
+		vfs_index_destroy(parent);
+		return -1;
+	}
 
-	if (MASKED_READ(flags, 0, 1) == 1) {
-		node = parent;
-		goto top;
+	struct ARC_VFSNode *child = parent->children;
+	while (child != NULL) {
+		vfs_index_place(index, child, child->name_hash);
+		child = child->next;
 	}
 
+	struct ARC_VFSNodeIndex *old = parent->index;
+	__atomic_store_n(&parent->index, index, __ATOMIC_RELEASE);
+	vfs_index_retire(old);
+
 	return 0;
 }
 
-static int internal_vfs_recursive_delete(struct ARC_VFSNode *node, uint32_t flags) {
-	if (node == NULL) {
-		return 0;
-	}
+static int vfs_index_insert(struct ARC_VFSNode *parent, struct ARC_VFSNode *node) {
+	struct ARC_VFSNodeIndex *index = parent->index;
 
-	int in_use = 0;
+	if (index == NULL) {
+		if (parent->cold.child_count <= ARC_VFS_INDEX_THRESHOLD) {
+			return 0;
+		}
 
-	// NOTE: This works because when a node is deleted the parent node's children pointer
-	//       is updated in the event it is the first node
-	while (node->children != NULL) {
-		in_use += internal_vfs_recursive_delete(node->children, flags);
+		// The node has already been put into the children list
+		return vfs_index_build(parent, ARC_VFS_INDEX_MIN_SIZE);
 	}
 
-	if (in_use > 0) {
-		return in_use;
-	}
+	// Keep the load (including tombstones) under 3/4
+	if ((index->used + index->tombs + 1) * 4 >= index->size * 3) {
+		size_t size = index->size;
+
+		if ((index->used + 1) * 2 >= size) {
+			size *= 2;
+		}
 
-	// NOTE: Upwards prune must be disabled
-	if (vfs_delete_node(node, flags & (~1)) != 0) {
-		return 1;
+		// Rebuilding from the children list also picks up the new node
+		return vfs_index_build(parent, size);
 	}
 
+	vfs_index_place(index, node, node->name_hash);
+
 	return 0;
 }
 
-int vfs_delete_node_recursive(struct ARC_VFSNode *node, uint32_t flags) {
-	void *parent = node->parent;
-
-	internal_vfs_recursive_delete(node, flags & (~1));
-	vfs_delete_node(parent, flags);
+static int vfs_index_remove(struct ARC_VFSNode *parent, struct ARC_VFSNode *node) {
+	struct ARC_VFSNodeIndex *index = parent->index;
 
-	return 0;
-}
+	if (index == NULL) {
+		return 0;
+	}
 
-struct ARC_VFSNode *vfs_create_node(struct ARC_VFSNode *parent, char *name, size_t name_len, struct ARC_VFSNodeInfo *info) {
-	if (parent == NULL || name == NULL || name_len == 0 || info == NULL || info->type == ARC_VFS_NULL) {
-		ARC_DEBUG(ERR, "Failed to create node, improper parameters (%p %s %lu %d)\n", parent, name, name_len, info != NULL ? info->type : -1);
-		return NULL;
+	if (parent->cold.child_count < ARC_VFS_INDEX_THRESHOLD / 2) {
+		// Small enough to go back to the linked list
+		vfs_index_destroy(parent);
+		return 0;
 	}
 
-	struct ARC_VFSNode *node = (struct ARC_VFSNode *)alloc(sizeof(*node));
+	size_t mask = index->size - 1;
+	size_t i = node->name_hash & mask;
 
-	if (node == NULL) {
-		ARC_DEBUG(ERR, "Failed to allocate memory for new node (%.*s)\n", (uint32_t)name_len, name);
-		return NULL;
-	}
+	while (index->slots[i].node != NULL) {
+		if (index->slots[i].node == node) {
+			__atomic_store_n(&index->slots[i].node, ARC_VFS_INDEX_TOMB, __ATOMIC_RELEASE);
+			index->used--;
+			index->tombs++;
+			return 0;
+		}
 
-	memset(node, 0, sizeof(*node));
+		i = (i + 1) & mask;
+	}
 
-	node->type = info->type;
+	ARC_DEBUG(ERR, "Node \"%s\" missing from index of \"%s\"\n", node->name, parent->name);
 
-	node->mount = (parent->type == ARC_VFS_N_MOUNT) ? parent : parent->mount;
+	return -1;
+}
 
-	if (info->resource_overwrite == NULL) {
-		node->resource = init_resource(info->driver_index, info->driver_arg);
-	} else {
-		node->resource = info->resource_overwrite;
+// NOTE: Safe to call without the branch_lock from within a read-side section, in
+//       which case the result must be validated against the parent's branch_seq
+struct ARC_VFSNode *vfs_lookup_child_hash(struct ARC_VFSNode *parent, char *name, size_t name_len, uint32_t hash) {
+	if (parent == NULL || name == NULL) {
+		return NULL;
 	}
 
-	node->name = strndup(name, name_len);
+	struct ARC_VFSNodeIndex *index = __atomic_load_n(&parent->index, __ATOMIC_ACQUIRE);
 
-	// NOTE: It is expected that the caller has locked the parent node's branch_lock
-	node->parent = parent;
-	struct ARC_VFSNode *next = parent->children;
-	node->next = next;
+	if (index == NULL) {
+		struct ARC_VFSNode *children = __atomic_load_n(&parent->children, __ATOMIC_ACQUIRE);
+
+		while (children != NULL) {
+			if (vfs_name_matches(children, name, name_len, hash)) {
+				break;
+			}
+
+			children = __atomic_load_n(&children->next, __ATOMIC_ACQUIRE);
+		}
 
-	if (next != NULL) {
-		next->prev = node;
+		return children;
 	}
 
-	parent->children = node;
+	size_t mask = index->size - 1;
+	size_t i = hash & mask;
+	struct ARC_VFSNode *node = NULL;
 
-	if (node->resource != NULL) {
-		node->resource->driver->stat(node->resource, NULL, &node->stat);
-	} else {
-		node->stat.st_mode = (info->mode & 00777) | vfs_type2stat(info->type);
+	while ((node = __atomic_load_n(&index->slots[i].node, __ATOMIC_ACQUIRE)) != NULL) {
+		if (node != ARC_VFS_INDEX_TOMB && index->slots[i].hash == hash && vfs_name_matches(node, name, name_len, hash)) {
+			return node;
+		}
+
+		i = (i + 1) & mask;
 	}
 
-	return node;
+	return NULL;
 }
 
-static char *vfs_path_get_next_component(char *path, uint32_t *is_last) {
-	if (path == NULL || is_last == NULL)  {
+struct ARC_VFSNode *vfs_lookup_child(struct ARC_VFSNode *parent, char *name, size_t name_len) {
+	if (name == NULL) {
 		return NULL;
 	}
 
-	if (*path == 0) {
-		return NULL;
-	}
+	return vfs_lookup_child_hash(parent, name, name_len, vfs_name_hash(name, name_len));
+}
 
-	char *ret = path;
+void vfs_branch_lock(struct ARC_VFSNode *node) {
+	uint64_t start = vfs_stats_clock();
+	vfs_rwlock_write(&node->branch_lock);
+	vfs_stats_time(ARC_VFS_LAT_BRANCH_LOCK, start);
+}
 
-	if (*ret == '/') {
-		ret++;
-	}
+void vfs_branch_unlock(struct ARC_VFSNode *node) {
+	vfs_rwlock_write_unlock(&node->branch_lock);
+}
 
-	while (*ret != 0 && *ret != '/') {
-		ret++;
-	}
+void vfs_branch_lock_shared(struct ARC_VFSNode *node) {
+	uint64_t start = vfs_stats_clock();
+	vfs_rwlock_read(&node->branch_lock);
+	vfs_stats_time(ARC_VFS_LAT_BRANCH_LOCK, start);
+}
 
-	if (*ret == 0) {
-		*is_last = 1;
-	}
+void vfs_branch_unlock_shared(struct ARC_VFSNode *node) {
+	vfs_rwlock_read_unlock(&node->branch_lock);
+}
 
-	return ret;
+void vfs_branch_write_begin(struct ARC_VFSNode *node) {
+	__atomic_add_fetch(&node->branch_seq, 1, __ATOMIC_SEQ_CST);
 }
 
-// Note: This can probably just be merged with the internal traverse function
-static char *vfs_read_link(struct ARC_VFSNode *link) {
-	if (link == NULL || link->type != ARC_VFS_N_LINK) {
-		ARC_DEBUG(ERR, "Cannot resolve link, improper parameters (%p, %d)\n", link, link == NULL ? ARC_VFS_NULL : link->type);
-		return NULL;
-	}
+void vfs_branch_write_end(struct ARC_VFSNode *node) {
+	__atomic_add_fetch(&node->branch_seq, 1, __ATOMIC_SEQ_CST);
+}
 
-	if (link->link != NULL) {
-		// No need to resolve it, as it is already resolved
-		return NULL;
-	}
+// Look up a child without taking the parent's branch_lock, the returned node
+// has its ref_count incremented. NULL means the caller should retry with the
+// branch_lock held.
+static struct ARC_VFSNode *vfs_lookup_child_lockless(struct ARC_VFSNode *parent, char *name, size_t name_len, uint32_t hash) {
+	uint32_t token = vfs_rcu_read_lock();
+	uint32_t seq = __atomic_load_n(&parent->branch_seq, __ATOMIC_ACQUIRE);
 
-	if (link->stat.st_size == 0) {
-		ARC_DEBUG(WARN, "Not resolving link of zero bytes\n");
+	if (seq & 1) {
+		vfs_rcu_read_unlock(token);
 		return NULL;
 	}
 
-	char *path = (char *)alloc(link->stat.st_size);
+	struct ARC_VFSNode *child = vfs_lookup_child_hash(parent, name, name_len, hash);
 
-	if (path == NULL) {
-		ARC_DEBUG(ERR, "Cannot allocate return buffer for link resolution\n");
-		return NULL;
+	if (child != NULL) {
+		// NOTE: The reference must be taken before the sequence is checked again,
+		//       vfs_delete_node starts its write section before looking at
+		//       ref_count, so one of the two is guaranteed to see the other
+		vfs_node_get_rcu(child);
+
+		if (__atomic_load_n(&parent->branch_seq, __ATOMIC_SEQ_CST) != seq) {
+			vfs_node_put(child);
+			child = NULL;
+		}
 	}
 
-	struct ARC_File fake = { .mode = ARC_STD_PERM, .node = link };
+	vfs_rcu_read_unlock(token);
 
-	if (vfs_read(path, 1, link->stat.st_size, &fake) != (size_t)link->stat.st_size) {
-		ARC_DEBUG(ERR, "Failed to read in link\n");
-		free(path);
-		return NULL;
+	return child;
+}
+
+// Give node a generation it has never had, which invalidates every cached link
+// resolution that went through it
+static void vfs_node_bump_gen(struct ARC_VFSNode *node) {
+	__atomic_store_n(&node->gen, ARC_ATOMIC_INC(vfs_gen_counter), __ATOMIC_SEQ_CST);
+}
+
+int vfs_attach_node(struct ARC_VFSNode *parent, struct ARC_VFSNode *node) {
+	if (parent == NULL || node == NULL) {
+		return -1;
 	}
 
-	if (*path == 0) {
-		ARC_DEBUG(ERR, "Link path terminates early\n");
-		free(path);
-		return NULL;
+	vfs_node_bump_gen(node);
+
+	node->parent = parent;
+	node->cold.prev = NULL;
+	node->next = parent->children;
+	// NOTE: Attaching to one parent is serialized by its branch_lock, so the
+	//       values are increasing along each children list from the tail
+	node->cold.dir_seq = ARC_ATOMIC_INC(vfs_attach_counter);
+
+	if (node->next != NULL) {
+		node->next->cold.prev = node;
 	}
 
-	return path;
+	__atomic_store_n(&parent->children, node, __ATOMIC_RELEASE);
+	parent->cold.child_count++;
+
+	vfs_index_insert(parent, node);
+	// Drop any negative entry for this name
+	vfs_dcache_invalidate(parent, node->name, node->name_len, node->name_hash);
+
+	return 0;
 }
 
-static char *internal_vfs_traverse(char *filepath, struct ARC_VFSNode *start, uint32_t flags, struct ARC_VFSNode **end,
-				   struct ARC_VFSNode *(*callback)(struct callback_args *args),
-				   void *caller_args) {
-	// Flags:
-	//  Bit | Description
-	//  0   | 1: Resolve links
-	//  1   | 1: Ignore last component
-	size_t lnk_counter = 0;
-	struct ARC_VFSNode *org_node = NULL;
+int vfs_detach_node(struct ARC_VFSNode *node) {
+	if (node == NULL || node->parent == NULL) {
+		return -1;
+	}
 
+	struct ARC_VFSNode *parent = node->parent;
+	vfs_node_bump_gen(node);
 
-        re_iter:;
+	if (node->cold.prev != NULL) {
+		__atomic_store_n(&node->cold.prev->next, node->next, __ATOMIC_RELEASE);
+	} else {
+		__atomic_store_n(&parent->children, node->next, __ATOMIC_RELEASE);
+	}
 
-	if (filepath == NULL || start == NULL) {
-		return filepath;
+	if (node->next != NULL) {
+		node->next->cold.prev = node->cold.prev;
 	}
 
-	struct ARC_VFSNode *node = start;
-	ARC_ATOMIC_INC(node->ref_count);
+	parent->cold.child_count--;
 
-	struct ARC_VFSNode *next = NULL;
+	vfs_index_remove(parent, node);
+	vfs_dcache_invalidate(parent, node->name, node->name_len, node->name_hash);
 
-	uint32_t is_last = 0;
-	char *comp_base = *filepath == '/' ? filepath + 1 : filepath;
-	char *comp_end = vfs_path_get_next_component(comp_base, &is_last);
-	size_t comp_len = (size_t)comp_end - (size_t)comp_base;
+	// NOTE: next is left alone, a lockless reader standing on this node may
+	//       still need to walk past it, it will fail validation afterwards
+	node->cold.prev = NULL;
 
-	struct callback_args args = {
-	        .caller_args = caller_args,
-		.comp = comp_base,
-		.comp_len = comp_len,
-		.mount_path = NULL,
-		.node = node,
-        };
+	return 0;
+}
 
-	while (comp_end != NULL) {
-		if (MASKED_READ(flags, 1, 1) == 1 && is_last == 1) {
-			break;
-		}
+int vfs_node_cover(struct ARC_VFSNode *node, struct ARC_Resource *resource, struct ARC_VFSCovered *save) {
+	if (node == NULL || save == NULL || node->type != ARC_VFS_N_DIR) {
+		return -1;
+	}
 
-		if (node->type == ARC_VFS_N_MOUNT) {
-			args.mount_path = comp_base;
-		}
+	vfs_branch_write_begin(node);
+	// Links resolved through the directory went to what it held
+	vfs_node_bump_gen(node);
+	// Lookups through it found what it held, and what it did not, the
+	// resource may well have others
+	vfs_dcache_invalidate_dir(node);
 
-		if (strncmp(comp_base, "..", comp_len) == 0) {
-			next = node->parent;
-			goto next_iter;
-		} else if (strncmp(comp_base, ".", comp_len) == 0) {
-			next = node;
-			goto next_iter;
-		}
+	save->children = node->children;
+	save->index = node->index;
+	save->resource = node->resource;
+	save->child_count = node->cold.child_count;
+	save->populated = node->cold.populated;
 
-		mutex_lock(&node->branch_lock);
+	__atomic_store_n(&node->children, NULL, __ATOMIC_RELEASE);
+	__atomic_store_n(&node->index, NULL, __ATOMIC_RELEASE);
+	node->cold.child_count = 0;
+	node->cold.populated = 0;
 
-		struct ARC_VFSNode *children = node->children;
-		while (children != NULL) {
-			if (strncmp(comp_base, children->name, max(strlen(children->name), comp_len)) == 0) {
-				break;
-			}
+	mutex_lock(&node->cold.property_lock);
+	node->type = ARC_VFS_N_MOUNT;
+	node->resource = resource;
+	mutex_unlock(&node->cold.property_lock);
 
-			children = children->next;
-		}
+	vfs_branch_write_end(node);
 
-		next = children;
+	return 0;
+}
 
-		if (callback != NULL && next == NULL) {
-			next = callback(&args);
-		}
+int vfs_node_uncover(struct ARC_VFSNode *node, struct ARC_VFSCovered *saved) {
+	if (node == NULL || saved == NULL || node->type != ARC_VFS_N_MOUNT || node->children != NULL) {
+		return -1;
+	}
 
-		mutex_unlock(&node->branch_lock);
+	vfs_branch_write_begin(node);
+	vfs_node_bump_gen(node);
+	// Negative entries were recorded against the resource
+	vfs_dcache_invalidate_dir(node);
+	vfs_index_destroy(node);
 
-		if (next == NULL) {
-			ARC_DEBUG(ERR, "Quiting traversal of %s, no next node found\n", filepath);
+	mutex_lock(&node->cold.property_lock);
+	node->type = ARC_VFS_N_DIR;
+	node->resource = saved->resource;
+	mutex_unlock(&node->cold.property_lock);
 
-			if (lnk_counter > 0) {
-				ARC_DEBUG(ERR, "\tBroken link!\n");
-				ARC_ATOMIC_DEC(node->ref_count);
-				node = NULL;
-			}
+	node->cold.child_count = saved->child_count;
+	node->cold.populated = saved->populated;
+	__atomic_store_n(&node->index, saved->index, __ATOMIC_RELEASE);
+	__atomic_store_n(&node->children, saved->children, __ATOMIC_RELEASE);
 
-			break;
-		}
+	vfs_branch_write_end(node);
 
-	        next_iter:;
+	return 0;
+}
 
-		if (next != node) {
-			ARC_ATOMIC_INC(next->ref_count);
-			ARC_ATOMIC_DEC(node->ref_count);
-			node = next;
-		}
+// Lookups must not share a cache line with ref_count
+_Static_assert(offsetof(struct ARC_VFSNode, ref_count) == 2 * ARC_VFS_CACHE_LINE, "Lookup fields do not fit in two cache lines");
 
-		comp_base = *comp_end == '/' ? comp_end + 1 : comp_end; // Skip over /
-		comp_end = vfs_path_get_next_component(comp_base, &is_last);
-		comp_len = (size_t)comp_end - (size_t)comp_base;
+int init_vfs_graph() {
+	return init_vfs_slab(&vfs_node_slab, "vfs_node", sizeof(struct ARC_VFSNode));
+}
 
-		args.comp = comp_base;
-		args.comp_len = comp_len;
-		args.node = node;
+static void vfs_node_reclaim(struct ARC_VFSRCUHead *head) {
+	struct ARC_VFSNode *node = (struct ARC_VFSNode *)((uintptr_t)head - offsetof(struct ARC_VFSNode, cold.rcu));
 
-		next = NULL;
+	if (node->name != node->name_inline) {
+		free(node->name);
 	}
 
-	if (MASKED_READ(flags, 0, 1) == 1) {
-		char *new_path = vfs_read_link(node);
+	vfs_slab_free(&vfs_node_slab, node);
+}
 
-		if (new_path == NULL) {
-			goto skip_link;
-		}
+void vfs_rename_node(struct ARC_VFSNode *node, char *name) {
+	if (node == NULL || name == NULL) {
+		return;
+	}
 
-		filepath = new_path;
+	char *old = node->name;
+	size_t len = strlen(name);
+	node->name_len = len;
+	node->name_hash = vfs_name_hash(name, len);
+	__atomic_store_n(&node->name, name, __ATOMIC_RELEASE);
+
+	// NOTE: Lockless readers that found the node before it was detached may
+	//       still be comparing against the old name. The inline buffer is left
+	//       alone for the same reason, and is simply no longer used.
+	if (old != node->name_inline) {
+		vfs_rcu_free(old);
+	}
+}
 
-		if (lnk_counter > 0) {
-			free(filepath);
-		} else {
-			org_node = node;
+// Take node out of parent
+// NOTE: It is expected that the caller has collapsed node's count, passing on
+//       what vfs_node_ref_collapse returned in percpu, and only then locked
+//       parent's branch_lock and opened its write section. The caller's
+//       reference is dropped first if bit 2 of flags is set
+static int vfs_delete_unlink(struct ARC_VFSNode *parent, struct ARC_VFSNode *node, uint32_t flags, bool percpu) {
+	if (MASKED_READ(flags, 1, 1) == 0 && __atomic_load_n(&parent->cold.dir_cursors, __ATOMIC_ACQUIRE) > 0) {
+		// NOTE: Listings of parent resume by the order in which nodes were
+		//       attached, a node loaded back in would come too late for them
+		ARC_DEBUG(ERR, "Node \"%s\" is being listed\n", node->name);
+		vfs_node_ref_restore(node, percpu);
+
+		if (MASKED_READ(flags, 2, 1) == 1) {
+			// Put back where the idle node cache took it from, parent's
+			// branch_lock keeps it around until then
+			vfs_ncache_park(node);
+			vfs_node_put(node);
 		}
-		lnk_counter++;
 
-		start = node->parent;
+		return -5;
+	}
 
-		goto re_iter;
+	if (MASKED_READ(flags, 2, 1) == 1) {
+		vfs_node_put(node);
 	}
 
-	skip_link:;
+	// NOTE: The write section must be open and the cache entry gone before
+	//       ref_count is checked, lockless lookups and cache hits take a
+	//       reference without the branch_lock
+	vfs_dcache_invalidate(parent, node->name, node->name_len, node->name_hash);
+
+	// NOTE: Same for cached link resolutions, which take a reference on their
+	//       target and check its gen again afterwards
+	vfs_node_bump_gen(node);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	// NOTE: ref_count is only checked with node's own branch_lock held, whoever
+	//       deletes the last child of node pins it under that lock before
+	//       pruning upwards. Children are only added by someone holding a reference
+	vfs_branch_lock(node);
+
+	// NOTE: Only an exact count will do from here on. It was collapsed before
+	//       any lock was taken, so it is only left to check that another
+	//       deleter that failed has not restored it since
+	bool exact = __atomic_load_n(&node->ref_state, __ATOMIC_ACQUIRE) == ARC_VFS_REF_EXACT;
+
+	// NOTE: Only taken off the idle node cache once nobody can put it back,
+	//       after which the cache's evictor may still have pinned it
+	if (exact && node->ref_count == 0) {
+		vfs_ncache_remove(node);
+	}
 
-	if (end != NULL) {
-		*end = node;
+	if (!exact || node->ref_count > 0) {
+		ARC_DEBUG(ERR, "Node is still in use\n");
+		vfs_node_ref_restore(node, percpu);
+		vfs_branch_unlock(node);
 
-		if (org_node != NULL) {
-			org_node->link = node;
-			*end = org_node;
-		}
-	} else {
-		ARC_ATOMIC_DEC(node->ref_count);
-		goto create_ret_buff;
+		return -5;
 	}
 
-	create_ret_buff:;
+	if ((node->type == ARC_VFS_N_DIR || node->type == ARC_VFS_N_MOUNT) && node->children != NULL) {
+		ARC_DEBUG(ERR, "Directory node, \"%s\", still has children, aborting\n", node->name);
+		vfs_node_ref_restore(node, percpu);
+		vfs_branch_unlock(node);
+
+		return -2;
+	}
 
-	// It is the job of the caller to free this ret buffer
-	size_t str_len = strlen(comp_base) + 1;
-	char *ret = (char *)alloc(str_len);
-	memset(ret, 0, str_len);
-	memcpy(ret, comp_base, str_len - 1);
+	vfs_index_destroy(node);
+	vfs_branch_unlock(node);
 
-	return ret;
-}
+	vfs_detach_node(node);
 
-static struct ARC_VFSNode *callback_vfs_create_filepath(struct callback_args *args) {
-	if (args->node == NULL || args->comp == NULL || args->comp_len == 0 || args->caller_args == NULL) {
-		ARC_DEBUG(ERR, "Quiting create callback, improper parameters (%p %s %lu %p)\n", args->node, args->comp, args->comp_len, args->caller_args);
-		return NULL;
+	if (MASKED_READ(flags, 1, 1) == 0) {
+		// Still on disk, the parent no longer has a node for every entry
+		parent->cold.populated = 0;
 	}
 
-	struct ARC_VFSNodeInfo local_info = { .type = ARC_VFS_N_DIR, .driver_index = (uint64_t)-1 };
-	struct ARC_VFSNodeInfo *info = (struct ARC_VFSNodeInfo *)args->caller_args;
+	return 0;
+}
+
+// Let go of everything an unlinked node holds, apart from the node itself
+static void vfs_delete_release(struct ARC_VFSNode *node, uint32_t flags) {
+	if (node->type == ARC_VFS_N_LINK && node->link != NULL) {
+		vfs_node_put(node->link);
+	}
+
+	if (node->link_cache != NULL) {
+		vfs_rcu_free(node->link_cache);
+		node->link_cache = NULL;
+	}
+
+	if (node->resource != NULL) {
+		// Dirty pages only matter if the file is going to stay on disk
+		vfs_pcache_destroy(node, MASKED_READ(flags, 1, 1) == 0);
+		uninit_resource(node->resource);
+	}
+
+	vfs_tmpfs_destroy(node);
+}
+
+// The resource through which the driver removes node from disk
+static struct ARC_Resource *vfs_delete_resource(struct ARC_VFSNode *parent, struct ARC_VFSNode *node) {
+	return vfs_node_own_resource(parent) ? parent->resource : vfs_mount_resource(node);
+}
+
+// NOTE: The path is allocated if parent has no resource of its own
+static char *vfs_delete_path(struct ARC_VFSNode *parent, struct ARC_VFSNode *node) {
+	return vfs_node_own_resource(parent) ? node->name : vfs_get_mount_path(node);
+}
+
+int vfs_delete_node(struct ARC_VFSNode *node, uint32_t flags) {
+        // Flags:
+        //  Bit | Description
+        //  0   | 1: Prune upwards
+        //  1   | 1: Delete physically
+        //  2   | 1: Caller holds a reference on node, drop it once locked
+	// NOTE: Once the given node has been deleted, failing to prune any further
+	//       is not an error
+	int deleted = 0;
+
+	top:;
+	if (node == NULL) {
+		return deleted > 0 ? 0 : -1;
+	}
+
+	int early = 0;
+	struct ARC_VFSNode *parent = node->parent;
+
+	if (node->mount == NULL && MASKED_READ(flags, 1, 1) != 1) {
+		// Do not delete nodes that are have their data stored
+		// in memory unless explicitly specified
+		ARC_DEBUG(ERR, "Cannot delete memory-based node, \"%s\", without physical delete set\n", node->name);
+		early = -3;
+	} else if (parent == NULL) {
+		// Pruned all the way up to the root
+		early = -1;
+	}
+
+	if (early != 0) {
+		if (MASKED_READ(flags, 2, 1) == 1) {
+			vfs_node_put(node);
+		}
+
+		return deleted > 0 ? 0 : early;
+	}
+
+	// Waits out a grace period if node is hot, which must not stall lookups
+	// through parent
+	bool percpu = vfs_node_ref_collapse(node);
+
+	vfs_branch_lock(parent);
+
+	vfs_branch_write_begin(parent);
+	int err = vfs_delete_unlink(parent, node, flags, percpu);
+	vfs_branch_write_end(parent);
+
+	if (err != 0) {
+		vfs_branch_unlock(parent);
+
+		return deleted > 0 ? 0 : err;
+	}
+
+	vfs_delete_release(node, flags);
+
+	if (node->mount != NULL && MASKED_READ(flags, 1, 1) == 1) {
+		struct ARC_Resource *res = vfs_delete_resource(parent, node);
+		char *path = vfs_delete_path(parent, node);
+
+		// TODO: Consider if def->remove fails
+		if (path != NULL) {
+			ARC_VFS_TIMED(ARC_VFS_LAT_REMOVE, res->driver->remove(res, path));
+		}
+
+		if (path != NULL && path != node->name) {
+			free(path);
+		}
+	}
+
+	ARC_DEBUG(INFO, "Deleted node, \"%s\", successfully\n", node->name);
+
+	vfs_rcu_retire(&node->cold.rcu, vfs_node_reclaim);
+
+	deleted++;
+
+	if (MASKED_READ(flags, 0, 1) == 1) {
+		// Pin the parent before letting go of its lock, someone else pruning
+		// a sibling may otherwise delete it from under us
+		vfs_node_get(parent);
+		vfs_branch_unlock(parent);
+
+		node = parent;
+		flags |= 1 << 2;
+		goto top;
+	}
+
+	vfs_branch_unlock(parent);
+
+	return 0;
+}
+
+// Helpers of a deletion job that may be inside of it at once without sharing
+// a slot, must be a power of two
+#define ARC_VFS_DELETE_SLOTS 8
+
+struct ARC_VFSDeleteJob {
+	ARC_GenericSpinlock lock;
+	/// Every node of the subtree, pinned, in breadth first order.
+	struct ARC_VFSNode **nodes;
+	size_t count;
+	size_t capacity;
+	/// Index of the first node of each depth, and count at the end.
+	size_t *levels;
+	uint32_t level_count;
+	uint32_t level_capacity;
+	uint32_t flags;
+	/// Depth currently being deleted, negative once done.
+	int level;
+	/// Next node of the current depth to hand out.
+	size_t next;
+	/// Nodes of the current depth that have been dealt with.
+	size_t done;
+	size_t deleted;
+	/// Held by each thread inside of vfs_delete_job_run, picked by processor,
+	/// vfs_delete_job_destroy sleeps on them to wait for the helpers to leave.
+	ARC_GenericMutex helpers[ARC_VFS_DELETE_SLOTS];
+};
+
+static int vfs_delete_job_grow(void **array, size_t *capacity, size_t elem) {
+	size_t capacity_new = *capacity == 0 ? 64 : *capacity * 2;
+	void *array_new = alloc(capacity_new * elem);
+
+	if (array_new == NULL) {
+		return -1;
+	}
+
+	if (*array != NULL) {
+		memcpy(array_new, *array, *capacity * elem);
+		free(*array);
+	}
+
+	*array = array_new;
+	*capacity = capacity_new;
+
+	return 0;
+}
+
+static int vfs_delete_job_push(struct ARC_VFSDeleteJob *job, struct ARC_VFSNode *node) {
+	if (job->count == job->capacity && vfs_delete_job_grow((void **)&job->nodes, &job->capacity, sizeof(*job->nodes)) != 0) {
+		return -1;
+	}
+
+	job->nodes[job->count++] = node;
+
+	return 0;
+}
+
+static int vfs_delete_job_level(struct ARC_VFSDeleteJob *job, size_t start) {
+	if (job->level_count == job->level_capacity) {
+		size_t capacity = job->level_capacity;
+
+		if (vfs_delete_job_grow((void **)&job->levels, &capacity, sizeof(*job->levels)) != 0) {
+			return -1;
+		}
+
+		job->level_capacity = capacity;
+	}
+
+	job->levels[job->level_count++] = start;
+
+	return 0;
+}
+
+static void vfs_delete_job_free(struct ARC_VFSDeleteJob *job) {
+	free(job->nodes);
+	free(job->levels);
+	free(job);
+}
+
+struct ARC_VFSDeleteJob *vfs_delete_job_create(struct ARC_VFSNode *root, uint32_t flags) {
+	if (root == NULL) {
+		return NULL;
+	}
+
+	struct ARC_VFSDeleteJob *job = (struct ARC_VFSDeleteJob *)alloc(sizeof(*job));
+
+	if (job == NULL) {
+		return NULL;
+	}
+
+	memset(job, 0, sizeof(*job));
+	init_static_spinlock(&job->lock);
+
+	for (int i = 0; i < ARC_VFS_DELETE_SLOTS; i++) {
+		init_static_mutex(&job->helpers[i]);
+	}
+
+	// Every node carries a pin from here until its deletion is attempted
+	job->flags = (flags & ~1) | (1 << 2);
+
+	vfs_node_get(root);
+
+	int err = vfs_delete_job_push(job, root) | vfs_delete_job_level(job, 0);
+	size_t i = 0;
+
+	// NOTE: Breadth first, one lock per directory, so no depth of tree can
+	//       exhaust the stack
+	while (err == 0 && i < job->count) {
+		size_t level_end = job->count;
+
+		for (; err == 0 && i < level_end; i++) {
+			struct ARC_VFSNode *node = job->nodes[i];
+
+			if (node->type != ARC_VFS_N_DIR && node->type != ARC_VFS_N_MOUNT) {
+				continue;
+			}
+
+			vfs_branch_lock_shared(node);
+
+			for (struct ARC_VFSNode *child = node->children; child != NULL; child = child->next) {
+				vfs_node_get(child);
+
+				if ((err = vfs_delete_job_push(job, child)) != 0) {
+					vfs_node_put(child);
+					break;
+				}
+			}
+
+			vfs_branch_unlock_shared(node);
+		}
+
+		if (err == 0 && job->count > level_end) {
+			err = vfs_delete_job_level(job, level_end);
+		}
+	}
+
+	if (err == 0) {
+		err = vfs_delete_job_level(job, job->count);
+	}
+
+	if (err != 0) {
+		ARC_DEBUG(ERR, "Failed to allocate deletion of \"%s\" (%lu nodes)\n", root->name, job->count);
+
+		for (size_t j = 0; j < job->count; j++) {
+			vfs_node_put(job->nodes[j]);
+		}
+
+		vfs_delete_job_free(job);
+
+		return NULL;
+	}
+
+	// Deepest first, children go before their parents
+	job->level = job->level_count - 2;
+	job->next = job->levels[job->level];
+
+	return job;
+}
+
+// Delete a run of siblings under one hold of their parent's branch_lock,
+// every node carries a pin which is dropped. Where given, results[i] is set to
+// the outcome for nodes[i]
+static size_t vfs_delete_siblings(struct ARC_VFSNode *parent, struct ARC_VFSNode **nodes, size_t count, uint32_t flags, int *results) {
+	struct ARC_VFSNode *gone[ARC_VFS_DELETE_CHUNK];
+	bool physical = MASKED_READ(flags, 1, 1) == 1;
+	size_t n = 0;
+
+	if (parent == NULL) {
+		// The root cannot be deleted
+		for (size_t i = 0; i < count; i++) {
+			vfs_node_put(nodes[i]);
+
+			if (results != NULL) {
+				results[i] = -1;
+			}
+		}
+
+		return 0;
+	}
+
+	// Held until the drivers are done with the children
+	vfs_node_get(parent);
+
+	// Before parent is locked, see vfs_delete_node
+	bool percpu[ARC_VFS_DELETE_CHUNK];
+
+	for (size_t i = 0; i < count; i++) {
+		percpu[i] = vfs_node_ref_collapse(nodes[i]);
+	}
+
+	vfs_branch_lock(parent);
+	vfs_branch_write_begin(parent);
+
+	for (size_t i = 0; i < count; i++) {
+		struct ARC_VFSNode *node = nodes[i];
+
+		if ((node->mount == NULL && !physical) || node->parent != parent) {
+			// Memory-based, or renamed elsewhere since it was found
+			vfs_node_ref_restore(node, percpu[i]);
+			vfs_node_put(node);
+
+			if (results != NULL) {
+				results[i] = -3;
+			}
+
+			continue;
+		}
+
+		int err = vfs_delete_unlink(parent, node, flags, percpu[i]);
+
+		if (err == 0) {
+			gone[n++] = node;
+		}
+
+		if (results != NULL) {
+			results[i] = err;
+		}
+	}
+
+	vfs_branch_write_end(parent);
+	vfs_branch_unlock(parent);
+
+	// Nobody can find them anymore, the rest needs no lock
+	for (size_t i = 0; i < n; i++) {
+		vfs_delete_release(gone[i], flags);
+	}
+
+	if (physical && n > 0) {
+		char *paths[ARC_VFS_DELETE_CHUNK];
+		size_t path_count = 0;
+		struct ARC_Resource *res = NULL;
+
+		for (size_t i = 0; i < n; i++) {
+			if (gone[i]->mount == NULL) {
+				continue;
+			}
+
+			// NOTE: Siblings share a mount, and so the resource that removes them
+			res = vfs_delete_resource(parent, gone[i]);
+			char *path = vfs_delete_path(parent, gone[i]);
+
+			if (path != NULL) {
+				paths[path_count++] = path;
+			}
+		}
+
+		struct ARC_VFSDriverExt *ext = res == NULL ? NULL : vfs_driver_ext(res->driver);
+
+		if (ext != NULL && ext->remove_batch != NULL) {
+			// TODO: Consider if def->remove fails
+			ARC_VFS_TIMED(ARC_VFS_LAT_REMOVE, ext->remove_batch(res, paths, path_count));
+		} else {
+			for (size_t i = 0; i < path_count; i++) {
+				ARC_VFS_TIMED(ARC_VFS_LAT_REMOVE, res->driver->remove(res, paths[i]));
+			}
+		}
+
+		for (size_t i = 0; !vfs_node_own_resource(parent) && i < path_count; i++) {
+			free(paths[i]);
+		}
+	}
+
+	for (size_t i = 0; i < n; i++) {
+		vfs_rcu_retire(&gone[i]->cold.rcu, vfs_node_reclaim);
+	}
+
+	vfs_node_put(parent);
+
+	return n;
+}
+
+int vfs_delete_job_run(struct ARC_VFSDeleteJob *job) {
+	if (job == NULL) {
+		return -1;
+	}
+
+	// NOTE: Helpers that end up sharing a slot take turns
+	ARC_GenericMutex *slot = &job->helpers[vfs_current_cpu() & (ARC_VFS_DELETE_SLOTS - 1)];
+	mutex_lock(slot);
+
+	while (1) {
+		spinlock_lock(&job->lock);
+
+		if (job->level < 0) {
+			spinlock_unlock(&job->lock);
+			break;
+		}
+
+		size_t level_start = job->levels[job->level];
+		size_t level_end = job->levels[job->level + 1];
+
+		if (job->next >= level_end) {
+			// The rest of this depth is being worked on, the next depth
+			// has to wait for it. Whoever finishes it carries on with the
+			// next, so there is nothing left for this helper to do
+			spinlock_unlock(&job->lock);
+			break;
+		}
+
+		size_t start = job->next;
+		size_t end = min(start + ARC_VFS_DELETE_CHUNK, level_end);
+		job->next = end;
+
+		spinlock_unlock(&job->lock);
+
+		size_t deleted = 0;
+
+		for (size_t i = start; i < end;) {
+			// Siblings were found together, so they sit next to each other
+			struct ARC_VFSNode *parent = job->nodes[i]->parent;
+			size_t run = i + 1;
+
+			while (run < end && job->nodes[run]->parent == parent) {
+				run++;
+			}
+
+			deleted += vfs_delete_siblings(parent, &job->nodes[i], run - i, job->flags, NULL);
+			i = run;
+		}
+
+		spinlock_lock(&job->lock);
+
+		job->deleted += deleted;
+		job->done += end - start;
+
+		if (job->done == level_end - level_start) {
+			job->level--;
+			job->done = 0;
+
+			if (job->level >= 0) {
+				job->next = job->levels[job->level];
+			}
+		}
+
+		spinlock_unlock(&job->lock);
+	}
+
+	mutex_unlock(slot);
+
+	return 0;
+}
+
+size_t vfs_delete_job_destroy(struct ARC_VFSDeleteJob *job) {
+	if (job == NULL) {
+		return 0;
+	}
+
+	while (1) {
+		vfs_delete_job_run(job);
+
+		spinlock_lock(&job->lock);
+		int level = job->level;
+		spinlock_unlock(&job->lock);
+
+		// Sleep until every helper has left, the last depth may well be done
+		// by now, but its helpers could still be on their way out
+		for (int i = 0; i < ARC_VFS_DELETE_SLOTS; i++) {
+			mutex_lock(&job->helpers[i]);
+			mutex_unlock(&job->helpers[i]);
+		}
+
+		if (level < 0) {
+			break;
+		}
+
+		// NOTE: The helpers that were inside finished their runs, whatever
+		//       depth they did not get to is left for this thread
+	}
+
+	size_t left = job->count - job->deleted;
+
+	vfs_delete_job_free(job);
+
+	return left;
+}
+
+int vfs_delete_node_recursive(struct ARC_VFSNode *node, uint32_t flags) {
+	if (node == NULL) {
+		return -1;
+	}
+
+	void *parent = node->parent;
+
+	struct ARC_VFSDeleteJob *job = vfs_delete_job_create(node, flags);
+
+	if (job == NULL) {
+		return -2;
+	}
+
+	size_t left = vfs_delete_job_destroy(job);
+
+	if (left > 0) {
+		ARC_DEBUG(WARN, "%lu nodes of the tree could not be deleted\n", left);
+	}
+
+	vfs_delete_node(parent, flags);
+
+	return left > 0 ? -3 : 0;
+}
+
+size_t vfs_delete_children(struct ARC_VFSNode *parent, struct ARC_VFSNode **nodes, size_t count, uint32_t flags, int *results) {
+	if (nodes == NULL || results == NULL) {
+		return 0;
+	}
+
+	size_t deleted = 0;
+
+	for (size_t i = 0; i < count; i += ARC_VFS_DELETE_CHUNK) {
+		size_t run = min(count - i, ARC_VFS_DELETE_CHUNK);
+		deleted += vfs_delete_siblings(parent, &nodes[i], run, (flags & ~1) | (1 << 2), &results[i]);
+	}
+
+	return deleted;
+}
+
+struct ARC_VFSNode *vfs_create_node(struct ARC_VFSNode *parent, char *name, size_t name_len, struct ARC_VFSNodeInfo *info) {
+	if (parent == NULL || name == NULL || name_len == 0 || name_len > UINT16_MAX || info == NULL || info->type == ARC_VFS_NULL) {
+		ARC_DEBUG(ERR, "Failed to create node, improper parameters (%p %s %lu %d)\n", parent, name, name_len, info != NULL ? info->type : -1);
+		return NULL;
+	}
+
+	struct ARC_VFSNode *node = (struct ARC_VFSNode *)vfs_slab_alloc(&vfs_node_slab);
+
+	if (node == NULL) {
+		ARC_DEBUG(ERR, "Failed to allocate memory for new node (%.*s)\n", (uint32_t)name_len, name);
+		return NULL;
+	}
+
+	if (name_len <= ARC_VFS_INLINE_NAME) {
+		memcpy(node->name_inline, name, name_len);
+		node->name = node->name_inline;
+	} else {
+		node->name = strndup(name, name_len);
+	}
+
+	if (node->name == NULL) {
+		ARC_DEBUG(ERR, "Failed to allocate name for new node (%.*s)\n", (uint32_t)name_len, name);
+		vfs_slab_free(&vfs_node_slab, node);
+		return NULL;
+	}
+
+	node->name_len = name_len;
+	node->name_hash = vfs_name_hash(node->name, name_len);
+
+	node->id = ARC_ATOMIC_INC(vfs_node_id_counter);
+	node->type = info->type;
+
+	node->mount = (parent->type == ARC_VFS_N_MOUNT) ? parent : parent->mount;
+
+	if (info->resource_overwrite != NULL) {
+		node->resource = info->resource_overwrite;
+	} else if (info->driver_index == ARC_VFS_TMPFS_DRIVER) {
+		if (vfs_tmpfs_create(node) != 0) {
+			if (node->name != node->name_inline) {
+				free(node->name);
+			}
+
+			vfs_slab_free(&vfs_node_slab, node);
+			return NULL;
+		}
+	} else {
+		node->resource = init_resource(info->driver_index, info->driver_arg);
+	}
+
+	// NOTE: It is expected that the caller has locked the parent node's branch_lock
+	vfs_branch_write_begin(parent);
+	vfs_attach_node(parent, node);
+	vfs_branch_write_end(parent);
+
+	// NOTE: Nodes with a resource only have their type here until something
+	//       asks for the rest, see vfs_node_stat
+	node->cold.stat.st_mode = (info->mode & 00777) | vfs_type2stat(info->type);
+
+	return node;
+}
+
+// Take stat as the attributes of node, as fetched from its driver just now
+static void vfs_node_stat_seed(struct ARC_VFSNode *node, struct stat *stat) {
+	mutex_lock(&node->cold.property_lock);
+
+	if (node->cold.pcache != NULL && node->cold.stat.st_size > stat->st_size) {
+		// Writes that are still only in the page cache
+		stat->st_size = node->cold.stat.st_size;
+	}
+
+	memcpy(&node->cold.stat, stat, sizeof(*stat));
+	__atomic_store_n(&node->cold.stat_stamp, max(vfs_cpu_clock(), 1), __ATOMIC_RELEASE);
+
+	mutex_unlock(&node->cold.property_lock);
+}
+
+int vfs_node_stat(struct ARC_VFSNode *node, struct stat *stat) {
+	if (node == NULL) {
+		return -1;
+	}
+
+	struct ARC_Resource *res = node->resource;
+	uint64_t stamp = __atomic_load_n(&node->cold.stat_stamp, __ATOMIC_ACQUIRE);
+
+	if (res != NULL && (stamp == 0 || vfs_cpu_clock() - stamp >= vfs_mount_attr_ttl(node))) {
+		struct stat fresh = { 0 };
+
+		if (ARC_VFS_TIMED(ARC_VFS_LAT_STAT, res->driver->stat(res, NULL, &fresh)) != 0) {
+			return -2;
+		}
+
+		vfs_node_stat_seed(node, &fresh);
+		vfs_stats_count(ARC_VFS_STAT_ATTR_MISS);
+	} else {
+		vfs_stats_count(ARC_VFS_STAT_ATTR_HIT);
+	}
+
+	if (stat != NULL) {
+		mutex_lock(&node->cold.property_lock);
+		memcpy(stat, &node->cold.stat, sizeof(*stat));
+		mutex_unlock(&node->cold.property_lock);
+	}
+
+	return 0;
+}
+
+void vfs_node_stat_invalidate(struct ARC_VFSNode *node) {
+	if (node == NULL) {
+		return;
+	}
+
+	__atomic_store_n(&node->cold.stat_stamp, 0, __ATOMIC_RELEASE);
+}
+
+// Write the path from a down to b into buf, returns its length or -1 if b is not
+// below a. Nothing is written unless it fits within size
+// NOTE: Names are freed through RCU on rename, the caller must be in a read section
+static long vfs_path_between(struct ARC_VFSNode *a, struct ARC_VFSNode *b, char *buf, size_t size) {
+	size_t len = 0;
+	struct ARC_VFSNode *node = b;
+
+	for (; node != a; node = node->parent) {
+		if (node == NULL) {
+			return -1;
+		}
+
+		len += strlen(node->name) + (node != b);
+	}
+
+	if (buf == NULL || len >= size) {
+		return len;
+	}
+
+	buf[len] = 0;
+	size_t pos = len;
+
+	for (node = b; node != a; node = node->parent) {
+		size_t name_len = strlen(node->name);
+
+		if (name_len + (node != b) > pos) {
+			// Renamed in between
+			return -1;
+		}
+
+		if (node != b) {
+			buf[--pos] = '/';
+		}
+
+		pos -= name_len;
+		memcpy(buf + pos, node->name, name_len);
+	}
+
+	return pos == 0 ? (long)len : -1;
+}
+
+static void vfs_path_builder_fini(struct vfs_path_builder *path) {
+	if (path != NULL && path->buf != NULL && path->buf != path->inline_buf) {
+		free(path->buf);
+	}
+}
+
+static int vfs_path_builder_reserve(struct vfs_path_builder *path, size_t size) {
+	if (size <= path->cap) {
+		return 0;
+	}
+
+	size_t cap = path->cap;
+	while (cap < size) {
+		cap *= 2;
+	}
+
+	char *buf = (char *)alloc(cap);
+
+	if (buf == NULL) {
+		path->broken = 1;
+		return -1;
+	}
+
+	memcpy(buf, path->buf, path->len + 1);
+	vfs_path_builder_fini(path);
+
+	path->buf = buf;
+	path->cap = cap;
+
+	return 0;
+}
+
+// Start over from base, paths under a mountpoint start with its prefix
+static void vfs_path_builder_reset(struct vfs_path_builder *path, struct ARC_VFSNode *base) {
+	if (path == NULL) {
+		return;
+	}
+
+	if (path->buf == NULL) {
+		path->buf = path->inline_buf;
+		path->cap = ARC_VFS_PATH_INLINE;
+	}
+
+	path->base = base;
+	path->len = 0;
+	path->broken = 0;
+	path->buf[0] = 0;
+
+	if (base == NULL || base->type != ARC_VFS_N_MOUNT) {
+		return;
+	}
+
+	size_t prefix = vfs_mount_prefix(base, path->buf, path->cap);
+
+	if (prefix >= path->cap && (vfs_path_builder_reserve(path, prefix + 1) != 0
+	    || vfs_mount_prefix(base, path->buf, path->cap) != prefix)) {
+		path->broken = 1;
+		return;
+	}
+
+	path->len = prefix;
+}
+
+// Append comp, returns where it starts within the path
+static char *vfs_path_builder_push(struct vfs_path_builder *path, char *comp, size_t comp_len) {
+	if (path == NULL || path->broken) {
+		return NULL;
+	}
+
+	size_t sep = path->len > 0;
+
+	if (vfs_path_builder_reserve(path, path->len + sep + comp_len + 1) != 0) {
+		return NULL;
+	}
+
+	if (sep) {
+		path->buf[path->len++] = '/';
+	}
+
+	char *ret = path->buf + path->len;
+	memcpy(ret, comp, comp_len);
+	path->len += comp_len;
+	path->buf[path->len] = 0;
+
+	return ret;
+}
+
+static void vfs_path_builder_truncate(struct vfs_path_builder *path, size_t len) {
+	path->len = len;
+	path->buf[len] = 0;
+}
+
+// Drop the last component
+static void vfs_path_builder_pop(struct vfs_path_builder *path) {
+	if (path == NULL) {
+		return;
+	}
+
+	size_t len = path->len;
+	while (len > 0 && path->buf[len - 1] != '/') {
+		len--;
+	}
+
+	vfs_path_builder_truncate(path, len > 0 ? len - 1 : 0);
+}
+
+// Make the path relative to mount rather than to wherever the walk started
+static int vfs_path_builder_anchor(struct vfs_path_builder *path, struct ARC_VFSNode *mount) {
+	if (path->broken) {
+		return -1;
+	}
+
+	if (path->base == mount) {
+		return 0;
+	}
+
+	uint32_t token = vfs_rcu_read_lock();
+	long between = vfs_path_between(mount, path->base, NULL, 0);
+	size_t seed = vfs_mount_prefix(mount, NULL, 0);
+	// The mount's own prefix comes first
+	size_t seed_sep = seed > 0 && between > 0;
+	long prefix = between < 0 ? -1 : (long)(seed + seed_sep) + between;
+
+	if (prefix < 0 || vfs_path_builder_reserve(path, prefix + 1 + path->len + 1) != 0) {
+		vfs_rcu_read_unlock(token);
+		path->broken = 1;
+		return -1;
+	}
+
+	if (prefix > 0) {
+		size_t sep = path->len > 0;
+		memmove(path->buf + prefix + sep, path->buf, path->len + 1);
+
+		// NOTE: Each copy terminates, the terminator is overwritten by what
+		//       follows it, or is the end of the path
+		if (vfs_mount_prefix(mount, path->buf, seed + 1) != seed
+		    || vfs_path_between(mount, path->base, path->buf + seed + seed_sep, between + 1) != between) {
+			vfs_rcu_read_unlock(token);
+			path->broken = 1;
+			return -1;
+		}
+
+		if (seed_sep) {
+			path->buf[seed] = '/';
+		}
+
+		if (sep) {
+			path->buf[prefix] = '/';
+		}
+
+		path->len += prefix + sep;
+	}
+
+	vfs_rcu_read_unlock(token);
+	path->base = mount;
+
+	return 0;
+}
+
+// Terminated path of args->comp for the driver of res, which is either the
+// resource of args->node or that of mount. *mark is what to truncate back to
+static char *vfs_callback_path(struct callback_args *args, struct ARC_VFSNode *mount, size_t *mark) {
+	struct vfs_path_builder *path = args->path;
+
+	int own = vfs_node_own_resource(args->node);
+
+	if (path == NULL || (!own && vfs_path_builder_anchor(path, mount) != 0)) {
+		return NULL;
+	}
+
+	*mark = path->len;
+	char *comp = vfs_path_builder_push(path, args->comp, args->comp_len);
+
+	if (comp == NULL) {
+		return NULL;
+	}
+
+	return own ? comp : path->buf;
+}
+
+static char *vfs_path_get_next_component(char *path, uint32_t *is_last) {
+	if (path == NULL || is_last == NULL)  {
+		return NULL;
+	}
+
+	if (*path == 0) {
+		return NULL;
+	}
+
+	char *ret = path;
+
+	if (*ret == '/') {
+		ret++;
+	}
+
+	while (*ret != 0 && *ret != '/') {
+		ret++;
+	}
+
+	if (*ret == 0) {
+		*is_last = 1;
+	}
+
+	return ret;
+}
+
+// Note: This can probably just be merged with the internal traverse function
+static char *vfs_read_link(struct ARC_VFSNode *link) {
+	if (link == NULL || link->type != ARC_VFS_N_LINK) {
+		ARC_DEBUG(ERR, "Cannot resolve link, improper parameters (%p, %d)\n", link, link == NULL ? ARC_VFS_NULL : link->type);
+		return NULL;
+	}
+
+	if (link->link != NULL) {
+		// No need to resolve it, as it is already resolved
+		return NULL;
+	}
+
+	if (vfs_node_stat(link, NULL) != 0 || link->cold.stat.st_size == 0) {
+		ARC_DEBUG(WARN, "Not resolving link of zero bytes\n");
+		return NULL;
+	}
+
+	// NOTE: The contents are not terminated on disk
+	char *path = (char *)alloc(link->cold.stat.st_size + 1);
+
+	if (path == NULL) {
+		ARC_DEBUG(ERR, "Cannot allocate return buffer for link resolution\n");
+		return NULL;
+	}
+
+	path[link->cold.stat.st_size] = 0;
+
+	struct ARC_File fake = { .mode = ARC_STD_PERM, .node = link };
+
+	if (vfs_read(path, 1, link->cold.stat.st_size, &fake) != (size_t)link->cold.stat.st_size) {
+		ARC_DEBUG(ERR, "Failed to read in link\n");
+		free(path);
+		return NULL;
+	}
+
+	if (*path == 0) {
+		ARC_DEBUG(ERR, "Link path terminates early\n");
+		free(path);
+		return NULL;
+	}
+
+	return path;
+}
+
+// Remember that a link resolution went through node, and the gen it had then
+static void vfs_link_trail_add(struct ARC_VFSLinkCache *trail, struct ARC_VFSNode *node) {
+	if (trail == NULL || (trail->count > 0 && trail->nodes[trail->count - 1] == node)) {
+		return;
+	}
+
+	if (trail->count >= ARC_VFS_LINK_TRAIL) {
+		trail->overflow = 1;
+		return;
+	}
+
+	trail->nodes[trail->count] = node;
+	trail->gens[trail->count] = __atomic_load_n(&node->gen, __ATOMIC_ACQUIRE);
+	trail->count++;
+}
+
+// Walk filepath from start without resolving links, *end is set to the last node
+// found (with a reference held) and *upto to the first unresolved component. Every
+// node stood on is added to trail, if it is given
+static void internal_vfs_walk(char *filepath, struct ARC_VFSNode *start, uint32_t flags, struct ARC_VFSNode **end, char **upto,
+			      struct ARC_VFSNode *(*callback)(struct callback_args *args),
+			      void *caller_args, struct ARC_VFSLinkCache *trail) {
+	// Flags:
+	//  Bit | Description
+	//  1   | 1: Ignore last component
+	struct ARC_VFSNode *node = start;
+	vfs_node_get(node);
+	vfs_link_trail_add(trail, node);
+
+	struct ARC_VFSNode *next = NULL;
+
+	// NOTE: Only the callbacks hand paths to drivers
+	struct vfs_path_builder builder = { 0 };
+	struct vfs_path_builder *path = callback != NULL ? &builder : NULL;
+	vfs_path_builder_reset(path, node);
+
+	uint32_t is_last = 0;
+	char *comp_base = *filepath == '/' ? filepath + 1 : filepath;
+	char *comp_end = vfs_path_get_next_component(comp_base, &is_last);
+	size_t comp_len = (size_t)comp_end - (size_t)comp_base;
+
+	struct callback_args args = {
+	        .caller_args = caller_args,
+		.comp = comp_base,
+		.comp_len = comp_len,
+		.path = path,
+		.node = node,
+        };
+
+	while (comp_end != NULL) {
+		if (MASKED_READ(flags, 1, 1) == 1 && is_last == 1) {
+			break;
+		}
+
+		if (node->type == ARC_VFS_N_MOUNT) {
+			vfs_path_builder_reset(path, node);
+		}
+
+		if (comp_len == 2 && comp_base[0] == '.' && comp_base[1] == '.') {
+			// NOTE: ".." of the root is the root itself
+			next = node->parent != NULL ? node->parent : node;
+
+			if (next == node) {
+				// Nothing to take off the path either
+			} else if (path != NULL && node == path->base) {
+				vfs_path_builder_reset(path, next);
+			} else {
+				vfs_path_builder_pop(path);
+			}
+
+			goto next_iter;
+		} else if (comp_len == 1 && comp_base[0] == '.') {
+			next = node;
+			goto next_iter;
+		}
+
+		// NOTE: The lockless lookup only fails on a true miss or a concurrent
+		//       modification of the directory, in the latter case the cache
+		//       may still be able to answer without the branch_lock
+		// Hashed once, every lookup of the component below reuses it
+		uint32_t comp_hash = vfs_name_hash(comp_base, comp_len);
+		args.comp_hash = comp_hash;
+
+		next = vfs_lookup_child_lockless(node, comp_base, comp_len, comp_hash);
+
+		if (next != NULL || vfs_dcache_lookup(node, comp_base, comp_len, comp_hash, &next) == ARC_VFS_DCACHE_HIT) {
+			// The reference on next has already been taken
+			vfs_stats_count(ARC_VFS_STAT_LOOKUP_HIT);
+			vfs_node_put(node);
+			node = next;
+			vfs_path_builder_push(path, comp_base, comp_len);
+			goto next_comp;
+		}
+
+		vfs_branch_lock_shared(node);
+
+		next = vfs_lookup_child_hash(node, comp_base, comp_len, comp_hash);
+		vfs_stats_count(next != NULL ? ARC_VFS_STAT_LOOKUP_HIT : ARC_VFS_STAT_LOOKUP_MISS);
+		bool exclusive = false;
+
+		if (callback != NULL && next == NULL) {
+			// The callback adds to the children, which needs the lock to
+			// itself. Someone may have added the node in between
+			vfs_branch_unlock_shared(node);
+			vfs_branch_lock(node);
+			exclusive = true;
+
+			next = vfs_lookup_child_hash(node, comp_base, comp_len, comp_hash);
+
+			if (next == NULL) {
+				next = callback(&args);
+			}
+		}
+
+		if (next != NULL) {
+			vfs_dcache_insert(node, comp_base, comp_len, comp_hash, next);
+			// NOTE: The reference must be taken before the branch_lock is
+			//       released, otherwise next could be deleted in between
+			vfs_node_get(next);
+		}
+
+		if (exclusive) {
+			vfs_branch_unlock(node);
+		} else {
+			vfs_branch_unlock_shared(node);
+		}
+
+		if (next == NULL) {
+			ARC_VFS_TRACE_PATH("Quiting traversal of %s, no next node found\n", filepath);
+			break;
+		}
+
+		vfs_node_put(node);
+		node = next;
+		vfs_path_builder_push(path, comp_base, comp_len);
+		goto next_comp;
+
+	        next_iter:;
+
+		if (next != node) {
+			vfs_node_get(next);
+			vfs_node_put(node);
+			node = next;
+		}
+
+	        next_comp:;
+
+		vfs_link_trail_add(trail, node);
+
+		comp_base = *comp_end == '/' ? comp_end + 1 : comp_end; // Skip over /
+		comp_end = vfs_path_get_next_component(comp_base, &is_last);
+		comp_len = (size_t)comp_end - (size_t)comp_base;
+
+		args.comp = comp_base;
+		args.comp_len = comp_len;
+		args.node = node;
+
+		next = NULL;
+	}
+
+	vfs_path_builder_fini(path);
 
-	struct ARC_VFSNode *mount = args->node->mount;
-	if (args->node->type == ARC_VFS_N_MOUNT) {
-		mount = args->node;
+	*end = node;
+	*upto = comp_base;
+}
+
+// Take a reference on the target of link's last resolution, if none of the nodes
+// it went through has changed since
+static struct ARC_VFSNode *vfs_link_cache_get(struct ARC_VFSNode *link) {
+	// NOTE: Nodes are only reclaimed once every reader is done, so the ones
+	//       in the cache can be looked at even if they have since been deleted
+	uint32_t token = vfs_rcu_read_lock();
+	struct ARC_VFSLinkCache *cache = __atomic_load_n(&link->link_cache, __ATOMIC_ACQUIRE);
+	struct ARC_VFSNode *target = NULL;
+
+	if (cache == NULL) {
+		goto out;
+	}
+
+	for (uint32_t i = 0; i < cache->count; i++) {
+		if (__atomic_load_n(&cache->nodes[i]->gen, __ATOMIC_ACQUIRE) != cache->gens[i]) {
+			goto out;
+		}
+	}
+
+	target = cache->nodes[cache->count - 1];
+	vfs_node_get_rcu(target);
+
+	// NOTE: vfs_delete_unlink changes gen before it looks at ref_count, so
+	//       either it sees this reference or this sees the new gen
+	if (__atomic_load_n(&target->gen, __ATOMIC_SEQ_CST) != cache->gens[cache->count - 1]) {
+		vfs_node_put(target);
+		target = NULL;
+	}
+
+	out:;
+	vfs_rcu_read_unlock(token);
+
+	return target;
+}
+
+// Resolve the chain of links starting at *link. On success *link is replaced by the
+// final target, the reference held on the link is moved over to it
+static int vfs_resolve_link(struct ARC_VFSNode **link, struct ARC_VFSNode *(*callback)(struct callback_args *args),
+			    void *caller_args) {
+	struct ARC_VFSNode *first = *link;
+
+	if (first->type == ARC_VFS_N_LINK && first->link == NULL) {
+		vfs_node_stat(first, NULL);
+	}
+
+	if (first->type != ARC_VFS_N_LINK || (first->link == NULL && first->cold.stat.st_size == 0)) {
+		// Not a link, or still being created
+		return ARC_VFS_PATH_RESOLVED;
+	}
+
+	struct ARC_VFSNode *node = vfs_link_cache_get(first);
+
+	if (node != NULL) {
+		vfs_node_put(first);
+		*link = node;
+
+		return ARC_VFS_PATH_RESOLVED;
+	}
+
+	// NOTE: Anything attached or detached during the resolution could have been
+	//       seen with its gen from either side, such a trail is not kept
+	uint64_t gen = __atomic_load_n(&vfs_gen_counter, __ATOMIC_ACQUIRE);
+	struct ARC_VFSLinkCache *trail = (struct ARC_VFSLinkCache *)alloc(sizeof(*trail));
+
+	if (trail != NULL) {
+		memset(trail, 0, sizeof(*trail));
+	}
+
+	int ret = ARC_VFS_PATH_RESOLVED;
+	node = first;
+	vfs_node_get(node);
+	vfs_link_trail_add(trail, node);
+
+	for (int depth = 0; node->type == ARC_VFS_N_LINK; depth++) {
+		if (depth >= ARC_VFS_MAX_LINK_DEPTH) {
+			ARC_DEBUG(ERR, "Too many levels of links resolving \"%s\"\n", first->name);
+			ret = ARC_VFS_PATH_LOOP;
+			break;
+		}
+
+		if (node->link != NULL) {
+			// Made by vfs_link, which keeps a reference on the target
+			struct ARC_VFSNode *target = node->link;
+			vfs_node_get(target);
+			vfs_node_put(node);
+			node = target;
+			vfs_link_trail_add(trail, node);
+
+			continue;
+		}
+
+		char *target_path = vfs_read_link(node);
+
+		if (target_path == NULL) {
+			ret = ARC_VFS_PATH_BROKEN;
+			break;
+		}
+
+		struct ARC_VFSNode *target = NULL;
+		char *upto = NULL;
+		internal_vfs_walk(target_path, node->parent, 0, &target, &upto, callback, caller_args, trail);
+
+		bool broken = *upto != 0;
+		free(target_path);
+
+		vfs_node_put(node);
+		node = target;
+
+		if (broken) {
+			ARC_DEBUG(ERR, "Broken link \"%s\"\n", first->name);
+			ret = ARC_VFS_PATH_BROKEN;
+			break;
+		}
+	}
+
+	if (ret != ARC_VFS_PATH_RESOLVED) {
+		vfs_node_put(node);
+
+		if (trail != NULL) {
+			free(trail);
+		}
+
+		return ret;
+	}
+
+	if (trail != NULL && trail->overflow == 0 && __atomic_load_n(&vfs_gen_counter, __ATOMIC_ACQUIRE) == gen) {
+		struct ARC_VFSLinkCache *old = __atomic_exchange_n(&first->link_cache, trail, __ATOMIC_ACQ_REL);
+
+		if (old != NULL) {
+			vfs_rcu_free(old);
+		}
+	} else if (trail != NULL) {
+		free(trail);
+	}
+
+	vfs_node_put(first);
+	*link = node;
+
+	return ret;
+}
+
+static int internal_vfs_traverse(char *filepath, struct ARC_VFSNode *start, uint32_t flags, struct ARC_VFSNode **end,
+				 struct ARC_VFSPathSpan *upto, struct ARC_VFSNode *(*callback)(struct callback_args *args),
+				 void *caller_args) {
+	// Flags:
+	//  Bit | Description
+	//  0   | 1: Resolve links
+	//  1   | 1: Ignore last component
+	if (filepath == NULL || start == NULL) {
+		return -1;
+	}
+
+	struct ARC_VFSNode *node = NULL;
+	char *rem = NULL;
+	internal_vfs_walk(filepath, start, flags, &node, &rem, callback, caller_args, NULL);
+
+	int ret = ARC_VFS_PATH_RESOLVED;
+
+	if (*rem != 0) {
+		ret = ARC_VFS_PATH_PARTIAL;
+	} else if (MASKED_READ(flags, 0, 1) == 1) {
+		// NOTE: Links are only followed once the whole path has been consumed,
+		//       this keeps the remainder within the caller's buffer
+		ret = vfs_resolve_link(&node, callback, caller_args);
+	}
+
+	if (upto != NULL) {
+		upto->offset = (uintptr_t)rem - (uintptr_t)filepath;
+		upto->length = ret == ARC_VFS_PATH_PARTIAL ? strlen(rem) : 0;
+	}
+
+	if (end != NULL) {
+		*end = node;
+	} else {
+		vfs_node_put(node);
+	}
+
+	return ret;
+}
+
+static struct ARC_VFSNode *callback_vfs_create_filepath(struct callback_args *args) {
+	if (args->node == NULL || args->comp == NULL || args->comp_len == 0 || args->caller_args == NULL) {
+		ARC_DEBUG(ERR, "Quiting create callback, improper parameters (%p %s %lu %p)\n", args->node, args->comp, args->comp_len, args->caller_args);
+		return NULL;
 	}
 
+	struct ARC_VFSNodeInfo local_info = { .type = ARC_VFS_N_DIR, .driver_index = (uint64_t)-1 };
+	struct ARC_VFSNodeInfo *info = (struct ARC_VFSNodeInfo *)args->caller_args;
+
+	struct ARC_VFSNode *mount = args->node->type == ARC_VFS_N_MOUNT ? args->node : args->node->mount;
+	struct ARC_Resource *mount_res = vfs_mount_resource(args->node);
+
 	if (args->comp[args->comp_len] != 0) {
 		info = &local_info;
 	}
 
-	vfs_infer_driver(mount, info);
+	vfs_infer_driver(mount_res, info);
 
-	if (mount != NULL) {
-		struct ARC_Resource *res = NULL;
-		char *use_path = NULL;
+	if (mount_res != NULL) {
+		struct ARC_Resource *res = vfs_node_own_resource(args->node) ? args->node->resource : mount_res;
+		size_t mark = 0;
+		char *use_path = vfs_callback_path(args, mount, &mark);
 
-		if (args->node->resource != NULL) {
-			res = args->node->resource;
-			use_path = strndup(args->comp, args->comp_len);
-		} else {
-			res = mount->resource;
-			use_path = strndup(args->mount_path, (uintptr_t)args->comp - (uintptr_t)args->mount_path + args->comp_len);
+		if (use_path == NULL) {
+			ARC_DEBUG(ERR, "Failed to build path of %.*s\n", (uint32_t)args->comp_len, args->comp);
+			return NULL;
 		}
 
-		if (res->driver->create(res, use_path, info->mode, info->type) != 0) {
-			free(use_path);
+		int err = ARC_VFS_TIMED(ARC_VFS_LAT_CREATE, res->driver->create(res, use_path, info->mode, info->type));
+		vfs_path_builder_truncate(args->path, mark);
+
+		if (err != 0) {
 			return NULL;
 		}
-
-		free(use_path);
 	}
 
 	return vfs_create_node(args->node, args->comp, args->comp_len, info);
 }
 
-char *vfs_create_filepath(char *filepath, struct ARC_VFSNode *start, uint32_t flags, struct ARC_VFSNodeInfo *info, struct ARC_VFSNode **end) {
+int vfs_create_filepath(char *filepath, struct ARC_VFSNode *start, uint32_t flags, struct ARC_VFSNodeInfo *info, struct ARC_VFSNode **end, struct ARC_VFSPathSpan *upto) {
 	if (filepath == NULL || start == NULL || info == NULL) {
 		ARC_DEBUG(ERR, "Cannot create %s, imporper parameters (%p %p)\n", filepath, start ,info);
-		return NULL;
+		return -1;
+	}
+
+	ARC_VFS_TRACE_PATH("Creating %s\n", filepath);
+
+	return internal_vfs_traverse(filepath, start, flags | 1, end, upto, callback_vfs_create_filepath, (void *)info);
+}
+
+// Whether a name is "." or "..", which walks never look up as children
+static int vfs_name_is_dot(char *name, size_t len) {
+	return (len == 1 && name[0] == '.') || (len == 2 && name[0] == '.' && name[1] == '.');
+}
+
+size_t vfs_create_children(struct ARC_VFSNode *parent, char **names, struct ARC_VFSNodeInfo **infos, size_t count, int *results, struct ARC_VFSNode **nodes) {
+	if (parent == NULL || names == NULL || infos == NULL || results == NULL) {
+		return 0;
+	}
+
+	struct ARC_Resource *mount_res = vfs_mount_resource(parent);
+	int own = vfs_node_own_resource(parent);
+	struct ARC_Resource *res = own ? parent->resource : mount_res;
+	struct ARC_VFSDriverExt *ext = res == NULL ? NULL : vfs_driver_ext(res->driver);
+
+	// Children are given to the driver as the parent's path with their name appended
+	char *base = NULL;
+	size_t base_len = 0;
+
+	if (mount_res != NULL && !own) {
+		base = vfs_get_mount_path(parent);
+
+		if (base == NULL) {
+			for (size_t i = 0; i < count; i++) {
+				results[i] = -2;
+			}
+
+			return 0;
+		}
+
+		base_len = strlen(base);
+	}
+
+	size_t created = 0;
+
+	vfs_branch_lock(parent);
+
+	for (size_t i = 0; i < count; i += ARC_VFS_CREATE_CHUNK) {
+		size_t run = min(count - i, ARC_VFS_CREATE_CHUNK);
+		char *paths[ARC_VFS_CREATE_CHUNK];
+		struct ARC_VFSNodeInfo *pending_infos[ARC_VFS_CREATE_CHUNK];
+		int driver_results[ARC_VFS_CREATE_CHUNK];
+		size_t pending[ARC_VFS_CREATE_CHUNK];
+		size_t n = 0;
+
+		for (size_t j = i; j < i + run; j++) {
+			size_t len = strlen(names[j]);
+			results[j] = 0;
+
+			if (nodes != NULL) {
+				nodes[j] = NULL;
+			}
+
+			if (len == 0 || vfs_name_is_dot(names[j], len) || memchr(names[j], '/', len) != NULL) {
+				results[j] = -1;
+				continue;
+			}
+
+			struct ARC_VFSNode *existing = vfs_lookup_child(parent, names[j], len);
+
+			if (existing != NULL) {
+				// Already there, just as a walk would have found it
+				if (nodes != NULL) {
+					vfs_node_get(existing);
+					nodes[j] = existing;
+				}
+
+				continue;
+			}
+
+			vfs_infer_driver(mount_res, infos[j]);
+
+			char *path = NULL;
+
+			if (mount_res != NULL) {
+				path = own ? names[j] : (char *)alloc(base_len + 1 + len + 1);
+
+				if (path == NULL) {
+					results[j] = -2;
+					continue;
+				}
+
+				if (!own) {
+					size_t sep = base_len > 0;
+					memcpy(path, base, base_len);
+					path[base_len] = '/';
+					memcpy(path + base_len + sep, names[j], len + 1);
+				}
+			}
+
+			paths[n] = path;
+			pending_infos[n] = infos[j];
+			driver_results[n] = 0;
+			pending[n++] = j;
+		}
+
+		if (mount_res != NULL && n > 0) {
+			if (ext != NULL && ext->create_batch != NULL) {
+				ARC_VFS_TIMED(ARC_VFS_LAT_CREATE, ext->create_batch(res, paths, pending_infos, driver_results, n));
+			} else {
+				for (size_t k = 0; k < n; k++) {
+					driver_results[k] = ARC_VFS_TIMED(ARC_VFS_LAT_CREATE, res->driver->create(res, paths[k], pending_infos[k]->mode, pending_infos[k]->type));
+				}
+			}
+		}
+
+		for (size_t k = 0; k < n; k++) {
+			size_t j = pending[k];
+
+			if (paths[k] != NULL && !own) {
+				free(paths[k]);
+			}
+
+			if (driver_results[k] != 0) {
+				results[j] = -3;
+				continue;
+			}
+
+			size_t len = strlen(names[j]);
+			struct ARC_VFSNode *node = vfs_lookup_child(parent, names[j], len);
+
+			if (node != NULL) {
+				// Named twice in one batch
+				if (nodes != NULL) {
+					vfs_node_get(node);
+					nodes[j] = node;
+				}
+
+				continue;
+			}
+
+			node = vfs_create_node(parent, names[j], len, infos[j]);
+
+			if (node == NULL) {
+				results[j] = -4;
+				continue;
+			}
+
+			if (nodes != NULL) {
+				vfs_node_get(node);
+				nodes[j] = node;
+			}
+
+			created++;
+		}
+	}
+
+	vfs_branch_unlock(parent);
+
+	if (base != NULL) {
+		free(base);
+	}
+
+	return created;
+}
+
+struct vfs_populate_args {
+	struct ARC_VFSNode *dir;
+	struct ARC_Resource *mount;
+	size_t count;
+};
+
+static int vfs_populate_emit(void *ctx, char *name, size_t name_len, struct stat *stat, void *locate) {
+	struct vfs_populate_args *args = (struct vfs_populate_args *)ctx;
+
+	if (name == NULL || name_len == 0 || stat == NULL) {
+		return -1;
+	}
+
+	if (vfs_name_is_dot(name, name_len)) {
+		return 0;
+	}
+
+	if (vfs_lookup_child(args->dir, name, name_len) != NULL) {
+		// Loaded before
+		return 0;
+	}
+
+	struct ARC_VFSNodeInfo info = { .driver_index = (uint64_t)-1, .type = vfs_mode2type(stat->st_mode) };
+	vfs_infer_driver(args->mount, &info);
+	info.driver_arg = locate;
+
+	struct ARC_VFSNode *node = vfs_create_node(args->dir, name, name_len, &info);
+
+	if (node == NULL) {
+		return -2;
+	}
+
+	// The directory listing already holds what the node's own driver would say
+	vfs_node_stat_seed(node, stat);
+
+	// Nobody has it open, so it can be evicted like any other idle node
+	vfs_ncache_park(node);
+	args->count++;
+
+	return 0;
+}
+
+// Create a node for every entry of dir, which is at path (NULL for the root of res)
+// NOTE: It is expected that the caller has locked dir's branch_lock
+static int vfs_populate_directory(struct ARC_VFSNode *dir, struct ARC_Resource *mount, struct ARC_Resource *res, char *path, struct ARC_VFSDriverExt *ext) {
+	char *dir_path = path == NULL ? "" : path;
+	struct vfs_populate_args args = { .dir = dir, .mount = mount, .count = 0 };
+	int ret = ext->readdir(res, dir_path, vfs_populate_emit, &args);
+
+	if (ret == 0) {
+		dir->cold.populated = 1;
+	} else {
+		// Whatever was loaded is still correct, but misses must ask the driver
+		ARC_DEBUG(ERR, "Failed to list \"%s\" (%d), loaded %lu entries\n", dir_path, ret, args.count);
+	}
+
+	return ret;
+}
+
+int vfs_populate_node(struct ARC_VFSNode *dir) {
+	if (dir == NULL || (dir->type != ARC_VFS_N_DIR && dir->type != ARC_VFS_N_MOUNT)) {
+		return -1;
+	}
+
+	struct ARC_Resource *mount = vfs_mount_resource(dir);
+
+	if (mount == NULL) {
+		// Memory-based directories only exist as nodes
+		return 0;
+	}
+
+	// Directories without their own resource are listed by the mount's driver
+	int own = vfs_node_own_resource(dir);
+	struct ARC_Resource *res = own ? dir->resource : mount;
+	struct ARC_VFSDriverExt *ext = vfs_driver_ext(res->driver);
+
+	if (ext == NULL || ext->readdir == NULL) {
+		return 0;
+	}
+
+	char *path = NULL;
+
+	if (!own && (path = vfs_get_mount_path(dir)) == NULL) {
+		return -2;
+	}
+
+	vfs_branch_lock(dir);
+
+	int ret = 0;
+	if (!dir->cold.populated) {
+		ret = vfs_populate_directory(dir, mount, res, path, ext);
 	}
 
-	ARC_DEBUG(INFO, "Creating %s\n", filepath);
+	vfs_branch_unlock(dir);
 
-	return internal_vfs_traverse(filepath, start, flags | 1, end, callback_vfs_create_filepath, (void *)info);
+	if (path != NULL) {
+		free(path);
+	}
+
+	return ret;
 }
 
 static struct ARC_VFSNode *callback_vfs_load_filepath(struct callback_args *args) {
@@ -534,72 +2272,98 @@ static struct ARC_VFSNode *callback_vfs_load_filepath(struct callback_args *args
 	}
 
 
-	struct ARC_VFSNode *mount = args->node->mount;
-	if (args->node->type == ARC_VFS_N_MOUNT) {
-		mount = args->node;
-	}
+	struct ARC_VFSNode *mount = args->node->type == ARC_VFS_N_MOUNT ? args->node : args->node->mount;
+	struct ARC_Resource *mount_res = vfs_mount_resource(args->node);
 
-	if (mount == NULL) {
+	if (mount_res == NULL) {
 		// There is no mount so there is no reason to stat
 		ARC_DEBUG(ERR, "No mountpoint found, quiting load of %s\n", args->comp);
 		return NULL;
 	}
 
-	struct ARC_Resource *res = NULL;
-	char *use_path = NULL;
-
-	if (args->node->resource != NULL) {
-		res = args->node->resource;
-		use_path = strndup(args->comp, args->comp_len);
-	} else {
-		res = mount->resource;
-		use_path = strndup(args->mount_path, (uintptr_t)args->comp - (uintptr_t)args->mount_path + args->comp_len);
+	if (vfs_dcache_lookup(args->node, args->comp, args->comp_len, args->comp_hash, NULL) == ARC_VFS_DCACHE_NEGATIVE) {
+		// Already known not to exist, do not bother the driver
+		vfs_stats_count(ARC_VFS_STAT_LOOKUP_NEG);
+		return NULL;
 	}
 
+	int own = vfs_node_own_resource(args->node);
+	struct ARC_Resource *res = own ? args->node->resource : mount_res;
 	struct ARC_DriverDef *def = res->driver;
+	struct ARC_VFSDriverExt *ext = vfs_driver_ext(def);
+
+	if (!args->node->cold.populated && ext != NULL && ext->readdir != NULL
+	    && (args->node->type == ARC_VFS_N_DIR || args->node->type == ARC_VFS_N_MOUNT)) {
+		// Load the whole directory at once, the rest of its entries are
+		// likely to be asked for soon too
+		if (own) {
+			vfs_populate_directory(args->node, mount_res, res, NULL, ext);
+		} else if (vfs_path_builder_anchor(args->path, mount) == 0) {
+			vfs_populate_directory(args->node, mount_res, res, args->path->buf, ext);
+		}
+	}
+
+	if (args->node->cold.populated) {
+		struct ARC_VFSNode *ret = vfs_lookup_child(args->node, args->comp, args->comp_len);
+
+		if (ret == NULL) {
+			vfs_dcache_insert(args->node, args->comp, args->comp_len, args->comp_hash, NULL);
+		}
+
+		return ret;
+	}
+
+	size_t mark = 0;
+	char *use_path = vfs_callback_path(args, mount, &mark);
+
+	if (use_path == NULL) {
+		ARC_DEBUG(ERR, "Failed to build path of %.*s\n", (uint32_t)args->comp_len, args->comp);
+		return NULL;
+	}
 
 	struct stat stat = { 0 };
-	if (def->stat(res, use_path, &stat) != 0) {
-		ARC_DEBUG(ERR, "%s does not exist on the physical filesystem\n", use_path);
-		free(use_path);
+	if (ARC_VFS_TIMED(ARC_VFS_LAT_STAT, def->stat(res, use_path, &stat)) != 0) {
+		ARC_VFS_TRACE_PATH("%s does not exist on the physical filesystem\n", use_path);
+		vfs_dcache_insert(args->node, args->comp, args->comp_len, args->comp_hash, NULL);
+		vfs_path_builder_truncate(args->path, mark);
 		return NULL;
 	}
 
 	struct ARC_VFSNodeInfo info = { .driver_index = (uint64_t)-1, .type = vfs_mode2type(stat.st_mode) };
-	vfs_infer_driver(mount, &info);
+	vfs_infer_driver(mount_res, &info);
+
+	info.driver_arg = ARC_VFS_TIMED(ARC_VFS_LAT_LOCATE, def->locate(res, use_path));
+	vfs_path_builder_truncate(args->path, mark);
 
-	info.driver_arg = def->locate(res, use_path);
 	struct ARC_VFSNode *ret = vfs_create_node(args->node, args->comp, args->comp_len, &info);
 
-	if (ret != NULL && ret->resource == NULL) {
-		memcpy(&ret->stat, &stat, sizeof(stat));
+	if (ret != NULL) {
+		vfs_node_stat_seed(ret, &stat);
 	}
 
-	free(use_path);
-
 	return ret;
 }
 
-char *vfs_load_filepath(char *filepath, struct ARC_VFSNode *start, uint32_t flags, struct ARC_VFSNode **end) {
+int vfs_load_filepath(char *filepath, struct ARC_VFSNode *start, uint32_t flags, struct ARC_VFSNode **end, struct ARC_VFSPathSpan *upto) {
 	if (filepath == NULL || start == NULL) {
 		ARC_DEBUG(ERR, "Cannot load %s, improper parameters (%p)", filepath, start);
-		return NULL;
+		return -1;
 	}
 
-	ARC_DEBUG(INFO, "Loading %s\n", filepath);
+	ARC_VFS_TRACE_PATH("Loading %s\n", filepath);
 
-	return internal_vfs_traverse(filepath, start, flags | 1, end, callback_vfs_load_filepath, NULL);
+	return internal_vfs_traverse(filepath, start, flags, end, upto, callback_vfs_load_filepath, NULL);
 }
 
-char *vfs_traverse_filepath(char *filepath, struct ARC_VFSNode *start, uint32_t flags, struct ARC_VFSNode **end) {
+int vfs_traverse_filepath(char *filepath, struct ARC_VFSNode *start, uint32_t flags, struct ARC_VFSNode **end, struct ARC_VFSPathSpan *upto) {
 	if (filepath == NULL) {
 		ARC_DEBUG(ERR, "Cannot traverse %s\n", filepath);
-		return NULL;
+		return -1;
 	}
 
-	ARC_DEBUG(INFO, "Traversing %s\n", filepath);
+	ARC_VFS_TRACE_PATH("Traversing %s\n", filepath);
 
-	return internal_vfs_traverse(filepath, start, flags, end, NULL, NULL);
+	return internal_vfs_traverse(filepath, start, flags, end, upto, NULL, NULL);
 }
 
 
@@ -608,5 +2372,50 @@ char *vfs_get_path_from_nodes(struct ARC_VFSNode *a, struct ARC_VFSNode *b) {
 		return NULL;
 	}
 
-	return NULL;
+	uint32_t token = vfs_rcu_read_lock();
+	long len = vfs_path_between(a, b, NULL, 0);
+	char *path = len < 0 ? NULL : (char *)alloc(len + 1);
+
+	if (path != NULL && vfs_path_between(a, b, path, len + 1) != len) {
+		// A node in between was renamed
+		free(path);
+		path = NULL;
+	}
+
+	vfs_rcu_read_unlock(token);
+
+	return path;
+}
+
+char *vfs_get_mount_path(struct ARC_VFSNode *node) {
+	if (node == NULL) {
+		return NULL;
+	}
+
+	struct ARC_VFSNode *mount = node->type == ARC_VFS_N_MOUNT ? node : node->mount;
+
+	if (mount == NULL) {
+		return NULL;
+	}
+
+	uint32_t token = vfs_rcu_read_lock();
+	long between = vfs_path_between(mount, node, NULL, 0);
+	size_t seed = vfs_mount_prefix(mount, NULL, 0);
+	size_t sep = seed > 0 && between > 0;
+	char *path = between < 0 ? NULL : (char *)alloc(seed + sep + between + 1);
+
+	if (path != NULL && (vfs_mount_prefix(mount, path, seed + 1) != seed
+	    || vfs_path_between(mount, node, path + seed + sep, between + 1) != between)) {
+		// Renamed, or remounted, in between
+		free(path);
+		path = NULL;
+	}
+
+	if (path != NULL && sep) {
+		path[seed] = '/';
+	}
+
+	vfs_rcu_read_unlock(token);
+
+	return path;
 }
@@ -0,0 +1,177 @@
+/**
+ * @file aio.h
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan - Operating System Kernel
+ * Copyright (C) 2023-2025 awewsomegamer
+ *
+ * This file is part of Arctan.
+ *
+ * Arctan is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+ * Asynchronous I/O through a pair of rings. The owner of a ring fills in
+ * submission entries, hands them all over with one vfs_aio_submit, and later
+ * collects the results from the completion ring. Requests to drivers that
+ * can work asynchronously are passed straight through, everything else is
+ * queued for the VFS workers which perform it with the synchronous calls.
+*/
+#ifndef ARC_VFS_AIO_H
+#define ARC_VFS_AIO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <lib/resource.h>
+#include <lib/atomics.h>
+
+#define ARC_VFS_AIO_NOP      0
+#define ARC_VFS_AIO_READ     1
+#define ARC_VFS_AIO_WRITE    2
+#define ARC_VFS_AIO_SYNC     3
+/// Like ARC_VFS_AIO_SYNC, but metadata not needed to read the data back may be left behind.
+#define ARC_VFS_AIO_DATASYNC 4
+
+#define ARC_VFS_AIO_MAX_ENTRIES 4096
+
+struct ARC_VFSIOSqe {
+	/// ARC_VFS_AIO_*.
+	int op;
+	struct ARC_File *file;
+	void *buffer;
+	size_t len;
+	/// Offset in the file, the offset of the descriptor is not used or changed.
+	long offset;
+	/// Handed back untouched in the completion.
+	uint64_t user_data;
+};
+
+struct ARC_VFSIOCqe {
+	uint64_t user_data;
+	/// Bytes transferred, negative on error.
+	long result;
+};
+
+/**
+ * A submission and completion ring.
+ *
+ * NOTE: Only one thread may fill in, submit and reap a ring, completions may
+ *       be posted from anywhere.
+ * */
+struct ARC_VFSIORing {
+	uint32_t entries;
+	struct ARC_VFSIOSqe *sq;
+	uint32_t sq_head;
+	uint32_t sq_tail;
+	struct ARC_VFSIOCqe *cq;
+	uint32_t cq_head;
+	uint32_t cq_tail;
+	ARC_GenericSpinlock cq_lock;
+	/// Requests submitted but not yet reaped, never more than entries.
+	uint32_t inflight;
+};
+
+/**
+ * A request on its way through a driver or the worker queue.
+ * */
+struct ARC_VFSIORequest {
+	struct ARC_VFSIORing *ring;
+	struct ARC_VFSIOSqe sqe;
+	/// Copy of the submitted descriptor with links followed and the offset of the request.
+	struct ARC_File desc;
+	struct ARC_VFSIORequest *next;
+	/// For the driver's own use.
+	void *driver_arg;
+};
+
+/**
+ * Initialize asynchronous I/O.
+ *
+ * @return zero on success.
+ * */
+int init_vfs_aio();
+
+/**
+ * Create a ring.
+ *
+ * @param uint32_t entries - Number of entries, rounded up to a power of two.
+ * @return the ring, NULL on failure.
+ * */
+struct ARC_VFSIORing *vfs_aio_create(uint32_t entries);
+
+/**
+ * Destroy a ring.
+ *
+ * @return zero on success, non-zero while requests are still in flight.
+ * */
+int vfs_aio_destroy(struct ARC_VFSIORing *ring);
+
+/**
+ * Get the next free submission entry.
+ *
+ * The entry is handed over with the next vfs_aio_submit.
+ *
+ * @return the entry to fill in, NULL if the ring is full.
+ * */
+struct ARC_VFSIOSqe *vfs_aio_get_sqe(struct ARC_VFSIORing *ring);
+
+/**
+ * Submit every entry filled in since the last call.
+ *
+ * Entries that would overflow the completion ring are held back until
+ * enough completions have been reaped.
+ *
+ * @return the number of entries submitted.
+ * */
+int vfs_aio_submit(struct ARC_VFSIORing *ring);
+
+/**
+ * Take finished requests off the completion ring.
+ *
+ * @param struct ARC_VFSIOCqe *cqes - Where to copy the completions to.
+ * @param int max - Most completions to take.
+ * @return the number of completions taken, never blocks.
+ * */
+int vfs_aio_reap(struct ARC_VFSIORing *ring, struct ARC_VFSIOCqe *cqes, int max);
+
+/**
+ * Wait until at least min completions are ready.
+ *
+ * The waiting thread helps with the worker queue in the meantime.
+ *
+ * @return the number of completions ready.
+ * */
+int vfs_aio_wait(struct ARC_VFSIORing *ring, uint32_t min);
+
+/**
+ * Finish a request.
+ *
+ * Called by drivers for requests they accepted through their submit hook.
+ *
+ * @param long result - Bytes transferred, negative on error.
+ * */
+void vfs_aio_complete(struct ARC_VFSIORequest *req, long result);
+
+/**
+ * Perform queued requests of drivers that cannot work asynchronously.
+ *
+ * The body of a VFS worker thread, which calls it in a loop.
+ *
+ * @param int max - Most requests to perform.
+ * @return the number of requests performed.
+ * */
+int vfs_aio_work(int max);
+
+#endif
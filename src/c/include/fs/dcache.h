@@ -0,0 +1,97 @@
+/**
+ * @file dcache.h
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan - Operating System Kernel
+ * Copyright (C) 2023-2025 awewsomegamer
+ *
+ * This file is part of Arctan.
+ *
+ * Arctan is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+ * Global cache of path component lookups, keyed by the parent node and the
+ * component's name. Negative entries record components that the physical
+ * filesystem reported as non-existent. It is not intended to be used by
+ * anything other than fs/vfs.c and fs/graph.c.
+*/
+#ifndef ARC_VFS_DCACHE_H
+#define ARC_VFS_DCACHE_H
+
+#include <fs/vfs.h>
+
+// Components longer than this are never cached
+#define ARC_VFS_DCACHE_NAME_MAX 39
+
+#define ARC_VFS_DCACHE_MISS     0
+#define ARC_VFS_DCACHE_HIT      1
+#define ARC_VFS_DCACHE_NEGATIVE 2
+
+/**
+ * Initialize the lookup cache.
+ *
+ * @return zero on success.
+ * */
+int init_vfs_dcache();
+
+/**
+ * Look up the child of parent with the given name.
+ *
+ * On a hit the ref_count of the returned node is incremented
+ * on behalf of the caller, unless ret is NULL.
+ *
+ * @param struct ARC_VFSNode *parent - The directory to look in.
+ * @param char *name - The name of the component, need not be NULL terminated.
+ * @param size_t len - The length of the component.
+ * @param uint32_t hash - vfs_name_hash of the component.
+ * @param struct ARC_VFSNode **ret - Where to write the found node, may be NULL.
+ * @return ARC_VFS_DCACHE_MISS, ARC_VFS_DCACHE_HIT or ARC_VFS_DCACHE_NEGATIVE.
+ * */
+int vfs_dcache_lookup(struct ARC_VFSNode *parent, char *name, size_t len, uint32_t hash, struct ARC_VFSNode **ret);
+
+/**
+ * Record the result of a lookup.
+ *
+ * NOTE: The caller must hold the parent's branch_lock.
+ *
+ * @param struct ARC_VFSNode *node - The found node, NULL records a negative entry.
+ * @return zero on success.
+ * */
+int vfs_dcache_insert(struct ARC_VFSNode *parent, char *name, size_t len, uint32_t hash, struct ARC_VFSNode *node);
+
+/**
+ * Drop any entry for the child of parent with the given name.
+ *
+ * NOTE: The caller must hold the parent's branch_lock.
+ * */
+void vfs_dcache_invalidate(struct ARC_VFSNode *parent, char *name, size_t len, uint32_t hash);
+
+/**
+ * Drop every entry for a child of parent, negative ones included.
+ *
+ * For when everything below parent is replaced at once, as when it is
+ * mounted on or unmounted.
+ *
+ * NOTE: The caller must hold the parent's branch_lock.
+ * */
+void vfs_dcache_invalidate_dir(struct ARC_VFSNode *parent);
+
+/**
+ * Drop every entry in the cache.
+ * */
+void vfs_dcache_flush();
+
+#endif
@@ -0,0 +1,88 @@
+/**
+ * @file driver_ext.h
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan - Operating System Kernel
+ * Copyright (C) 2023-2025 awewsomegamer
+ *
+ * This file is part of Arctan.
+ *
+ * Arctan is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+ * Optional entry points that a driver may provide on top of its
+ * struct ARC_DriverDef. The VFS looks them up by the driver's definition and
+ * falls back to the plain callbacks whenever one is missing.
+*/
+#ifndef ARC_VFS_DRIVER_EXT_H
+#define ARC_VFS_DRIVER_EXT_H
+
+#include <stddef.h>
+#include <sys/stat.h>
+#include <lib/resource.h>
+
+#define ARC_VFS_MAX_DRIVER_EXT 32
+
+/// Called by readdir for every entry, non-zero stops the listing.
+typedef int (*ARC_VFSDirEmit)(void *ctx, char *name, size_t name_len, struct stat *stat, void *locate);
+
+struct ARC_VFSIOVec;
+struct ARC_VFSIORequest;
+struct ARC_VFSNodeInfo;
+
+struct ARC_VFSDriverExt {
+	/// Read into every buffer of iov starting at offset, in one go.
+	size_t (*readv)(struct ARC_VFSIOVec *iov, int iovcnt, long offset, struct ARC_File *file, struct ARC_Resource *res);
+	/// Write out every buffer of iov starting at offset, in one go.
+	size_t (*writev)(struct ARC_VFSIOVec *iov, int iovcnt, long offset, struct ARC_File *file, struct ARC_Resource *res);
+	/// Start an asynchronous request, finished later with vfs_aio_complete. Non-zero declines it.
+	int (*submit)(struct ARC_VFSIORequest *req, struct ARC_File *file, struct ARC_Resource *res);
+	/// List the directory at path, with the stat and the locate handle of each entry, in one pass.
+	int (*readdir)(struct ARC_Resource *res, char *path, ARC_VFSDirEmit emit, void *ctx);
+	/// Remove every path from disk in one go, all are relative to res.
+	int (*remove_batch)(struct ARC_Resource *res, char **paths, size_t count);
+	/// Make everything written to res durable, datasync leaves out metadata that is not needed to read the data back.
+	int (*sync)(struct ARC_Resource *res, int datasync);
+	/// Create every path on disk in one go, results[i] is zero if paths[i] was created.
+	int (*create_batch)(struct ARC_Resource *res, char **paths, struct ARC_VFSNodeInfo **infos, int *results, size_t count);
+};
+
+/**
+ * Initialize the registry.
+ *
+ * @return zero on success.
+ * */
+int init_vfs_driver_ext();
+
+/**
+ * Register the extended entry points of a driver.
+ *
+ * Registering the same definition again replaces its entry points.
+ *
+ * @param struct ARC_DriverDef *def - The definition the driver's resources use.
+ * @param struct ARC_VFSDriverExt *ext - The entry points, must stay valid.
+ * @return zero on success.
+ * */
+int vfs_register_driver_ext(struct ARC_DriverDef *def, struct ARC_VFSDriverExt *ext);
+
+/**
+ * Find the extended entry points of a driver.
+ *
+ * @return the registered entry points, NULL if there are none.
+ * */
+struct ARC_VFSDriverExt *vfs_driver_ext(struct ARC_DriverDef *def);
+
+#endif
@@ -0,0 +1,91 @@
+/**
+ * @file fstate.h
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan - Operating System Kernel
+ * Copyright (C) 2023-2025 awewsomegamer
+ *
+ * This file is part of Arctan.
+ *
+ * Arctan is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+ * State the VFS keeps for each open file. The descriptor itself is shared
+ * with the rest of the kernel, so this lives in a side table keyed by the
+ * address of the descriptor, from vfs_open until vfs_close.
+*/
+#ifndef ARC_VFS_FSTATE_H
+#define ARC_VFS_FSTATE_H
+
+#include <stdint.h>
+#include <lib/resource.h>
+
+#define ARC_VFS_FSTATE_BUCKETS 256
+
+/**
+ * How a file has been read so far.
+ *
+ * NOTE: Guarded by the page cache lock of the file's node.
+ * */
+struct ARC_VFSReadahead {
+	/// Offset a sequential read would start at.
+	long next;
+	/// Number of reads in a row that started at next.
+	uint32_t run;
+	/// First page and size of the last window read ahead.
+	uint64_t start;
+	uint32_t size;
+	/// Reading this page starts the next window.
+	uint64_t marker;
+};
+
+struct ARC_VFSFileState {
+	struct ARC_File *file;
+	struct ARC_VFSFileState *next;
+	struct ARC_VFSReadahead ra;
+};
+
+/**
+ * Initialize the open file table.
+ *
+ * @return zero on success.
+ * */
+int init_vfs_fstate();
+
+/**
+ * Create the state of a newly opened file.
+ *
+ * @param struct ARC_File *file - The descriptor returned by vfs_open.
+ * @return the state, NULL if it could not be allocated.
+ * */
+struct ARC_VFSFileState *vfs_fstate_create(struct ARC_File *file);
+
+/**
+ * Find the state of an open file.
+ *
+ * @param struct ARC_File *file - The descriptor.
+ * @return the state, NULL for descriptors that did not come from vfs_open.
+ * */
+struct ARC_VFSFileState *vfs_fstate_get(struct ARC_File *file);
+
+/**
+ * Drop the state of a file that is being closed.
+ *
+ * @param struct ARC_File *file - The descriptor.
+ * */
+void vfs_fstate_destroy(struct ARC_File *file);
+
+#endif
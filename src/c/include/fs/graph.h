@@ -32,6 +32,13 @@
 #include <stdbool.h>
 #include <fs/vfs.h>
 
+/**
+ * Initialize the node graph's allocator.
+ *
+ * @return zero on success.
+ * */
+int init_vfs_graph();
+
 /**
  * Deletes a
  *
@@ -41,14 +48,275 @@
  *  1   | Physical delete
  * */
 int vfs_delete_node(struct ARC_VFSNode *node, uint32_t flags);
+/**
+ * Delete node and everything under it.
+ *
+ * Nodes that are in use are left, along with their ancestors.
+ *
+ * @return zero if the whole tree was deleted.
+ * */
 int vfs_delete_node_recursive(struct ARC_VFSNode *node, uint32_t flags);
+
+// Most siblings deleted under one hold of their parent's branch_lock
+#define ARC_VFS_DELETE_CHUNK 64
+
+/**
+ * Delete children of parent, physically if bit 1 of flags is set.
+ *
+ * They are deleted in runs of ARC_VFS_DELETE_CHUNK, each under one hold of
+ * the parent's branch_lock and handed to the driver together. Directories
+ * must already be empty, and nothing is pruned.
+ *
+ * @param struct ARC_VFSNode **nodes - The children, each pinned by the caller, the pins are dropped.
+ * @param int *results - Set to zero for every child that was deleted.
+ * @return the number of children deleted.
+ * */
+size_t vfs_delete_children(struct ARC_VFSNode *parent, struct ARC_VFSNode **nodes, size_t count, uint32_t flags, int *results);
+
+// Most siblings created under one hold of their parent's branch_lock
+#define ARC_VFS_CREATE_CHUNK 64
+
+/**
+ * Create the given children of parent.
+ *
+ * Runs of ARC_VFS_CREATE_CHUNK are created under one hold of the parent's
+ * branch_lock, and are handed to the driver of the mount together. Children
+ * that already exist are left as they are.
+ *
+ * @param char **names - A single component each, neither "." nor "..".
+ * @param struct ARC_VFSNodeInfo **infos - What to create under each name.
+ * @param int *results - Set to zero for every child that now exists.
+ * @param struct ARC_VFSNode **nodes - Set to every child that now exists, pinned for the caller to
+ *                                     drop with vfs_node_put, NULL for the others, may be NULL.
+ * @return the number of children created.
+ * */
+size_t vfs_create_children(struct ARC_VFSNode *parent, char **names, struct ARC_VFSNodeInfo **infos, size_t count, int *results, struct ARC_VFSNode **nodes);
+
+struct ARC_VFSDeleteJob;
+
+/**
+ * Prepare the deletion of node and everything under it.
+ *
+ * Every node of the tree is found and pinned up front. They are then
+ * deleted deepest first, in runs of siblings, by whoever calls
+ * vfs_delete_job_run.
+ *
+ * @param uint32_t flags - As for vfs_delete_node, without pruning.
+ * @return the job, NULL on failure.
+ * */
+struct ARC_VFSDeleteJob *vfs_delete_job_create(struct ARC_VFSNode *root, uint32_t flags);
+
+/**
+ * Help delete the tree of a job.
+ *
+ * Any number of threads may call this at the same time, each returns once
+ * there is nothing left that it can do without waiting for another helper.
+ *
+ * @return zero on success.
+ * */
+int vfs_delete_job_run(struct ARC_VFSDeleteJob *job);
+
+/**
+ * Finish a job and free it.
+ *
+ * Runs whatever is left of the job first, sleeping while other helpers
+ * finish their part. No helper may start on the job once this is called.
+ *
+ * @return the number of nodes that could not be deleted.
+ * */
+size_t vfs_delete_job_destroy(struct ARC_VFSDeleteJob *job);
+
+/**
+ * Hash a node name.
+ *
+ * @param char *name - The name to hash, need not be NULL terminated.
+ * @param size_t len - The length of the name.
+ * @return the hash of the name.
+ * */
+uint32_t vfs_name_hash(char *name, size_t len);
+
+/**
+ * Compare two names of the same length, a word at a time.
+ *
+ * @return true if the first len bytes of a and b are the same.
+ * */
+static inline bool vfs_name_equal(const char *a, const char *b, size_t len) {
+	size_t i = 0;
+
+	for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+		uint64_t wa, wb;
+		__builtin_memcpy(&wa, a + i, sizeof(wa));
+		__builtin_memcpy(&wb, b + i, sizeof(wb));
+
+		if (wa != wb) {
+			return false;
+		}
+	}
+
+	for (; i < len; i++) {
+		if (a[i] != b[i]) {
+			return false;
+		}
+	}
+
+	return true;
+}
+/**
+ * Lock the children of node.
+ *
+ * The time spent waiting for the lock is recorded in the VFS's statistics.
+ * */
+void vfs_branch_lock(struct ARC_VFSNode *node);
+void vfs_branch_unlock(struct ARC_VFSNode *node);
+/**
+ * Lock the children of node for reading only.
+ *
+ * Any number of readers hold it at once, nothing may be attached, detached
+ * or renamed under it.
+ * */
+void vfs_branch_lock_shared(struct ARC_VFSNode *node);
+void vfs_branch_unlock_shared(struct ARC_VFSNode *node);
+/**
+ * Mark the start of a modification to the children of node.
+ *
+ * Lockless readers that overlap with the modification will retry under the
+ * branch_lock. The caller must hold the node's branch_lock.
+ * */
+void vfs_branch_write_begin(struct ARC_VFSNode *node);
+void vfs_branch_write_end(struct ARC_VFSNode *node);
+// NOTE: The following three expect the parent's branch_lock to be held by the caller,
+//       attaching and detaching must also be done between vfs_branch_write_begin and
+//       vfs_branch_write_end on the parent
+/**
+ * Insert a node into the children of the given parent.
+ *
+ * @return zero on success.
+ * */
+int vfs_attach_node(struct ARC_VFSNode *parent, struct ARC_VFSNode *node);
+/**
+ * Remove a node from the children of its parent.
+ *
+ * @return zero on success.
+ * */
+int vfs_detach_node(struct ARC_VFSNode *node);
+/**
+ * Replace the name of a node that is not currently attached to a parent.
+ *
+ * @param char *name - A heap allocated, NULL terminated name, ownership is taken.
+ * */
+void vfs_rename_node(struct ARC_VFSNode *node, char *name);
+/**
+ * Find the child of parent with the given name.
+ *
+ * @return the child, NULL if it does not exist.
+ * */
+struct ARC_VFSNode *vfs_lookup_child(struct ARC_VFSNode *parent, char *name, size_t name_len);
+/**
+ * As vfs_lookup_child, for a name that has already been hashed.
+ *
+ * @param uint32_t hash - vfs_name_hash of the name.
+ * */
+struct ARC_VFSNode *vfs_lookup_child_hash(struct ARC_VFSNode *parent, char *name, size_t name_len, uint32_t hash);
+/**
+ * Load every entry of a directory on disk, if its driver can list it.
+ *
+ * @return zero on success, or if there was nothing to load.
+ * */
+int vfs_populate_node(struct ARC_VFSNode *dir);
+
+/**
+ * Get the attributes of a node, asking its driver only if those cached have gone stale.
+ *
+ * Attributes are fetched on first need, and are then trusted for the
+ * validity period of the mount the node is in (see vfs_mount_set_attr_ttl).
+ *
+ * @param struct stat *stat - Where to copy them, NULL to only bring node->cold.stat up to date.
+ * @return zero on success.
+ * */
+int vfs_node_stat(struct ARC_VFSNode *node, struct stat *stat);
+/**
+ * Forget the cached attributes of a node, for when the VFS has changed the file.
+ * */
+void vfs_node_stat_invalidate(struct ARC_VFSNode *node);
+
+/**
+ * What a directory held before it was mounted on.
+ * */
+struct ARC_VFSCovered {
+	struct ARC_VFSNode *children;
+	struct ARC_VFSNodeIndex *index;
+	struct ARC_Resource *resource;
+	uint32_t child_count;
+	uint8_t populated;
+};
+
+/**
+ * Set aside the contents of a directory and turn it into a mountpoint.
+ *
+ * NOTE: It is expected that the caller has locked node's branch_lock
+ *
+ * @param struct ARC_VFSNode *node - The directory.
+ * @param struct ARC_Resource *resource - The resource that is mounted on it.
+ * @param struct ARC_VFSCovered *save - Where to save what the directory held.
+ * @return zero on success, non-zero if node is not a directory.
+ * */
+int vfs_node_cover(struct ARC_VFSNode *node, struct ARC_Resource *resource, struct ARC_VFSCovered *save);
+
+/**
+ * Turn a mountpoint back into the directory it covered.
+ *
+ * NOTE: It is expected that the caller has locked node's branch_lock
+ *
+ * @return zero on success, non-zero if nodes of the mount are still attached.
+ * */
+int vfs_node_uncover(struct ARC_VFSNode *node, struct ARC_VFSCovered *saved);
+
+// Return values of the traversal functions, negative values are errors
+/// The whole path was resolved.
+#define ARC_VFS_PATH_RESOLVED 0
+/// The path was resolved up to the returned span.
+#define ARC_VFS_PATH_PARTIAL  1
+/// The path ended on a link whose target does not exist.
+#define ARC_VFS_PATH_BROKEN  -2
+/// Too many links had to be followed.
+#define ARC_VFS_PATH_LOOP    -3
+
+#define ARC_VFS_MAX_LINK_DEPTH 8
+
+/**
+ * The unresolved part of a path given to a traversal function.
+ * */
+struct ARC_VFSPathSpan {
+	/// Offset of the first unresolved component within the given path.
+	size_t offset;
+	/// Length of the unresolved remainder, zero if the path was resolved.
+	size_t length;
+};
+
+/**
+ * Traverse a path.
+ *
+ * The node found last is written to end with its ref_count incremented, even
+ * if the path could not be fully resolved or the final link is broken. If the
+ * final link is resolved, its target is written instead of the link.
+ *
+ * @param char *filepath - The path to traverse.
+ * @param struct ARC_VFSNode *start - The node to start from.
+ * @param uint32_t flags - Bit 0: resolve links, Bit 1: ignore the last component.
+ * @param struct ARC_VFSNode **end - Where to write the node found last, may be NULL.
+ * @param struct ARC_VFSPathSpan *upto - Where to write the unresolved part of filepath, may be NULL.
+ * @return ARC_VFS_PATH_RESOLVED, ARC_VFS_PATH_PARTIAL, or a negative error.
+ * */
+int vfs_traverse_filepath(char *filepath, struct ARC_VFSNode *start, uint32_t flags, struct ARC_VFSNode **end, struct ARC_VFSPathSpan *upto);
 // NOTE: Flags is bitwise OR'd with 1, setting link resolution, do not depend on this behavior, set it yourself
-char *vfs_create_filepath(char *filepath, struct ARC_VFSNode *start, uint32_t flags, struct ARC_VFSNodeInfo *info, struct ARC_VFSNode **end);
-// NOTE: Flags is bitwise OR'd with 1, setting link resolution, do not depend on this behavior, set it yourself
-char *vfs_load_filepath(char *filepath, struct ARC_VFSNode *start, uint32_t flags, struct ARC_VFSNode **end);
-char *vfs_traverse_filepath(char *filepath, struct ARC_VFSNode *start, uint32_t flags, struct ARC_VFSNode **end);
+int vfs_create_filepath(char *filepath, struct ARC_VFSNode *start, uint32_t flags, struct ARC_VFSNodeInfo *info, struct ARC_VFSNode **end, struct ARC_VFSPathSpan *upto);
+// NOTE: Links are only resolved if bit 0 of flags is set, the target is then returned in place of the link
+int vfs_load_filepath(char *filepath, struct ARC_VFSNode *start, uint32_t flags, struct ARC_VFSNode **end, struct ARC_VFSPathSpan *upto);
 // NOTE: Expects a and b ref_count to be incremented by caller or have both nodes' branch_locks
 //       held
 char *vfs_get_path_from_nodes(struct ARC_VFSNode *a, struct ARC_VFSNode *b);
+// NOTE: The path of node as the driver of its mount knows it, expects node's
+//       ref_count to be incremented by the caller
+char *vfs_get_mount_path(struct ARC_VFSNode *node);
 
 #endif
@@ -0,0 +1,119 @@
+/**
+ * @file mount.h
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan - Operating System Kernel
+ * Copyright (C) 2023-2025 awewsomegamer
+ *
+ * This file is part of Arctan.
+ *
+ * Arctan is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+ * The mount table. Every mountpoint node is hashed to the resource mounted on
+ * it, the path within that resource which appears at the mountpoint (empty
+ * unless it is a bind mount), the mount it sits in, and whatever the
+ * directory held before it was covered. Lookups take no lock, entries are
+ * retired through RCU.
+*/
+#ifndef ARC_VFS_MOUNT_H
+#define ARC_VFS_MOUNT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <lib/resource.h>
+
+#define ARC_VFS_MOUNT_BUCKETS 64
+// Ticks of vfs_cpu_clock attributes fetched from a resource are trusted for
+// unless the mount sets its own, around a quarter of a second with a 2 GHz
+// time stamp counter. The counters of other architectures tick slower and
+// keep attributes for longer, where there is no counter at all this is the
+// number of clock reads instead, see vfs_cpu_clock
+#ifndef ARC_VFS_ATTR_TTL
+#define ARC_VFS_ATTR_TTL (1ULL << 29)
+#endif
+
+struct ARC_VFSNode;
+
+/**
+ * Initialize the mount table.
+ *
+ * @return zero on success.
+ * */
+int init_vfs_mount();
+
+/**
+ * Mount a resource on a directory.
+ *
+ * Whatever the directory holds is set aside until it is unmounted. The
+ * reference the caller holds on node is kept by the mount.
+ *
+ * @param struct ARC_VFSNode *node - The directory to mount on.
+ * @param struct ARC_Resource *resource - The resource to mount.
+ * @param char *prefix - The path within the resource to show at node, NULL for its root.
+ * @return zero on success.
+ * */
+int vfs_mount_attach(struct ARC_VFSNode *node, struct ARC_Resource *resource, char *prefix);
+
+/**
+ * Unmount whatever is mounted on node.
+ *
+ * Every node loaded from the mount is deleted, if any of them is still in use
+ * nothing is unmounted. The covered directory then reappears, and the
+ * reference kept by the mount is dropped.
+ *
+ * @return zero on success, -2 if mounts sit below it, -3 if it is in use.
+ * */
+int vfs_mount_detach(struct ARC_VFSNode *node);
+
+/**
+ * Find the resource of the mount that node belongs to.
+ *
+ * @return the resource, NULL if node is only in memory.
+ * */
+struct ARC_Resource *vfs_mount_resource(struct ARC_VFSNode *node);
+
+/**
+ * Copy the path within its resource that appears at a mountpoint.
+ *
+ * @param struct ARC_VFSNode *point - The mountpoint.
+ * @param char *buf - Where to copy the terminated path, may be NULL.
+ * @param size_t size - The size of buf.
+ * @return the length of the path, zero if it is the root of the resource or point is no mountpoint.
+ * */
+size_t vfs_mount_prefix(struct ARC_VFSNode *point, char *buf, size_t size);
+
+/**
+ * Set how long attributes of the nodes in a mount are trusted before the
+ * resource is asked again.
+ *
+ * Zero asks the resource every time, UINT64_MAX keeps them until the VFS
+ * itself changes the file.
+ *
+ * @param struct ARC_VFSNode *point - The mountpoint.
+ * @param uint64_t ticks - The validity period, in ticks of vfs_cpu_clock.
+ * @return zero on success, non-zero if point is no mountpoint.
+ * */
+int vfs_mount_set_attr_ttl(struct ARC_VFSNode *point, uint64_t ticks);
+
+/**
+ * Get how long attributes of node are trusted for.
+ *
+ * @return the validity period of the mount node belongs to, ARC_VFS_ATTR_TTL if it is only in memory.
+ * */
+uint64_t vfs_mount_attr_ttl(struct ARC_VFSNode *node);
+
+#endif
@@ -0,0 +1,104 @@
+/**
+ * @file ncache.h
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan - Operating System Kernel
+ * Copyright (C) 2023-2025 awewsomegamer
+ *
+ * This file is part of Arctan.
+ *
+ * Arctan is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+ * Cache of idle nodes. Nodes whose last file descriptor was closed are kept
+ * in the graph, ordered from most to least recently used, and are only
+ * deleted once the cache grows past its limit. A node that is looked up
+ * again while cached simply stays in the graph.
+ *
+ * Each processor keeps its own short list of freshly idle nodes, which is
+ * only merged into the shared list, the one that is evicted from, in batches.
+*/
+#ifndef ARC_VFS_NCACHE_H
+#define ARC_VFS_NCACHE_H
+
+#include <stddef.h>
+#include <fs/vfs.h>
+
+#define ARC_VFS_NCACHE_DEFAULT 4096
+#define ARC_VFS_NCACHE_MIN     64
+
+/**
+ * Initialize the idle node cache.
+ *
+ * @return zero on success.
+ * */
+int init_vfs_ncache();
+
+/**
+ * Put a node that a file was just closed on at the front of the cache.
+ *
+ * NOTE: The caller must still hold its reference on node, else the node
+ *       could be deleted before it makes it onto the list.
+ *
+ * May evict other nodes to stay under the limit.
+ * */
+void vfs_ncache_insert(struct ARC_VFSNode *node);
+
+/**
+ * Like vfs_ncache_insert, but never evicts.
+ *
+ * For nodes created with the branch_lock of their parent held, which evicting
+ * could need. The next insert brings the cache back under its limit.
+ *
+ * NOTE: The caller must hold a reference on node or the branch_lock of its parent.
+ * */
+void vfs_ncache_park(struct ARC_VFSNode *node);
+
+/**
+ * Take a node out of the cache.
+ *
+ * NOTE: Called by vfs_delete_node with the parent's branch_lock held.
+ * */
+void vfs_ncache_remove(struct ARC_VFSNode *node);
+
+/**
+ * Note that a cached node has been used again, giving it a second chance
+ * before it is evicted.
+ * */
+#define vfs_ncache_touch(__node) \
+	do { if ((__node)->lru_state != 0) { (__node)->lru_referenced = 1; } } while (0)
+
+/**
+ * Evict idle nodes, for use by the memory manager when memory is short.
+ *
+ * NOTE: Reached through vfs_reclaim, which the memory manager calls.
+ *
+ * The limit of the cache is lowered to what remains, and only grows back
+ * as evicted nodes turn out to be needed again.
+ *
+ * @param size_t count - The number of nodes to try to evict.
+ * @return the number of nodes that were evicted.
+ * */
+size_t vfs_ncache_shrink(size_t count);
+
+/**
+ * Set the number of idle nodes the shared list may grow to.
+ *
+ * Each processor's list holds a small, fixed number of nodes on top.
+ * */
+void vfs_ncache_set_limit(size_t limit);
+
+#endif
@@ -0,0 +1,93 @@
+/**
+ * @file nsimage.h
+ *
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan - Operating System Kernel
+ * Copyright (C) 2023-2025 awewsomegamer
+ *
+ * This file is part of Arctan.
+ *
+ * Arctan is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+ * Namespace images, a prebuilt tree of nodes to create at boot in one pass.
+ * An image is a header, a table of entries and a table of NULL terminated
+ * strings, all little endian. Every entry names its parent by index, and
+ * parents come before their children, so the whole tree is created without
+ * walking a single path. Siblings that are next to each other in the table
+ * are created together, under one hold of their parent's branch_lock.
+*/
+#ifndef ARC_VFS_NSIMAGE_H
+#define ARC_VFS_NSIMAGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <fs/vfs.h>
+
+// "AVNS"
+#define ARC_VFS_IMAGE_MAGIC 0x534E5641
+#define ARC_VFS_IMAGE_VERSION 1
+/// Parent of the entries that sit directly under the node the image is loaded at.
+#define ARC_VFS_IMAGE_TOP 0xFFFFFFFF
+/// Name offset meaning there is no string.
+#define ARC_VFS_IMAGE_NONE 0xFFFFFFFF
+
+struct ARC_VFSImageHeader {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t reserved;
+	uint32_t entry_count;
+	/// Offset of the string table from the start of the image.
+	uint32_t strings;
+	uint32_t strings_size;
+	/// Offset of the entry table from the start of the image.
+	uint32_t entries;
+} __attribute__((packed));
+
+struct ARC_VFSImageEntry {
+	/// Index of the entry of the parent directory, ARC_VFS_IMAGE_TOP for the top.
+	uint32_t parent;
+	/// Offset of the name in the string table.
+	uint32_t name;
+	/// Offset of what a link points to in the string table, ARC_VFS_IMAGE_NONE otherwise.
+	uint32_t target;
+	uint32_t type;
+	uint32_t mode;
+	uint32_t reserved;
+	/// Driver to create the node with, UINT64_MAX to infer it.
+	uint64_t driver_index;
+	/// Given to the driver as its argument.
+	uint64_t driver_arg;
+} __attribute__((packed));
+
+/**
+ * Create every node of an image under top.
+ *
+ * Nodes that already exist are kept, the image is merged into the tree.
+ *
+ * NOTE: Meant for boot, the image is read in place and may be freed once
+ *       this returns.
+ *
+ * @param struct ARC_VFSNode *top - The directory the image is loaded at, pinned by the caller.
+ * @param void *image - The image.
+ * @param size_t size - The size of the image in bytes.
+ * @return zero if every node was created, -1 if the image is malformed, or
+ *         -2 if some nodes could not be created.
+ * */
+int vfs_image_load(struct ARC_VFSNode *top, void *image, size_t size);
+
+#endif
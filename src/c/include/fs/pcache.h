@@ -0,0 +1,149 @@
+/**
+ * @file pcache.h
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan - Operating System Kernel
+ * Copyright (C) 2023-2025 awewsomegamer
+ *
+ * This file is part of Arctan.
+ *
+ * Arctan is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+ * The page cache, file data kept in memory in page sized pieces. Each node
+ * that is read or written through the VFS gets its own set of pages, keyed by
+ * page index, which are filled from the driver on a miss (reading ahead when
+ * a file is read sequentially) and written back to it once enough of them are dirty,
+ * once the oldest of them has been dirty for long enough, when the file is closed
+ * or synced, when they are evicted, or before the node goes away. Small writes
+ * to the same pages are so merged into one write of the driver.
+*/
+#ifndef ARC_VFS_PCACHE_H
+#define ARC_VFS_PCACHE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <fs/vfs.h>
+#include <fs/fstate.h>
+
+#define ARC_VFS_PAGE_SIZE 4096
+// Most pages a single node may cache
+#define ARC_VFS_PCACHE_NODE_MAX 256
+// Pages cached across all nodes before nodes start recycling their own
+#define ARC_VFS_PCACHE_GLOBAL_MAX 8192
+// Dirty pages a node may hold before they are all written back
+#define ARC_VFS_PCACHE_DIRTY_MAX 64
+// Ticks of vfs_cpu_clock after which dirty pages are written back, by the next
+// write of their node or by vfs_pcache_flush_aged, around a second
+#ifndef ARC_VFS_PCACHE_DIRTY_TICKS
+#define ARC_VFS_PCACHE_DIRTY_TICKS (1ULL << 31)
+#endif
+// Read-ahead window, in pages
+#define ARC_VFS_PCACHE_RA_MIN 4
+#define ARC_VFS_PCACHE_RA_MAX 32
+
+/**
+ * Initialize the page cache.
+ *
+ * @return zero on success.
+ * */
+int init_vfs_pcache();
+
+/**
+ * Whether reads and writes of the node should go through the page cache.
+ *
+ * Only regular files backed by a physical filesystem are cached, the data
+ * of memory-based nodes is already in memory.
+ * */
+bool vfs_pcache_usable(struct ARC_VFSNode *node);
+
+/**
+ * Read from a node through its page cache.
+ *
+ * @param struct ARC_VFSNode *node - The node to read, must hold a reference on it.
+ * @param struct ARC_File *desc - The descriptor to hand to the driver on a miss.
+ * @param struct ARC_VFSReadahead *ra - Access pattern of the reading file, NULL to not read ahead.
+ * @param void *buffer - Where to read to.
+ * @param size_t len - The number of bytes to read.
+ * @param long offset - The offset in the file to read from.
+ * @return the number of bytes read.
+ * */
+size_t vfs_pcache_read(struct ARC_VFSNode *node, struct ARC_File *desc, struct ARC_VFSReadahead *ra, void *buffer, size_t len, long offset);
+
+/**
+ * Write to a node through its page cache.
+ *
+ * The data only reaches the driver once it is written back.
+ *
+ * @return the number of bytes written.
+ * */
+size_t vfs_pcache_write(struct ARC_VFSNode *node, struct ARC_File *desc, void *buffer, size_t len, long offset);
+
+/**
+ * Get the data of a page of a node and keep it in the cache.
+ *
+ * The page is read from the driver if it is not already cached, and is not
+ * recycled until it is unpinned the same number of times.
+ *
+ * @param struct ARC_VFSReadahead *ra - Access pattern of the faulting file, may be NULL.
+ * @param uint64_t index - The index of the page in the file.
+ * @param bool write - The data may be changed in place, the page stays dirty until unpinned.
+ * @return page aligned pointer to ARC_VFS_PAGE_SIZE bytes, NULL on failure.
+ * */
+void *vfs_pcache_pin(struct ARC_VFSNode *node, struct ARC_File *desc, struct ARC_VFSReadahead *ra, uint64_t index, bool write);
+
+/**
+ * Release a page returned by vfs_pcache_pin.
+ *
+ * @param bool write - Must match the pin being released.
+ * @return zero on success.
+ * */
+int vfs_pcache_unpin(struct ARC_VFSNode *node, uint64_t index, bool write);
+
+/**
+ * Write every dirty page of a node back to its driver.
+ *
+ * @return zero on success.
+ * */
+int vfs_pcache_writeback(struct ARC_VFSNode *node);
+
+/**
+ * Write back the dirty pages of every node whose oldest dirty page is older
+ * than ARC_VFS_PCACHE_DIRTY_TICKS.
+ *
+ * NOTE: Must be called periodically, by the kernel's timer or a VFS worker
+ *       (vfs_aio_work calls it once the queue is empty). Without it the age
+ *       of dirty pages is only looked at by the next write of their node, and
+ *       the last writes to a file that stays open and idle wait for its close
+ *       or an fsync. Must not be called with any branch_lock held. The list
+ *       of dirty nodes is not held while they are written back, a second
+ *       call waits for the first.
+ *
+ * @return the number of nodes written back.
+ * */
+size_t vfs_pcache_flush_aged();
+
+/**
+ * Free every page of a node.
+ *
+ * NOTE: Called by vfs_delete_node once nobody can reach the node anymore.
+ *
+ * @param bool writeback - Write dirty pages back first, false when the file
+ *                         itself is being destroyed.
+ * */
+void vfs_pcache_destroy(struct ARC_VFSNode *node, bool writeback);
+
+#endif
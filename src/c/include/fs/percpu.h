@@ -0,0 +1,84 @@
+/**
+ * @file percpu.h
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan - Operating System Kernel
+ * Copyright (C) 2023-2025 awewsomegamer
+ *
+ * This file is part of Arctan.
+ *
+ * Arctan is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+ * Helpers for the per-processor data used by the VFS.
+*/
+#ifndef ARC_VFS_PERCPU_H
+#define ARC_VFS_PERCPU_H
+
+#include <stdint.h>
+#include <arch/smp.h>
+
+#ifndef ARC_VFS_MAX_CPUS
+#define ARC_VFS_MAX_CPUS 64
+#endif
+
+#define ARC_VFS_CACHE_LINE 64
+#define ARC_VFS_CACHE_ALIGNED __attribute__((aligned(ARC_VFS_CACHE_LINE)))
+
+// NOTE: The caller may be migrated at any point, the result is only a hint as
+//       to which slot is least likely to be contended
+#define vfs_current_cpu() ((uint32_t)get_processor_id() % ARC_VFS_MAX_CPUS)
+
+#if !defined(__x86_64__) && !defined(__i386__) && !defined(__aarch64__) && !defined(__riscv)
+/// Ticks of vfs_cpu_clock where there is no counter to read, see stats.c.
+extern uint64_t vfs_clock_ticks;
+#endif
+
+// Ticks of the processor's free running counter, only good for telling how long
+// ago something happened
+// NOTE: Where there is no such counter the clock instead advances once per call,
+//       so that whatever is timed by it still expires as the VFS is used
+static inline uint64_t vfs_cpu_clock() {
+#if defined(__x86_64__) || defined(__i386__)
+	return __builtin_ia32_rdtsc();
+#elif defined(__aarch64__)
+	uint64_t ticks;
+	__asm__ volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+	return ticks;
+#elif defined(__riscv)
+	uint64_t ticks;
+	__asm__ volatile("rdtime %0" : "=r"(ticks));
+	return ticks;
+#else
+	return __atomic_add_fetch(&vfs_clock_ticks, 1, __ATOMIC_RELAXED);
+#endif
+}
+
+// Hint to the processor that the caller is spinning on memory another one writes
+static inline void vfs_cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__)
+	__asm__ volatile("yield" ::: "memory");
+#elif defined(__riscv)
+	// NOTE: Zihintpause's pause, a plain fence hint where it is not implemented
+	__asm__ volatile(".4byte 0x0100000f" ::: "memory");
+#else
+	__atomic_signal_fence(__ATOMIC_SEQ_CST);
+#endif
+}
+
+#endif
@@ -0,0 +1,94 @@
+/**
+ * @file rcu.h
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan - Operating System Kernel
+ * Copyright (C) 2023-2025 awewsomegamer
+ *
+ * This file is part of Arctan.
+ *
+ * Arctan is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+ * Epoch based deferred reclamation for the VFS node graph. Memory that
+ * lockless readers may still be looking at is retired instead of freed, and
+ * is only handed back once every reader that could have seen it has left its
+ * read-side section.
+*/
+#ifndef ARC_VFS_RCU_H
+#define ARC_VFS_RCU_H
+
+#include <stdint.h>
+
+struct ARC_VFSRCUHead {
+	struct ARC_VFSRCUHead *next;
+	/// Called once no reader can hold a reference.
+	void (*reclaim)(struct ARC_VFSRCUHead *head);
+};
+
+/**
+ * Initialize deferred reclamation.
+ *
+ * @return zero on success.
+ * */
+int init_vfs_rcu();
+
+/**
+ * Enter a read-side section.
+ *
+ * @return the token to be passed to vfs_rcu_read_unlock.
+ * */
+uint32_t vfs_rcu_read_lock();
+
+/**
+ * Leave a read-side section.
+ *
+ * @param uint32_t token - The value returned by the matching vfs_rcu_read_lock.
+ * */
+void vfs_rcu_read_unlock(uint32_t token);
+
+/**
+ * Defer the reclamation of an object.
+ *
+ * The object must already be unreachable for new readers.
+ *
+ * @param struct ARC_VFSRCUHead *head - The head embedded in the object.
+ * @param void (*reclaim)(struct ARC_VFSRCUHead *) - Function that frees the object.
+ * */
+void vfs_rcu_retire(struct ARC_VFSRCUHead *head, void (*reclaim)(struct ARC_VFSRCUHead *head));
+
+/**
+ * Defer freeing a plain allocation.
+ *
+ * @param void *ptr - The pointer to eventually free.
+ * */
+void vfs_rcu_free(void *ptr);
+
+/**
+ * Wait until every read-side section that was entered before the call has left.
+ *
+ * Must not be called from within a read-side section.
+ * */
+void vfs_rcu_synchronize();
+
+/**
+ * Reclaim whatever has finished its grace period.
+ *
+ * Never blocks, retiring calls this as well.
+ * */
+void vfs_rcu_reclaim();
+
+#endif
@@ -0,0 +1,111 @@
+/**
+ * @file ref.h
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan - Operating System Kernel
+ * Copyright (C) 2023-2025 awewsomegamer
+ *
+ * This file is part of Arctan.
+ *
+ * Arctan is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+ * Node reference counting. Nodes that nearly every lookup passes through
+ * (the root, mountpoints, and directories that see enough traffic) count
+ * their references in per-processor slots instead of in ref_count, so that
+ * taking and dropping them does not bounce a single cache line between
+ * processors. The true count is then ref_count plus the sum of the slots,
+ * which is only made exact again when someone needs to know it.
+*/
+#ifndef ARC_VFS_REF_H
+#define ARC_VFS_REF_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <fs/percpu.h>
+
+// Number of references a directory takes before it is counted per processor
+#define ARC_VFS_REF_HEAT 1024
+// Most nodes that are counted per processor at once
+#define ARC_VFS_REF_MAX_PERCPU 64
+
+// States of a node's count
+/// Only ref_count is used, the node may still be switched over.
+#define ARC_VFS_REF_ATOMIC    0
+/// Being switched over to per processor slots, or folded back from them.
+#define ARC_VFS_REF_SWITCHING 1
+/// ref_cpus holds part of the count.
+#define ARC_VFS_REF_PERCPU    2
+/// Only ref_count is used, until vfs_node_ref_restore.
+#define ARC_VFS_REF_EXACT     3
+
+struct ARC_VFSNode;
+
+struct ARC_VFSRefCPU {
+	/// References taken minus references dropped on this processor, may be negative.
+	int64_t count;
+} ARC_VFS_CACHE_ALIGNED;
+
+/**
+ * Take a reference on a node.
+ * */
+void vfs_node_get(struct ARC_VFSNode *node);
+
+/**
+ * Take a reference on a node from within a read-side section.
+ * */
+void vfs_node_get_rcu(struct ARC_VFSNode *node);
+
+/**
+ * Drop a reference on a node.
+ * */
+void vfs_node_put(struct ARC_VFSNode *node);
+
+/**
+ * Count the references of a node per processor from now on.
+ *
+ * Meant for nodes that stay around and are passed by nearly every lookup.
+ *
+ * @param struct ARC_VFSNode *node - The node.
+ * @param bool force - Ignore ARC_VFS_REF_MAX_PERCPU.
+ * @return zero on success.
+ * */
+int vfs_node_ref_percpu(struct ARC_VFSNode *node, bool force);
+
+/**
+ * Fold the per processor slots of a node back into ref_count.
+ *
+ * Afterwards ref_count is exact, and stays so until vfs_node_ref_restore.
+ * Waits for a grace period if the node was counted per processor, or for
+ * whoever else is folding it, so it must not be called from within a
+ * read-side section or with a branch_lock held. The caller must keep the
+ * node alive.
+ *
+ * @param struct ARC_VFSNode *node - The node.
+ * @return true if this call folded per processor slots.
+ * */
+bool vfs_node_ref_collapse(struct ARC_VFSNode *node);
+
+/**
+ * Undo vfs_node_ref_collapse, for when the exact count was not needed after all.
+ *
+ * @param struct ARC_VFSNode *node - The node.
+ * @param bool percpu - What vfs_node_ref_collapse returned, counts the node
+ * per processor again if set.
+ * */
+void vfs_node_ref_restore(struct ARC_VFSNode *node, bool percpu);
+
+#endif
@@ -0,0 +1,68 @@
+/**
+ * @file rwlock.h
+ *
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan - Operating System Kernel
+ * Copyright (C) 2023-2025 awewsomegamer
+ *
+ * This file is part of Arctan.
+ *
+ * Arctan is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+ * A reader-writer lock for the branches of the node graph. Readers only
+ * touch a counter unless a writer is around, in which case they sleep on the
+ * writer's mutex until it is done. Writers wait for the readers that are
+ * already inside to leave, spinning for a while and then yielding the
+ * processor, as a reader that copies out a directory or is preempted may
+ * take long.
+*/
+#ifndef ARC_VFS_RWLOCK_H
+#define ARC_VFS_RWLOCK_H
+
+#include <stdint.h>
+#include <lib/atomics.h>
+
+struct ARC_VFSRWLock {
+	/// Held by the writer, readers wait on it while there is one.
+	ARC_GenericMutex writer;
+	/// Readers inside of the lock.
+	uint32_t readers;
+	/// Set while a writer holds the lock, or is waiting for the readers to leave.
+	uint32_t writing;
+};
+
+/**
+ * Initialize a lock.
+ * */
+void init_vfs_rwlock(struct ARC_VFSRWLock *lock);
+
+/**
+ * Take the lock shared.
+ *
+ * NOTE: A thread holding it shared must not take it again, in either mode.
+ * */
+void vfs_rwlock_read(struct ARC_VFSRWLock *lock);
+void vfs_rwlock_read_unlock(struct ARC_VFSRWLock *lock);
+
+/**
+ * Take the lock exclusive.
+ * */
+void vfs_rwlock_write(struct ARC_VFSRWLock *lock);
+void vfs_rwlock_write_unlock(struct ARC_VFSRWLock *lock);
+
+#endif
@@ -0,0 +1,82 @@
+/**
+ * @file slab.h
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan - Operating System Kernel
+ * Copyright (C) 2023-2025 awewsomegamer
+ *
+ * This file is part of Arctan.
+ *
+ * Arctan is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+ * Fixed size object caches with per-processor free lists, used for the
+ * VFS's own structures so that allocating and freeing them rarely has to go
+ * through the general allocator or touch a shared lock.
+*/
+#ifndef ARC_VFS_SLAB_H
+#define ARC_VFS_SLAB_H
+
+#include <stddef.h>
+#include <lib/atomics.h>
+#include <fs/percpu.h>
+
+struct ARC_VFSSlabCPU {
+	ARC_GenericSpinlock lock;
+	/// Singly linked list of free objects, the first word of each is the link.
+	void *free;
+	size_t count;
+} ARC_VFS_CACHE_ALIGNED;
+
+struct ARC_VFSSlabCache {
+	char *name;
+	size_t obj_size;
+	/// Boundary every object starts on.
+	size_t align;
+	/// Number of objects moved between a processor and the depot at once.
+	size_t batch;
+	struct ARC_VFSSlabCPU cpus[ARC_VFS_MAX_CPUS];
+	ARC_GenericSpinlock depot_lock;
+	/// Objects that overflowed a processor's list.
+	void *depot;
+	size_t depot_count;
+	/// Number of bytes taken from the general allocator.
+	size_t reserved;
+};
+
+/**
+ * Initialize an object cache.
+ *
+ * @param struct ARC_VFSSlabCache *cache - The cache to initialize.
+ * @param char *name - Name of the cache, for debugging.
+ * @param size_t obj_size - The size of each object.
+ * @return zero on success.
+ * */
+int init_vfs_slab(struct ARC_VFSSlabCache *cache, char *name, size_t obj_size);
+
+/**
+ * Allocate an object.
+ *
+ * @return the zeroed object, NULL if out of memory.
+ * */
+void *vfs_slab_alloc(struct ARC_VFSSlabCache *cache);
+
+/**
+ * Give an object back to its cache.
+ * */
+void vfs_slab_free(struct ARC_VFSSlabCache *cache, void *obj);
+
+#endif
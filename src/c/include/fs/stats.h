@@ -0,0 +1,186 @@
+/**
+ * @file stats.h
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan - Operating System Kernel
+ * Copyright (C) 2023-2025 awewsomegamer
+ *
+ * This file is part of Arctan.
+ *
+ * Arctan is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+ * Statistics of the VFS's hot paths. Counters and latency histograms are kept
+ * per processor so that recording them costs an uncontended add, they are only
+ * summed up when read, for instance through /proc/vfs/stats.
+ *
+ * Building with ARC_VFS_STATS set to 0 compiles all of it out.
+*/
+#ifndef ARC_VFS_STATS_H
+#define ARC_VFS_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <fs/percpu.h>
+
+#ifndef ARC_VFS_STATS
+#define ARC_VFS_STATS 1
+#endif
+
+// The logging of every traversal is far from free, and so only built if asked for
+#ifndef ARC_VFS_TRACE
+#define ARC_VFS_TRACE 0
+#endif
+
+#if ARC_VFS_TRACE
+#define ARC_VFS_TRACE_PATH(fmt, ...) ARC_DEBUG(INFO, fmt, ##__VA_ARGS__)
+#else
+#define ARC_VFS_TRACE_PATH(fmt, ...)
+#endif
+
+// Counted events
+/// A component was found among the nodes in memory.
+#define ARC_VFS_STAT_LOOKUP_HIT  0
+/// A component had to be asked of the driver.
+#define ARC_VFS_STAT_LOOKUP_MISS 1
+/// A miss that the dcache knew not to exist, and so never reached the driver.
+#define ARC_VFS_STAT_LOOKUP_NEG  2
+/// Idle nodes evicted from the node cache.
+#define ARC_VFS_STAT_NCACHE_EVICT 3
+/// Attributes answered from those cached on the node.
+#define ARC_VFS_STAT_ATTR_HIT    4
+/// Attributes that had to be asked of the driver, having never been fetched or gone stale.
+#define ARC_VFS_STAT_ATTR_MISS   5
+#define ARC_VFS_STAT_COUNT       6
+
+// Timed operations
+#define ARC_VFS_LAT_STAT        0
+#define ARC_VFS_LAT_LOCATE      1
+#define ARC_VFS_LAT_READ        2
+#define ARC_VFS_LAT_WRITE       3
+#define ARC_VFS_LAT_CREATE      4
+#define ARC_VFS_LAT_REMOVE      5
+/// Time spent waiting for a branch_lock.
+#define ARC_VFS_LAT_BRANCH_LOCK 6
+#define ARC_VFS_LAT_COUNT       7
+
+// Bucket i of a histogram counts the operations that took [2^i, 2^(i + 1)) ticks
+#define ARC_VFS_HIST_BUCKETS 32
+
+struct ARC_VFSLatency {
+	uint64_t count;
+	/// Sum of the ticks taken.
+	uint64_t total;
+	uint64_t buckets[ARC_VFS_HIST_BUCKETS];
+};
+
+struct ARC_VFSStats {
+	uint64_t counters[ARC_VFS_STAT_COUNT];
+	struct ARC_VFSLatency latency[ARC_VFS_LAT_COUNT];
+};
+
+struct ARC_VFSStatsCPU {
+	struct ARC_VFSStats stats;
+} ARC_VFS_CACHE_ALIGNED;
+
+extern struct ARC_VFSStatsCPU vfs_stats_cpus[ARC_VFS_MAX_CPUS];
+
+#if ARC_VFS_STATS
+
+static inline uint64_t vfs_stats_clock() {
+	return vfs_cpu_clock();
+}
+
+static inline void vfs_stats_count(int counter) {
+	__atomic_add_fetch(&vfs_stats_cpus[vfs_current_cpu()].stats.counters[counter], 1, __ATOMIC_RELAXED);
+}
+
+// Record an operation of the given kind that began at start
+static inline void vfs_stats_time(int kind, uint64_t start) {
+	uint64_t ticks = vfs_stats_clock() - start;
+	struct ARC_VFSLatency *lat = &vfs_stats_cpus[vfs_current_cpu()].stats.latency[kind];
+	int bucket = ticks == 0 ? 0 : 63 - __builtin_clzll(ticks);
+
+	__atomic_add_fetch(&lat->count, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&lat->total, ticks, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&lat->buckets[bucket < ARC_VFS_HIST_BUCKETS ? bucket : ARC_VFS_HIST_BUCKETS - 1], 1, __ATOMIC_RELAXED);
+}
+
+// Evaluate call, recording how long it took as an operation of the given kind
+#define ARC_VFS_TIMED(kind, call) ({ \
+	uint64_t __vfs_start = vfs_stats_clock(); \
+	__typeof__(call) __vfs_ret = (call); \
+	vfs_stats_time((kind), __vfs_start); \
+	__vfs_ret; \
+})
+
+#else
+
+static inline uint64_t vfs_stats_clock() {
+	return 0;
+}
+
+static inline void vfs_stats_count(int counter) {
+	(void)counter;
+}
+
+static inline void vfs_stats_time(int kind, uint64_t start) {
+	(void)kind;
+	(void)start;
+}
+
+#define ARC_VFS_TIMED(kind, call) (call)
+
+#endif
+
+/**
+ * Initialize the statistics.
+ *
+ * @return zero on success.
+ * */
+int init_vfs_stats();
+
+/**
+ * Sum up the statistics of every processor.
+ *
+ * NOTE: Processors keep recording while this is done, the result is not a
+ *       snapshot of a single moment
+ *
+ * @param struct ARC_VFSStats *out - Where to write the sums.
+ * */
+void vfs_stats_collect(struct ARC_VFSStats *out);
+
+/**
+ * Write the statistics out as text.
+ *
+ * @param char *buf - Where to write them, may be NULL.
+ * @param size_t size - The size of buf.
+ * @return the length of the whole text, which is written as far as it fits.
+ * */
+size_t vfs_stats_render(char *buf, size_t size);
+
+struct ARC_VFSNode;
+
+/**
+ * Create a file which reads out the statistics.
+ *
+ * @param struct ARC_VFSNode *start - The node path starts from.
+ * @param char *path - Where to create the file, missing directories are created too.
+ * @return zero on success.
+ * */
+int vfs_stats_publish(struct ARC_VFSNode *start, char *path);
+
+#endif
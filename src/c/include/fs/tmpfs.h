@@ -0,0 +1,122 @@
+/**
+ * @file tmpfs.h
+ *
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan - Operating System Kernel
+ * Copyright (C) 2023-2025 awewsomegamer
+ *
+ * This file is part of Arctan.
+ *
+ * Arctan is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+ * Data of memory-only files and links, held by the VFS itself rather than by
+ * a resource. A file starts out with its data inline next to its size, and
+ * once it outgrows that moves to a radix tree of pages. Pages are only
+ * allocated when written, so holes cost nothing and read back as zeroes.
+ * Pages of deleted and truncated files are kept in a pool for the next file,
+ * which the memory manager takes back through vfs_reclaim.
+*/
+#ifndef ARC_VFS_TMPFS_H
+#define ARC_VFS_TMPFS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <fs/vfs.h>
+
+/// driver_index of memory-only files and links, see vfs_infer_driver.
+#define ARC_VFS_TMPFS_DRIVER ((uint64_t)-2)
+// Bytes a file may hold before it moves to pages
+#define ARC_VFS_TMPFS_INLINE 96
+// Slots of each radix tree node, must be a power of two
+#define ARC_VFS_TMPFS_FANOUT 64
+// Free pages kept for reuse
+#define ARC_VFS_TMPFS_POOL_MAX 128
+
+/**
+ * Initialize the tmpfs.
+ *
+ * @return zero on success.
+ * */
+int init_vfs_tmpfs();
+
+/**
+ * Give an empty file to a node.
+ *
+ * @return zero on success.
+ * */
+int vfs_tmpfs_create(struct ARC_VFSNode *node);
+
+/**
+ * Read from the file of a node.
+ *
+ * @return the number of bytes read.
+ * */
+size_t vfs_tmpfs_read(struct ARC_VFSNode *node, void *buffer, size_t len, long offset);
+
+/**
+ * Write to the file of a node, growing it as needed.
+ *
+ * @return the number of bytes written.
+ * */
+size_t vfs_tmpfs_write(struct ARC_VFSNode *node, void *buffer, size_t len, long offset);
+
+/**
+ * Set the size of the file of a node.
+ *
+ * Pages past the new end are freed, or only zeroed while the file is mapped.
+ *
+ * @return zero on success.
+ * */
+int vfs_tmpfs_truncate(struct ARC_VFSNode *node, size_t size);
+
+/**
+ * Note that a mapping of the file of a node was made or taken down.
+ *
+ * @param int delta - One for a new mapping, minus one for one taken down.
+ * */
+void vfs_tmpfs_map(struct ARC_VFSNode *node, int delta);
+
+/**
+ * Get a page of the file of a node to map, allocating it if it is a hole.
+ *
+ * The page stays where it is until the node is deleted, or until the file is
+ * truncated once nothing maps it anymore.
+ *
+ * @return page aligned pointer to ARC_VFS_PAGE_SIZE bytes, NULL on failure.
+ * */
+void *vfs_tmpfs_page(struct ARC_VFSNode *node, uint64_t index);
+
+/**
+ * Free the file of a node.
+ *
+ * NOTE: Called by vfs_delete_node once nobody can reach the node anymore.
+ * */
+void vfs_tmpfs_destroy(struct ARC_VFSNode *node);
+
+/**
+ * Free pages kept for reuse, for use by the memory manager when memory is short.
+ *
+ * NOTE: Reached through vfs_reclaim. The data of live files is the only copy
+ *       and is never given back.
+ *
+ * @param size_t count - The number of pages to try to free.
+ * @return the number of pages that were freed.
+ * */
+size_t vfs_tmpfs_shrink(size_t count);
+
+#endif
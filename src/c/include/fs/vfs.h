@@ -40,6 +40,12 @@
 #define ARC_VFS_N_FIFO  7
 #define ARC_VFS_N_DEV   8
 
+#define ARC_VFS_MAP_READ  1
+#define ARC_VFS_MAP_WRITE 2
+
+// Names up to this length are stored inside of the node itself
+#define ARC_VFS_INLINE_NAME 31
+
 #include <stddef.h>
 #include <stdint.h>
 #include <sys/stat.h>
@@ -47,36 +53,106 @@
 #include <lib/atomics.h>
 #include <stdbool.h>
 #include <abi-bits/seek-whence.h>
+#include <fs/rcu.h>
+#include <fs/percpu.h>
+#include <fs/rwlock.h>
+
+struct ARC_VFSNodeIndex;
+struct ARC_VFSPageCache;
+struct ARC_VFSTmpfsFile;
+struct ARC_VFSLinkCache;
+struct ARC_VFSRefCPU;
+
+/**
+ * Fields of a node that lookups never touch.
+ * */
+struct ARC_VFSNodeCold {
+	/// Pointer to the previous element in the current linked list, only used to unlink.
+	struct ARC_VFSNode *prev;
+	/// Number of nodes in the children linked list.
+	uint32_t child_count;
+	/// Every entry of the directory on disk has a node, so a miss needs no driver.
+	uint8_t populated;
+	/// Open vfs_opendir cursors, children still on disk keep their nodes while non-zero.
+	uint32_t dir_cursors;
+	/// Order in which the node was attached to its parent, the children list is sorted newest first.
+	uint64_t dir_seq;
+	/// Cached pages of the file, NULL until it is first read or written.
+	struct ARC_VFSPageCache *pcache;
+	/// Data of a memory-only file or link, which has no resource, see tmpfs.h.
+	struct ARC_VFSTmpfsFile *tmpfs;
+	/// Used to defer freeing the node until lockless readers are done with it.
+	struct ARC_VFSRCUHead rcu;
+	/// Lock on the properties of this node (type, stat)
+	ARC_GenericMutex property_lock;
+	/// Fetched from the driver on first need, see vfs_node_stat.
+	struct stat stat;
+	/// vfs_cpu_clock() when stat was fetched, zero if it has not been.
+	uint64_t stat_stamp;
+};
 
 /**
  * A single node in a VFS tree.
+ *
+ * NOTE: Every traversal step reads the first two cache lines of the nodes it
+ *       passes through and writes ref_count, so nothing that is written
+ *       shares a cache line with them, ref_count and the locks start on a
+ *       third.
  * */
 struct ARC_VFSNode {
-	struct ARC_VFSNode *mount;
-	/// Pointer to the link.
-	struct ARC_VFSNode *link;
-	/// Pointer to the parent of the current node.
-	struct ARC_VFSNode *parent;
+	// Read by every lookup, written only with the parent's branch_lock held
 	/// Pointer to the head of the children linked list.
 	struct ARC_VFSNode *children;
 	/// Pointer to the next element in the current linked list.
 	struct ARC_VFSNode *next;
-	/// Pointer to the previous element in the current linked list.
-	// TODO: There is no real need for this, can probably just be removed
-	struct ARC_VFSNode *prev;
-	struct ARC_Resource *resource;
-	/// The name of this node.
+	/// Pointer to the parent of the current node.
+	struct ARC_VFSNode *parent;
+	/// Hash index over the children, NULL until the directory grows large enough.
+	struct ARC_VFSNodeIndex *index;
+	/// The name of this node, points to name_inline if it fits.
 	char *name;
-	/// Number of references to this node (> 0 means node and children cannot be destroyed).
-	uint64_t ref_count;
-	/// Lock on branching of this node (link, parent, children, next, prev, name)
-	ARC_GenericMutex branch_lock;
-	/// Lock on the properties of this node (type, stat)
-	ARC_GenericMutex property_lock;
+	struct ARC_VFSNode *mount;
+	/// Pointer to the link.
+	struct ARC_VFSNode *link;
+	/// Sequence counter on children, next and index (odd while they are being modified).
+	uint32_t branch_seq;
 	/// The type of node.
 	int type;
-	// Stat
-	struct stat stat;
+
+	char name_inline[ARC_VFS_INLINE_NAME + 1] ARC_VFS_CACHE_ALIGNED;
+	/// Changes whenever the node is attached, detached or about to be deleted.
+	uint64_t gen;
+	/// Per processor reference counts, NULL while ref_count is used alone (see fs/ref.h).
+	struct ARC_VFSRefCPU *ref_cpus;
+	/// Unique, never reused, identifier of this node (0 is the root).
+	uint64_t id;
+	/// vfs_name_hash of name, a lookup only looks at the name itself if this and name_len match.
+	uint32_t name_hash;
+	uint16_t name_len;
+
+	// Written by every traversal step, and by whoever holds the locks
+	/// Number of references to this node (> 0 means node and children cannot be destroyed).
+	uint64_t ref_count ARC_VFS_CACHE_ALIGNED;
+	/// Links in the idle node cache (guarded by the lock of the list it is on).
+	struct ARC_VFSNode *lru_next;
+	struct ARC_VFSNode *lru_prev;
+	/// Which idle node list the node is on, zero if none.
+	uint8_t lru_state;
+	/// Set when the node is used again while cached.
+	uint8_t lru_referenced;
+	/// How ref_count is kept (ARC_VFS_REF_*).
+	uint8_t ref_state;
+	/// References taken while counted in ref_count alone.
+	uint32_t ref_heat;
+	/// Last resolution of the link's target, checked against the gen of every node it went through.
+	struct ARC_VFSLinkCache *link_cache;
+	/// Only needed once a lookup misses, or the node is opened.
+	struct ARC_Resource *resource;
+
+	/// Lock on branching of this node (link, parent, children, next, prev, name), taken shared by lookups
+	struct ARC_VFSRWLock branch_lock;
+
+	struct ARC_VFSNodeCold cold;
 };
 
 struct ARC_VFSNodeInfo {
@@ -90,6 +166,77 @@ struct ARC_VFSNodeInfo {
 	int code; // Return code of function that used info struct
 };
 
+/**
+ * A single buffer of a vectored transfer.
+ * */
+struct ARC_VFSIOVec {
+	void *base;
+	size_t len;
+};
+
+/**
+ * A view of part of a file straight onto its cached pages.
+ * */
+struct ARC_VFSMapping {
+	struct ARC_File *file;
+	/// The node whose pages are mapped (file->node with links followed).
+	struct ARC_VFSNode *node;
+	/// Offset of the first mapped byte in the file, page aligned.
+	long offset;
+	size_t length;
+	/// ARC_VFS_MAP_* flags.
+	int prot;
+	size_t page_count;
+	/// Data of each page once it has been faulted in, NULL before.
+	void **pages;
+};
+
+/**
+ * One entry of a directory as written by vfs_readdir.
+ * */
+struct ARC_VFSDirent {
+	uint64_t id;
+	/// Size of the whole record, the next one starts this many bytes in.
+	uint32_t reclen;
+	uint16_t name_len;
+	/// ARC_VFS_N_* type of the entry.
+	uint8_t type;
+	/// NULL terminated.
+	char name[];
+};
+
+/**
+ * A position in a directory, see vfs_opendir.
+ * */
+struct ARC_VFSDir {
+	struct ARC_VFSNode *node;
+	/// dir_seq of the last entry given out, zero before the first batch.
+	uint64_t last_seq;
+	/// Name of the last entry given out, used to find it again in one lookup.
+	char *last_name;
+	size_t last_len;
+};
+
+#define ARC_VFS_BATCH_CREATE 0
+#define ARC_VFS_BATCH_REMOVE 1
+#define ARC_VFS_BATCH_RENAME 2
+
+/**
+ * One operation of vfs_batch.
+ * */
+struct ARC_VFSBatchOp {
+	/// ARC_VFS_BATCH_*.
+	int op;
+	/// Absolute path that is created, removed or renamed.
+	char *path;
+	/// Where a rename moves path to.
+	char *target;
+	/// What a create makes, missing directories above it are made as well.
+	struct ARC_VFSNodeInfo info;
+	/// Set by vfs_batch, zero on success.
+	int result;
+};
+
 /**
  * Initalize the VFS root.
  *
@@ -97,11 +244,39 @@ struct ARC_VFSNodeInfo {
  * */
 int init_vfs();
 
+/**
+ * Build the initial tree from a prebuilt namespace image.
+ *
+ * Called once the image is mapped, typically straight after init_vfs, in
+ * place of creating every standard directory and device node by path. See
+ * nsimage.h for the format.
+ *
+ * @param void *image - The image, it is not used after this returns.
+ * @param size_t size - The size of the image in bytes.
+ * @return zero on success.
+ * */
+int vfs_load_image(void *image, size_t size);
+
+/**
+ * Give memory held by the VFS's caches back to the system.
+ *
+ * NOTE: This is the hook for the memory manager's reclaim path, and must be
+ *       called from it for the caches to track memory pressure, without it
+ *       they stay at their configured limits. It may delete nodes, so the
+ *       caller must not hold any branch_lock.
+ *
+ * @param size_t count - The number of objects to try to free.
+ * @return the number of objects that were freed.
+ * */
+size_t vfs_reclaim(size_t count);
+
 /**
  * Create a new mounted device under the given mountpoint.
  *
  * i.e. mount A at /mounts/A
  *
+ * Whatever the mountpoint holds is hidden until it is unmounted.
+ *
  * @param struct ARC_VFSNode *mountpoint - The VFS node under which to mount (/mounts).
  * @param char *name - The name of the mountpoint (A).
  * @param struct ARC_Resource *resource - The resource by which to address the mountpoint.
@@ -109,11 +284,26 @@ int init_vfs();
  * */
 int vfs_mount(char *mountpoint, struct ARC_Resource *resource);
 
+/**
+ * Show a directory of a mount at another directory as well.
+ *
+ * The target is mounted with the source's resource, rooted at wherever the
+ * source sits within it. Only what is on disk is shown, nodes that exist in
+ * memory alone are not.
+ *
+ * @param char *source - The directory to show.
+ * @param char *target - The directory to show it at.
+ * @return zero on success.
+ * */
+int vfs_bind(char *source, char *target);
+
 /**
  * Unmounts the given mountpoint
  *
  * All nodes under the given node will be destroyed and their
- * resources will be uninitialized and closed.
+ * resources will be uninitialized and closed. What the directory held
+ * before it was mounted on is then put back. Nothing is unmounted if a
+ * node under it is in use, or if other mounts sit below it.
  *
  * @param struct ARC_VFSNode *mount - The mount to unmount
  * @return zero on success.
@@ -131,6 +321,17 @@ int vfs_unmount(struct ARC_VFSNode *mount);
  * */
 int vfs_open(char *path, int flags, uint32_t mode, struct ARC_File **ret);
 
+/**
+ * Open a file, relative paths starting at dir.
+ *
+ * Only the components after dir are looked up. dir must be kept open for
+ * the duration of the call.
+ *
+ * @param struct ARC_File *dir - An open directory, may be NULL if path is absolute.
+ * @return as vfs_open.
+ * */
+int vfs_openat(struct ARC_File *dir, char *path, int flags, uint32_t mode, struct ARC_File **ret);
+
 /**
  * Read the given file.
  *
@@ -159,6 +360,123 @@ size_t vfs_read(void *buffer, size_t size, size_t count, struct ARC_File *file);
  * */
 size_t vfs_write(void *buffer, size_t size, size_t count, struct ARC_File *file);
 
+/**
+ * Read the given file into several buffers.
+ *
+ * Fills each buffer of /a iov in order, starting at the offset of
+ * /a file, which is advanced once by the total.
+ *
+ * @param struct ARC_VFSIOVec *iov - The buffers to read into.
+ * @param int iovcnt - The number of buffers.
+ * @param struct ARC_File *file - The file to read.
+ * @return the number of bytes read.
+ * */
+size_t vfs_readv(struct ARC_VFSIOVec *iov, int iovcnt, struct ARC_File *file);
+
+/**
+ * Write several buffers to the given file.
+ *
+ * @param struct ARC_VFSIOVec *iov - The buffers to write from.
+ * @param int iovcnt - The number of buffers.
+ * @param struct ARC_File *file - The file to write.
+ * @return the number of bytes written.
+ * */
+size_t vfs_writev(struct ARC_VFSIOVec *iov, int iovcnt, struct ARC_File *file);
+
+/**
+ * Read the given file at an offset into several buffers.
+ *
+ * The offset of /a file is neither used nor changed, so any number of
+ * threads may read the same file at the same time.
+ *
+ * @param struct ARC_VFSIOVec *iov - The buffers to read into.
+ * @param int iovcnt - The number of buffers.
+ * @param long offset - The offset in the file to start reading at.
+ * @param struct ARC_File *file - The file to read.
+ * @return the number of bytes read.
+ * */
+size_t vfs_preadv(struct ARC_VFSIOVec *iov, int iovcnt, long offset, struct ARC_File *file);
+
+/**
+ * Write several buffers to the given file at an offset.
+ *
+ * The offset of /a file is neither used nor changed.
+ *
+ * @param struct ARC_VFSIOVec *iov - The buffers to write from.
+ * @param int iovcnt - The number of buffers.
+ * @param long offset - The offset in the file to start writing at.
+ * @param struct ARC_File *file - The file to write.
+ * @return the number of bytes written.
+ * */
+size_t vfs_pwritev(struct ARC_VFSIOVec *iov, int iovcnt, long offset, struct ARC_File *file);
+
+/**
+ * Read the given file at an offset.
+ *
+ * Like vfs_read, but the offset of /a file is neither used nor changed.
+ *
+ * @param long offset - The offset in the file to start reading at.
+ * @return the number of bytes read.
+ * */
+size_t vfs_pread(void *buffer, size_t size, size_t count, long offset, struct ARC_File *file);
+
+/**
+ * Write to the given file at an offset.
+ *
+ * Like vfs_write, but the offset of /a file is neither used nor changed.
+ *
+ * @param long offset - The offset in the file to start writing at.
+ * @return the number of bytes written.
+ * */
+size_t vfs_pwrite(void *buffer, size_t size, size_t count, long offset, struct ARC_File *file);
+
+/**
+ * Map part of the given file.
+ *
+ * Nothing is read until the pages are faulted in, at which point the
+ * address space code can map the returned pages directly, no copy is made.
+ * The file cannot be closed while it is mapped.
+ *
+ * @param struct ARC_File *file - The file to map, must be backed by a mounted filesystem.
+ * @param long offset - The offset in the file to map from, must be page aligned.
+ * @param size_t length - The number of bytes to map.
+ * @param int prot - ARC_VFS_MAP_READ, optionally with ARC_VFS_MAP_WRITE.
+ * @param struct ARC_VFSMapping **ret - Where to write the address of the mapping.
+ * @return zero on success.
+ * */
+int vfs_mmap(struct ARC_File *file, long offset, size_t length, int prot, struct ARC_VFSMapping **ret);
+
+/**
+ * Fault in the page of a mapping that holds the given offset.
+ *
+ * Meant to be called from the page fault handler, which maps the result at
+ * the faulting address.
+ *
+ * @param struct ARC_VFSMapping *map - The mapping.
+ * @param size_t offset - Offset of the fault from the start of the mapping.
+ * @return page aligned pointer to the data of the page, NULL on failure.
+ * */
+void *vfs_mmap_fault(struct ARC_VFSMapping *map, size_t offset);
+
+/**
+ * Write stores made through a mapping back to the file.
+ *
+ * @param struct ARC_VFSMapping *map - The mapping.
+ * @return zero on success.
+ * */
+int vfs_msync(struct ARC_VFSMapping *map);
+
+/**
+ * Remove a mapping.
+ *
+ * The caller must have unmapped the pages from every address space first,
+ * writable mappings are synced.
+ *
+ * @param struct ARC_VFSMapping *map - The mapping.
+ * @return zero on success.
+ * */
+int vfs_munmap(struct ARC_VFSMapping *map);
+
 /**
  * Change the offset in the given file.
  *
@@ -177,6 +495,23 @@ int vfs_seek(struct ARC_File *file, long offset, int whence);
  * */
 int vfs_close(struct ARC_File *file);
 
+/**
+ * Write everything written to a file so far through to its driver.
+ *
+ * Writes are held back in the page cache to be merged, this hands them to
+ * the driver and asks it to make them durable, along with the file's metadata.
+ *
+ * @return zero once the data is durable.
+ * */
+int vfs_fsync(struct ARC_File *file);
+
+/**
+ * As vfs_fsync, but metadata that is not needed to read the data back may be left out.
+ *
+ * @return zero once the data is durable.
+ * */
+int vfs_fdatasync(struct ARC_File *file);
+
 /**
  * Get the status of a file
  *
@@ -189,12 +524,100 @@ int vfs_close(struct ARC_File *file);
  * */
 int vfs_stat(char *filepath, struct stat *stat);
 
+/**
+ * Get the status of a file, relative paths starting at dir.
+ *
+ * @param struct ARC_File *dir - An open directory, may be NULL if filepath is absolute.
+ * @return as vfs_stat.
+ * */
+int vfs_statat(struct ARC_File *dir, char *filepath, struct stat *stat);
+
+/**
+ * Change a working directory.
+ *
+ * The working directory is an open directory owned by its process, whose
+ * relative paths are given to the *at functions along with it.
+ *
+ * @param struct ARC_File **cwd - The working directory, NULL before the first change, replaced on success.
+ * @param char *path - The new working directory, relative paths start at the old one.
+ * @return zero on success.
+ * */
+int vfs_chdir(struct ARC_File **cwd, char *path);
+
+/**
+ * Get the absolute path of a working directory.
+ *
+ * @return the allocated path, NULL on failure.
+ * */
+char *vfs_getcwd(struct ARC_File *cwd);
+
+/**
+ * Open a directory for reading its entries.
+ *
+ * Directories on a driver that can list them are loaded in full first, and
+ * the idle node cache leaves their entries be until vfs_closedir.
+ *
+ * @param char *path - Path to the directory.
+ * @param struct ARC_VFSDir **ret - Where to write the address of the cursor.
+ * @return zero on success.
+ * */
+int vfs_opendir(char *path, struct ARC_VFSDir **ret);
+
+/**
+ * Read the next entries of a directory.
+ *
+ * Fills /a buffer with as many whole struct ARC_VFSDirent records as fit.
+ * The branch_lock is only held while a batch is copied, so the directory
+ * may change between calls: entries that exist for the whole scan are
+ * given out exactly once, entries added during it may be missed.
+ *
+ * @param struct ARC_VFSDir *dir - The cursor.
+ * @param void *buffer - Where to write the entries.
+ * @param size_t size - Size of the buffer in bytes.
+ * @return the number of bytes written, zero at the end of the directory,
+ * negative if the next entry does not fit or on error.
+ * */
+int vfs_readdir(struct ARC_VFSDir *dir, void *buffer, size_t size);
+
+/**
+ * Start reading the directory from the beginning again.
+ *
+ * A directory that could not be loaded in full before is tried again.
+ * */
+void vfs_rewinddir(struct ARC_VFSDir *dir);
+
+/**
+ * Close a directory opened with vfs_opendir.
+ *
+ * @return zero on success.
+ * */
+int vfs_closedir(struct ARC_VFSDir *dir);
+
 int vfs_create(char *path, struct ARC_VFSNodeInfo *info);
 int vfs_remove(char *filepath, bool recurse);
+// NOTE: As vfs_create and vfs_remove, relative paths start at the open directory dir
+int vfs_createat(struct ARC_File *dir, char *path, struct ARC_VFSNodeInfo *info);
+int vfs_removeat(struct ARC_File *dir, char *filepath, bool recurse);
 int vfs_link(char *a, char *b, int32_t mode);
 int vfs_rename(char *a, char *b);
 int vfs_list(char *path, int recurse);
 
+/**
+ * Perform many creates, removes and renames at once.
+ *
+ * Operations are grouped by the directory they are in, which is found once
+ * and whose branch_lock is taken once for the group. The paths of a group are
+ * handed to the driver together. Creates and renames are done first, parents
+ * before children, after which removes are done, children before parents.
+ * Within a directory the given order is kept. Removes are physical, do not
+ * recurse and do not prune emptied directories.
+ *
+ * @param struct ARC_VFSBatchOp *ops - The operations, the result of each is set.
+ * @param size_t count - The number of operations.
+ * @return the number of operations that failed, negative on error.
+ * */
+int vfs_batch(struct ARC_VFSBatchOp *ops, size_t count);
+
 /**
  * Get the path from B to A.
  * */
@@ -0,0 +1,310 @@
+/**
+ * @file driver_ext.c
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan - Operating System Kernel
+ * Copyright (C) 2023-2025 awewsomegamer
+ *
+ * This file is part of Arctan.
+ *
+ * Arctan is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+ * The mount table, hashed by the id of the mountpoint node. Each bucket has its
+ * own lock for mounting and unmounting, lookups walk the chains under RCU.
+*/
+#include <fs/mount.h>
+#include <fs/vfs.h>
+#include <fs/graph.h>
+#include <fs/rcu.h>
+#include <fs/ref.h>
+#include <mm/allocator.h>
+#include <lib/atomics.h>
+#include <lib/util.h>
+#include <global.h>
+
+struct ARC_VFSMount {
+	struct ARC_VFSMount *next;
+	struct ARC_VFSNode *point;
+	struct ARC_Resource *resource;
+	/// The mount that point belongs to, NULL if it is in memory.
+	struct ARC_VFSMount *parent;
+	/// Number of mounts whose parent this is.
+	uint32_t children;
+	/// What point held before it was mounted on.
+	struct ARC_VFSCovered covered;
+	/// Ticks of vfs_cpu_clock attributes of its nodes are trusted for.
+	uint64_t attr_ttl;
+	size_t prefix_len;
+	char prefix[];
+};
+
+static struct ARC_VFSMount *vfs_mount_table[ARC_VFS_MOUNT_BUCKETS] = { 0 };
+static ARC_GenericSpinlock vfs_mount_locks[ARC_VFS_MOUNT_BUCKETS];
+
+static size_t vfs_mount_bucket(struct ARC_VFSNode *point) {
+	return (point->id * 0x9E3779B97F4A7C15) >> 58;
+}
+
+int init_vfs_mount() {
+	for (int i = 0; i < ARC_VFS_MOUNT_BUCKETS; i++) {
+		init_static_spinlock(&vfs_mount_locks[i]);
+	}
+
+	return 0;
+}
+
+// NOTE: Expects to be called within an RCU read section
+static struct ARC_VFSMount *vfs_mount_find(struct ARC_VFSNode *point) {
+	if (point == NULL) {
+		return NULL;
+	}
+
+	struct ARC_VFSMount *mount = __atomic_load_n(&vfs_mount_table[vfs_mount_bucket(point)], __ATOMIC_ACQUIRE);
+
+	while (mount != NULL && mount->point != point) {
+		mount = __atomic_load_n(&mount->next, __ATOMIC_ACQUIRE);
+	}
+
+	return mount;
+}
+
+// The mountpoint of the mount node belongs to
+static struct ARC_VFSNode *vfs_mount_point_of(struct ARC_VFSNode *node) {
+	return node->type == ARC_VFS_N_MOUNT ? node : node->mount;
+}
+
+static void vfs_mount_insert(struct ARC_VFSMount *mount) {
+	size_t bucket = vfs_mount_bucket(mount->point);
+
+	spinlock_lock(&vfs_mount_locks[bucket]);
+	mount->next = vfs_mount_table[bucket];
+	__atomic_store_n(&vfs_mount_table[bucket], mount, __ATOMIC_RELEASE);
+	spinlock_unlock(&vfs_mount_locks[bucket]);
+}
+
+static void vfs_mount_remove(struct ARC_VFSMount *mount) {
+	size_t bucket = vfs_mount_bucket(mount->point);
+
+	spinlock_lock(&vfs_mount_locks[bucket]);
+
+	struct ARC_VFSMount **link = &vfs_mount_table[bucket];
+	while (*link != NULL && *link != mount) {
+		link = &(*link)->next;
+	}
+
+	if (*link != NULL) {
+		__atomic_store_n(link, mount->next, __ATOMIC_RELEASE);
+	}
+
+	spinlock_unlock(&vfs_mount_locks[bucket]);
+}
+
+int vfs_mount_attach(struct ARC_VFSNode *node, struct ARC_Resource *resource, char *prefix) {
+	if (node == NULL || resource == NULL) {
+		return -1;
+	}
+
+	size_t prefix_len = prefix == NULL ? 0 : strlen(prefix);
+	struct ARC_VFSMount *mount = (struct ARC_VFSMount *)alloc(sizeof(*mount) + prefix_len + 1);
+
+	if (mount == NULL) {
+		ARC_DEBUG(ERR, "Failed to allocate mount for \"%s\"\n", node->name);
+		return -2;
+	}
+
+	memset(mount, 0, sizeof(*mount));
+	mount->point = node;
+	mount->resource = resource;
+	mount->attr_ttl = ARC_VFS_ATTR_TTL;
+	mount->prefix_len = prefix_len;
+	memcpy(mount->prefix, prefix == NULL ? "" : prefix, prefix_len + 1);
+
+	vfs_branch_lock(node);
+
+	if (vfs_node_cover(node, resource, &mount->covered) != 0) {
+		vfs_branch_unlock(node);
+		ARC_DEBUG(ERR, "Cannot mount on \"%s\", it is not a directory\n", node->name);
+		free(mount);
+		return -3;
+	}
+
+	// NOTE: The parent cannot be unmounted in the meantime, node is pinned
+	//       and so it cannot be emptied
+	uint32_t token = vfs_rcu_read_lock();
+	mount->parent = node->mount == NULL ? NULL : vfs_mount_find(node->mount);
+
+	if (mount->parent != NULL) {
+		ARC_ATOMIC_INC(mount->parent->children);
+	}
+
+	vfs_rcu_read_unlock(token);
+
+	vfs_mount_insert(mount);
+
+	vfs_branch_unlock(node);
+
+	// Everything below passes through it
+	vfs_node_ref_percpu(node, 1);
+
+	return 0;
+}
+
+int vfs_mount_detach(struct ARC_VFSNode *node) {
+	if (node == NULL || node->type != ARC_VFS_N_MOUNT) {
+		return -1;
+	}
+
+	uint32_t token = vfs_rcu_read_lock();
+	struct ARC_VFSMount *mount = vfs_mount_find(node);
+	vfs_rcu_read_unlock(token);
+
+	if (mount == NULL) {
+		return -1;
+	}
+
+	if (__atomic_load_n(&mount->children, __ATOMIC_ACQUIRE) > 0) {
+		ARC_DEBUG(ERR, "Cannot unmount \"%s\", other mounts sit below it\n", node->name);
+		return -2;
+	}
+
+	// Drop everything that was loaded from the resource
+	vfs_branch_lock_shared(node);
+
+	size_t count = node->cold.child_count;
+	struct ARC_VFSNode **children = count == 0 ? NULL : (struct ARC_VFSNode **)alloc(sizeof(*children) * count);
+
+	if (count > 0 && children == NULL) {
+		vfs_branch_unlock_shared(node);
+		return -3;
+	}
+
+	size_t i = 0;
+	for (struct ARC_VFSNode *child = node->children; child != NULL && i < count; child = child->next) {
+		vfs_node_get(child);
+		children[i++] = child;
+	}
+	count = i;
+
+	vfs_branch_unlock_shared(node);
+
+	size_t left = 0;
+
+	for (i = 0; i < count; i++) {
+		// NOTE: The job pins the tree on its own, and a pin of ours would
+		//       keep the child in use
+		struct ARC_VFSDeleteJob *job = vfs_delete_job_create(children[i], 0);
+		vfs_node_put(children[i]);
+		left += job == NULL ? 1 : vfs_delete_job_destroy(job);
+	}
+
+	if (children != NULL) {
+		free(children);
+	}
+
+	// NOTE: Waits out a grace period, which must not be done with node's
+	//       branch_lock held, every lookup below it would stall
+	bool percpu = vfs_node_ref_collapse(node);
+
+	vfs_branch_lock(node);
+
+	// NOTE: Checked again under the lock that uncovers node, nodes may have
+	//       been loaded and mounts attached below it since. Both need a
+	//       node below it, which keeps children non-NULL
+	if (left > 0 || node->children != NULL || __atomic_load_n(&mount->children, __ATOMIC_ACQUIRE) > 0
+	    || vfs_node_uncover(node, &mount->covered) != 0) {
+		vfs_node_ref_restore(node, percpu);
+		vfs_branch_unlock(node);
+		ARC_DEBUG(ERR, "Cannot unmount \"%s\", it is in use\n", node->name);
+		return -3;
+	}
+
+	vfs_mount_remove(mount);
+
+	// Just a directory again, which may heat up like any other
+	vfs_node_ref_restore(node, 0);
+
+	vfs_branch_unlock(node);
+
+	if (mount->parent != NULL) {
+		ARC_ATOMIC_DEC(mount->parent->children);
+	}
+
+	vfs_rcu_free(mount);
+
+	vfs_node_put(node);
+
+	return 0;
+}
+
+struct ARC_Resource *vfs_mount_resource(struct ARC_VFSNode *node) {
+	if (node == NULL) {
+		return NULL;
+	}
+
+	uint32_t token = vfs_rcu_read_lock();
+	struct ARC_VFSMount *mount = vfs_mount_find(vfs_mount_point_of(node));
+	struct ARC_Resource *ret = mount == NULL ? NULL : mount->resource;
+	vfs_rcu_read_unlock(token);
+
+	return ret;
+}
+
+size_t vfs_mount_prefix(struct ARC_VFSNode *point, char *buf, size_t size) {
+	uint32_t token = vfs_rcu_read_lock();
+	struct ARC_VFSMount *mount = vfs_mount_find(point);
+	size_t len = mount == NULL ? 0 : mount->prefix_len;
+
+	if (buf != NULL && size > 0) {
+		size_t copy = min(len, size - 1);
+
+		if (mount != NULL) {
+			memcpy(buf, mount->prefix, copy);
+		}
+
+		buf[copy] = 0;
+	}
+
+	vfs_rcu_read_unlock(token);
+
+	return len;
+}
+
+int vfs_mount_set_attr_ttl(struct ARC_VFSNode *point, uint64_t ticks) {
+	uint32_t token = vfs_rcu_read_lock();
+	struct ARC_VFSMount *mount = vfs_mount_find(point);
+
+	if (mount != NULL) {
+		__atomic_store_n(&mount->attr_ttl, ticks, __ATOMIC_RELAXED);
+	}
+
+	vfs_rcu_read_unlock(token);
+
+	return mount == NULL ? -1 : 0;
+}
+
+uint64_t vfs_mount_attr_ttl(struct ARC_VFSNode *node) {
+	if (node == NULL) {
+		return ARC_VFS_ATTR_TTL;
+	}
+
+	uint32_t token = vfs_rcu_read_lock();
+	struct ARC_VFSMount *mount = vfs_mount_find(vfs_mount_point_of(node));
+	uint64_t ret = mount == NULL ? ARC_VFS_ATTR_TTL : __atomic_load_n(&mount->attr_ttl, __ATOMIC_RELAXED);
+	vfs_rcu_read_unlock(token);
+
+	return ret;
+}
@@ -0,0 +1,324 @@
+/**
+ * @file ncache.c
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan - Operating System Kernel
+ * Copyright (C) 2023-2025 awewsomegamer
+ *
+ * This file is part of Arctan.
+ *
+ * Arctan is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+ * The idle node cache, a least recently used list with a second chance for
+ * nodes that were touched while cached (CLOCK style). Nodes that turn out
+ * to be in use again when they reach the tail go back to the front as well,
+ * vfs_close already moves a node to the front whenever a file on it is closed.
+ *
+ * Freshly idle nodes go onto a small list belonging to the current processor
+ * so that closing a file does not touch any shared cache line. Once a shard
+ * overflows, its oldest nodes are moved to the global list in one batch, only
+ * the global list is ever evicted from.
+*/
+#include <fs/ncache.h>
+#include <fs/graph.h>
+#include <fs/percpu.h>
+#include <fs/ref.h>
+#include <fs/stats.h>
+#include <global.h>
+#include <lib/util.h>
+
+// Nodes a shard may hold before migrating
+#define ARC_VFS_NCACHE_SHARD_MAX 64
+// Nodes moved from a shard to the global list at once
+#define ARC_VFS_NCACHE_MIGRATE_BATCH 32
+// Most nodes to evict within a single insertion, more than a migration adds
+// so that the global list can catch back up
+#define ARC_VFS_NCACHE_EVICT_BATCH (ARC_VFS_NCACHE_MIGRATE_BATCH * 2)
+
+// lru_state of nodes on the global list, shards use their index plus one
+#define ARC_VFS_NCACHE_GLOBAL 0xFF
+
+struct ARC_VFSNcacheList {
+	ARC_GenericSpinlock lock;
+	struct ARC_VFSNode *head;
+	struct ARC_VFSNode *tail;
+	size_t count;
+} ARC_VFS_CACHE_ALIGNED;
+
+static struct ARC_VFSNcacheList vfs_ncache_shards[ARC_VFS_MAX_CPUS] = { 0 };
+static struct ARC_VFSNcacheList vfs_ncache_global = { 0 };
+/// The current limit of the global list, follows memory pressure.
+static size_t vfs_ncache_limit = ARC_VFS_NCACHE_DEFAULT;
+/// The limit that was configured.
+static size_t vfs_ncache_max = ARC_VFS_NCACHE_DEFAULT;
+
+int init_vfs_ncache() {
+	for (int i = 0; i < ARC_VFS_MAX_CPUS; i++) {
+		init_static_spinlock(&vfs_ncache_shards[i].lock);
+	}
+
+	init_static_spinlock(&vfs_ncache_global.lock);
+
+	return 0;
+}
+
+static struct ARC_VFSNcacheList *vfs_ncache_list(uint8_t state) {
+	if (state == ARC_VFS_NCACHE_GLOBAL) {
+		return &vfs_ncache_global;
+	}
+
+	return &vfs_ncache_shards[state - 1];
+}
+
+static void vfs_ncache_unlink(struct ARC_VFSNcacheList *list, struct ARC_VFSNode *node) {
+	if (node->lru_prev != NULL) {
+		node->lru_prev->lru_next = node->lru_next;
+	} else {
+		list->head = node->lru_next;
+	}
+
+	if (node->lru_next != NULL) {
+		node->lru_next->lru_prev = node->lru_prev;
+	} else {
+		list->tail = node->lru_prev;
+	}
+
+	node->lru_next = NULL;
+	node->lru_prev = NULL;
+	list->count--;
+}
+
+// Take a node off its list for good.
+//
+// NOTE: lru_state only drops to zero here, moving between lists goes straight
+//       from one state to the next, vfs_ncache_remove trusts a zero without
+//       taking any lock
+static void vfs_ncache_drop(struct ARC_VFSNcacheList *list, struct ARC_VFSNode *node) {
+	vfs_ncache_unlink(list, node);
+	__atomic_store_n(&node->lru_state, 0, __ATOMIC_RELEASE);
+}
+
+static void vfs_ncache_push(struct ARC_VFSNcacheList *list, struct ARC_VFSNode *node, uint8_t state) {
+	node->lru_prev = NULL;
+	node->lru_next = list->head;
+
+	if (list->head != NULL) {
+		list->head->lru_prev = node;
+	} else {
+		list->tail = node;
+	}
+
+	list->head = node;
+	__atomic_store_n(&node->lru_state, state, __ATOMIC_RELAXED);
+	list->count++;
+}
+
+// Move the oldest count nodes of a shard to the front of the global list,
+// keeping their relative order. NOTE: Expects both the shard's and the global
+// lock to be held, in that order.
+static void vfs_ncache_migrate(struct ARC_VFSNcacheList *shard, size_t count) {
+	// Oldest first, so each newer node ends up in front of it
+	struct ARC_VFSNode *node = shard->tail;
+
+	for (size_t i = 0; i < count && node != NULL; i++) {
+		struct ARC_VFSNode *newer = node->lru_prev;
+		vfs_ncache_unlink(shard, node);
+		vfs_ncache_push(&vfs_ncache_global, node, ARC_VFS_NCACHE_GLOBAL);
+		node = newer;
+	}
+}
+
+// Pick the next node to evict, the returned node is pinned by a reference
+// that vfs_delete_node is told to drop. NOTE: Expects the global lock to be held.
+static struct ARC_VFSNode *vfs_ncache_pick() {
+	// Every node gets at most one second chance per pick
+	size_t budget = vfs_ncache_global.count * 2;
+
+	while (vfs_ncache_global.tail != NULL && budget-- > 0) {
+		struct ARC_VFSNode *node = vfs_ncache_global.tail;
+
+		// NOTE: Nodes counted per processor are in use by definition, and
+		//       their ref_count alone means nothing. Children of a directory
+		//       that is being listed are kept, see vfs_delete_unlink
+		struct ARC_VFSNode *parent = __atomic_load_n(&node->parent, __ATOMIC_ACQUIRE);
+
+		if (node->ref_cpus == NULL && node->ref_count == 0 && !node->lru_referenced
+		    && (parent == NULL || __atomic_load_n(&parent->cold.dir_cursors, __ATOMIC_ACQUIRE) == 0)) {
+			// NOTE: Pinned before it leaves the list, vfs_ncache_remove does
+			//       not take the lock once it sees the node is on no list,
+			//       vfs_delete_node must still find the reference
+			vfs_node_get(node);
+			vfs_ncache_drop(&vfs_ncache_global, node);
+
+			return node;
+		}
+
+		// Wanted again, let the cache grow back towards its maximum
+		if (vfs_ncache_limit < vfs_ncache_max) {
+			vfs_ncache_limit++;
+		}
+
+		vfs_ncache_unlink(&vfs_ncache_global, node);
+		node->lru_referenced = 0;
+		vfs_ncache_push(&vfs_ncache_global, node, ARC_VFS_NCACHE_GLOBAL);
+	}
+
+	return NULL;
+}
+
+static size_t vfs_ncache_evict(size_t count) {
+	size_t evicted = 0;
+
+	while (evicted < count) {
+		spinlock_lock(&vfs_ncache_global.lock);
+		struct ARC_VFSNode *node = vfs_ncache_pick();
+		spinlock_unlock(&vfs_ncache_global.lock);
+
+		if (node == NULL) {
+			break;
+		}
+
+		// Prune upwards, drop the pinning reference once locked
+		if (vfs_delete_node(node, 1 | (1 << 2)) == 0) {
+			vfs_stats_count(ARC_VFS_STAT_NCACHE_EVICT);
+			evicted++;
+		}
+	}
+
+	return evicted;
+}
+
+static size_t vfs_ncache_global_over() {
+	return vfs_ncache_global.count > vfs_ncache_limit ? vfs_ncache_global.count - vfs_ncache_limit : 0;
+}
+
+// Move every shard's nodes onto the global list
+static void vfs_ncache_drain() {
+	for (int i = 0; i < ARC_VFS_MAX_CPUS; i++) {
+		struct ARC_VFSNcacheList *shard = &vfs_ncache_shards[i];
+
+		spinlock_lock(&shard->lock);
+		spinlock_lock(&vfs_ncache_global.lock);
+		vfs_ncache_migrate(shard, shard->count);
+		spinlock_unlock(&vfs_ncache_global.lock);
+		spinlock_unlock(&shard->lock);
+	}
+}
+
+static void vfs_ncache_link(struct ARC_VFSNode *node, bool evict) {
+	if (node == NULL || node->mount == NULL) {
+		// Memory-based nodes hold the only copy of their data
+		return;
+	}
+
+	uint32_t cpu = vfs_current_cpu();
+	struct ARC_VFSNcacheList *shard = &vfs_ncache_shards[cpu];
+	size_t over = 0;
+
+	// Take it off whatever list it is on so it can go to the front of the
+	// local one. NOTE: Files on the same node may be closed at the same time,
+	//       only the closer that claims the node may link it
+	for (;;) {
+		vfs_ncache_remove(node);
+
+		spinlock_lock(&shard->lock);
+
+		uint8_t expected = 0;
+		if (__atomic_compare_exchange_n(&node->lru_state, &expected, cpu + 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+			break;
+		}
+
+		spinlock_unlock(&shard->lock);
+	}
+
+	node->lru_referenced = 0;
+	vfs_ncache_push(shard, node, cpu + 1);
+
+	if (shard->count > ARC_VFS_NCACHE_SHARD_MAX) {
+		spinlock_lock(&vfs_ncache_global.lock);
+		vfs_ncache_migrate(shard, ARC_VFS_NCACHE_MIGRATE_BATCH);
+		over = vfs_ncache_global_over();
+		spinlock_unlock(&vfs_ncache_global.lock);
+	}
+
+	spinlock_unlock(&shard->lock);
+
+	if (evict && over > 0) {
+		vfs_ncache_evict(min(over, ARC_VFS_NCACHE_EVICT_BATCH));
+	}
+}
+
+void vfs_ncache_insert(struct ARC_VFSNode *node) {
+	vfs_ncache_link(node, 1);
+}
+
+void vfs_ncache_park(struct ARC_VFSNode *node) {
+	vfs_ncache_link(node, 0);
+}
+
+void vfs_ncache_remove(struct ARC_VFSNode *node) {
+	if (node == NULL) {
+		return;
+	}
+
+	// NOTE: A node only changes lists with the lock of the list it is on
+	//       held, so the state is rechecked once that lock is taken
+	for (;;) {
+		uint8_t state = __atomic_load_n(&node->lru_state, __ATOMIC_ACQUIRE);
+
+		if (state == 0) {
+			return;
+		}
+
+		struct ARC_VFSNcacheList *list = vfs_ncache_list(state);
+
+		spinlock_lock(&list->lock);
+
+		if (node->lru_state == state) {
+			vfs_ncache_drop(list, node);
+			spinlock_unlock(&list->lock);
+
+			return;
+		}
+
+		spinlock_unlock(&list->lock);
+	}
+}
+
+size_t vfs_ncache_shrink(size_t count) {
+	vfs_ncache_drain();
+
+	size_t evicted = vfs_ncache_evict(count);
+
+	spinlock_lock(&vfs_ncache_global.lock);
+	vfs_ncache_limit = max(vfs_ncache_global.count, ARC_VFS_NCACHE_MIN);
+	spinlock_unlock(&vfs_ncache_global.lock);
+
+	return evicted;
+}
+
+void vfs_ncache_set_limit(size_t limit) {
+	limit = max(limit, ARC_VFS_NCACHE_MIN);
+
+	spinlock_lock(&vfs_ncache_global.lock);
+	vfs_ncache_max = limit;
+	vfs_ncache_limit = limit;
+	size_t over = vfs_ncache_global_over();
+	spinlock_unlock(&vfs_ncache_global.lock);
+
+	vfs_ncache_evict(over);
+}
@@ -0,0 +1,195 @@
+/**
+ * @file nsimage.c
+ *
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan - Operating System Kernel
+ * Copyright (C) 2023-2025 awewsomegamer
+ *
+ * This file is part of Arctan.
+ *
+ * Arctan is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+ * Loading of namespace images. The image is checked as a whole first, so
+ * that a malformed one leaves the tree untouched, then each run of siblings
+ * is handed to vfs_create_children.
+*/
+#include <fs/nsimage.h>
+#include <fs/graph.h>
+#include <fs/ref.h>
+#include <fs/tmpfs.h>
+#include <global.h>
+#include <mm/allocator.h>
+
+static int vfs_image_check(struct ARC_VFSImageHeader *header, size_t size) {
+	if (header->magic != ARC_VFS_IMAGE_MAGIC || header->version != ARC_VFS_IMAGE_VERSION) {
+		ARC_DEBUG(ERR, "Not a namespace image, or of an unknown version\n");
+		return -1;
+	}
+
+	uint64_t entries_end = (uint64_t)header->entries + (uint64_t)header->entry_count * sizeof(struct ARC_VFSImageEntry);
+	uint64_t strings_end = (uint64_t)header->strings + header->strings_size;
+
+	if (entries_end > size || strings_end > size) {
+		ARC_DEBUG(ERR, "Namespace image is truncated\n");
+		return -1;
+	}
+
+	char *strings = (char *)header + header->strings;
+
+	if (header->strings_size == 0 || strings[header->strings_size - 1] != 0) {
+		// Every string ends before the table does
+		ARC_DEBUG(ERR, "Namespace image has unterminated strings\n");
+		return -1;
+	}
+
+	struct ARC_VFSImageEntry *entries = (struct ARC_VFSImageEntry *)((uint8_t *)header + header->entries);
+
+	for (uint32_t i = 0; i < header->entry_count; i++) {
+		struct ARC_VFSImageEntry *entry = &entries[i];
+
+		if (entry->name >= header->strings_size || (entry->target != ARC_VFS_IMAGE_NONE && entry->target >= header->strings_size)) {
+			ARC_DEBUG(ERR, "Entry %u of namespace image names a string out of bounds\n", i);
+			return -1;
+		}
+
+		char *name = strings + entry->name;
+
+		if (name[0] == 0 || strcmp(name, ".") == 0 || strcmp(name, "..") == 0 || strchr(name, '/') != NULL) {
+			ARC_DEBUG(ERR, "Entry %u of namespace image is not named a single component\n", i);
+			return -1;
+		}
+
+		if (entry->parent != ARC_VFS_IMAGE_TOP && (entry->parent >= i || entries[entry->parent].type != ARC_VFS_N_DIR)) {
+			ARC_DEBUG(ERR, "Entry %u of namespace image does not follow a directory parent\n", i);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+int vfs_image_load(struct ARC_VFSNode *top, void *image, size_t size) {
+	if (top == NULL || image == NULL || size < sizeof(struct ARC_VFSImageHeader)) {
+		return -1;
+	}
+
+	struct ARC_VFSImageHeader *header = (struct ARC_VFSImageHeader *)image;
+
+	if (vfs_image_check(header, size) != 0) {
+		return -1;
+	}
+
+	uint32_t count = header->entry_count;
+
+	if (count == 0) {
+		return 0;
+	}
+
+	struct ARC_VFSImageEntry *entries = (struct ARC_VFSImageEntry *)((uint8_t *)image + header->entries);
+	char *strings = (char *)image + header->strings;
+
+	// NOTE: One allocation for every table, pointers before the ints
+	size_t per_entry = sizeof(struct ARC_VFSNodeInfo) + sizeof(struct ARC_VFSNodeInfo *) + sizeof(char *)
+	                   + sizeof(struct ARC_VFSNode *) + sizeof(int);
+	uint8_t *tables = (uint8_t *)alloc(count * per_entry);
+
+	if (tables == NULL) {
+		ARC_DEBUG(ERR, "Failed to allocate tables for namespace image of %u entries\n", count);
+		return -2;
+	}
+
+	struct ARC_VFSNodeInfo *infos = (struct ARC_VFSNodeInfo *)tables;
+	struct ARC_VFSNodeInfo **info_ptrs = (struct ARC_VFSNodeInfo **)(infos + count);
+	char **names = (char **)(info_ptrs + count);
+	struct ARC_VFSNode **nodes = (struct ARC_VFSNode **)(names + count);
+	int *results = (int *)(nodes + count);
+	int ret = 0;
+
+	memset(infos, 0, count * sizeof(*infos));
+
+	for (uint32_t i = 0; i < count; i++) {
+		infos[i].type = entries[i].type;
+		infos[i].mode = entries[i].mode;
+		infos[i].driver_index = entries[i].driver_index;
+		infos[i].driver_arg = (void *)(uintptr_t)entries[i].driver_arg;
+		info_ptrs[i] = &infos[i];
+		names[i] = strings + entries[i].name;
+	}
+
+	// NOTE: Every node found or created is pinned until the whole image is
+	//       done, below a mount idle nodes may otherwise be evicted while
+	//       they are still to be the parent of a later run
+	for (uint32_t i = 0; i < count;) {
+		uint32_t parent = entries[i].parent;
+		uint32_t run = 1;
+
+		while (i + run < count && entries[i + run].parent == parent) {
+			run++;
+		}
+
+		struct ARC_VFSNode *dir = parent == ARC_VFS_IMAGE_TOP ? top : nodes[parent];
+
+		if (dir == NULL) {
+			// The parent could not be created, and neither can anything under it
+			for (uint32_t j = i; j < i + run; j++) {
+				nodes[j] = NULL;
+			}
+
+			ret = -2;
+			i += run;
+			continue;
+		}
+
+		vfs_create_children(dir, &names[i], &info_ptrs[i], run, &results[i], &nodes[i]);
+
+		for (uint32_t j = i; j < i + run; j++) {
+			if (results[j] != 0 || nodes[j] == NULL) {
+				ARC_DEBUG(ERR, "Failed to create \"%s\" of namespace image\n", names[j]);
+				ret = -2;
+				continue;
+			}
+
+			if (entries[j].type == ARC_VFS_N_DIR && nodes[j]->type != ARC_VFS_N_DIR && nodes[j]->type != ARC_VFS_N_MOUNT) {
+				ARC_DEBUG(ERR, "\"%s\" of namespace image already exists and is not a directory\n", names[j]);
+				vfs_node_put(nodes[j]);
+				nodes[j] = NULL;
+				ret = -2;
+				continue;
+			}
+
+			if (entries[j].target != ARC_VFS_IMAGE_NONE && nodes[j]->type == ARC_VFS_N_LINK && nodes[j]->cold.tmpfs != NULL
+			    && nodes[j]->cold.stat.st_size == 0) {
+				// Relative to the directory of the link, as vfs_link writes it
+				char *target = strings + entries[j].target;
+				vfs_tmpfs_write(nodes[j], target, strlen(target), 0);
+			}
+		}
+
+		i += run;
+	}
+
+	for (uint32_t i = 0; i < count; i++) {
+		if (nodes[i] != NULL) {
+			vfs_node_put(nodes[i]);
+		}
+	}
+
+	free(tables);
+
+	return ret;
+}
@@ -0,0 +1,894 @@
+/**
+ * @file pcache.c
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan - Operating System Kernel
+ * Copyright (C) 2023-2025 awewsomegamer
+ *
+ * This file is part of Arctan.
+ *
+ * Arctan is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+ * The page cache. Every cached node has a small hash table of its pages and
+ * a least recently used list over them, both guarded by one mutex which is
+ * also held while the driver is called to fill or write back pages. Caches
+ * with dirty pages are also kept on one list for vfs_pcache_flush_aged, whose
+ * mutex is never held while waiting for that of a cache.
+*/
+#include <fs/pcache.h>
+#include <fs/graph.h>
+#include <fs/driver_ext.h>
+#include <fs/stats.h>
+#include <global.h>
+#include <mm/allocator.h>
+#include <lib/atomics.h>
+#include <lib/perms.h>
+#include <lib/util.h>
+
+// Must be a power of two
+#define ARC_VFS_PCACHE_BUCKETS_MIN 16
+
+struct ARC_VFSPage {
+	uint64_t index;
+	struct ARC_VFSPage *hash_next;
+	struct ARC_VFSPage *lru_next;
+	struct ARC_VFSPage *lru_prev;
+	/// Bytes from the start of the page that hold file data.
+	uint32_t valid;
+	uint8_t dirty;
+	/// Number of mappings the page is handed out to, pinned pages are never recycled.
+	uint32_t pins;
+	/// Pins through writable mappings, the page stays dirty while there are any.
+	uint32_t write_pins;
+	/// Allocated on its own, a page sized allocation is a whole page which can be mapped.
+	uint8_t *data;
+};
+
+struct ARC_VFSPageCache {
+	ARC_GenericMutex lock;
+	struct ARC_VFSPage **buckets;
+	size_t bucket_count;
+	size_t nr_pages;
+	size_t nr_dirty;
+	/// vfs_cpu_clock when nr_dirty last rose from zero.
+	uint64_t dirty_since;
+	/// Most recently used first.
+	struct ARC_VFSPage *lru_head;
+	struct ARC_VFSPage *lru_tail;
+	/// The node the cache belongs to, for vfs_pcache_flush_aged.
+	struct ARC_VFSNode *node;
+	/// On the list of dirty caches, under vfs_pcache_dirty_lock.
+	struct ARC_VFSPageCache *dirty_next;
+	struct ARC_VFSPageCache *dirty_prev;
+	/// Set once dirty pages are on their way to the list, cleared with the cache's own lock held.
+	uint8_t tracked;
+	/// On the list, under vfs_pcache_dirty_lock.
+	uint8_t listed;
+	/// Picked by vfs_pcache_flush_aged, under vfs_pcache_dirty_lock.
+	uint8_t flushing;
+	/// The caches picked by vfs_pcache_flush_aged.
+	struct ARC_VFSPageCache *flush_next;
+};
+
+/// Pages cached across all nodes.
+static size_t vfs_pcache_total = 0;
+/// Caches that may have dirty pages.
+static struct ARC_VFSPageCache *vfs_pcache_dirty = NULL;
+static ARC_GenericMutex vfs_pcache_dirty_lock;
+/// Held by vfs_pcache_flush_aged while it writes back the caches it picked.
+static ARC_GenericMutex vfs_pcache_flush_lock;
+
+int init_vfs_pcache() {
+	init_static_mutex(&vfs_pcache_dirty_lock);
+	init_static_mutex(&vfs_pcache_flush_lock);
+
+	return 0;
+}
+
+bool vfs_pcache_usable(struct ARC_VFSNode *node) {
+	return node != NULL && node->type == ARC_VFS_N_FILE && node->mount != NULL
+	       && node->resource != NULL && node->resource->driver->read != NULL;
+}
+
+static struct ARC_VFSPageCache *vfs_pcache_get(struct ARC_VFSNode *node) {
+	struct ARC_VFSPageCache *cache = __atomic_load_n(&node->cold.pcache, __ATOMIC_ACQUIRE);
+
+	if (cache != NULL) {
+		return cache;
+	}
+
+	// The size of the file bounds read-ahead and partial page fills, from here
+	// on it is kept up to date by the cache itself
+	if (vfs_node_stat(node, NULL) != 0) {
+		return NULL;
+	}
+
+	cache = (struct ARC_VFSPageCache *)alloc(sizeof(*cache));
+
+	if (cache == NULL) {
+		return NULL;
+	}
+
+	memset(cache, 0, sizeof(*cache));
+	cache->buckets = (struct ARC_VFSPage **)alloc(ARC_VFS_PCACHE_BUCKETS_MIN * sizeof(struct ARC_VFSPage *));
+
+	if (cache->buckets == NULL) {
+		free(cache);
+		return NULL;
+	}
+
+	memset(cache->buckets, 0, ARC_VFS_PCACHE_BUCKETS_MIN * sizeof(struct ARC_VFSPage *));
+	cache->bucket_count = ARC_VFS_PCACHE_BUCKETS_MIN;
+	cache->node = node;
+	init_static_mutex(&cache->lock);
+
+	struct ARC_VFSPageCache *expected = NULL;
+	if (!__atomic_compare_exchange_n(&node->cold.pcache, &expected, cache, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+		// Someone else was first
+		free(cache->buckets);
+		free(cache);
+		return expected;
+	}
+
+	return cache;
+}
+
+static struct ARC_VFSPage *vfs_pcache_find(struct ARC_VFSPageCache *cache, uint64_t index) {
+	struct ARC_VFSPage *page = cache->buckets[index & (cache->bucket_count - 1)];
+
+	while (page != NULL && page->index != index) {
+		page = page->hash_next;
+	}
+
+	return page;
+}
+
+static void vfs_pcache_lru_unlink(struct ARC_VFSPageCache *cache, struct ARC_VFSPage *page) {
+	if (page->lru_prev != NULL) {
+		page->lru_prev->lru_next = page->lru_next;
+	} else {
+		cache->lru_head = page->lru_next;
+	}
+
+	if (page->lru_next != NULL) {
+		page->lru_next->lru_prev = page->lru_prev;
+	} else {
+		cache->lru_tail = page->lru_prev;
+	}
+
+	page->lru_next = NULL;
+	page->lru_prev = NULL;
+}
+
+static void vfs_pcache_lru_push(struct ARC_VFSPageCache *cache, struct ARC_VFSPage *page) {
+	page->lru_prev = NULL;
+	page->lru_next = cache->lru_head;
+
+	if (cache->lru_head != NULL) {
+		cache->lru_head->lru_prev = page;
+	} else {
+		cache->lru_tail = page;
+	}
+
+	cache->lru_head = page;
+}
+
+static void vfs_pcache_touch(struct ARC_VFSPageCache *cache, struct ARC_VFSPage *page) {
+	if (cache->lru_head != page) {
+		vfs_pcache_lru_unlink(cache, page);
+		vfs_pcache_lru_push(cache, page);
+	}
+}
+
+static void vfs_pcache_rehash(struct ARC_VFSPageCache *cache) {
+	size_t count = cache->bucket_count * 2;
+	struct ARC_VFSPage **buckets = (struct ARC_VFSPage **)alloc(count * sizeof(struct ARC_VFSPage *));
+
+	if (buckets == NULL) {
+		// Longer chains, but still correct
+		return;
+	}
+
+	memset(buckets, 0, count * sizeof(struct ARC_VFSPage *));
+
+	for (size_t i = 0; i < cache->bucket_count; i++) {
+		struct ARC_VFSPage *page = cache->buckets[i];
+
+		while (page != NULL) {
+			struct ARC_VFSPage *next = page->hash_next;
+			page->hash_next = buckets[page->index & (count - 1)];
+			buckets[page->index & (count - 1)] = page;
+			page = next;
+		}
+	}
+
+	free(cache->buckets);
+	cache->buckets = buckets;
+	cache->bucket_count = count;
+}
+
+static void vfs_pcache_insert(struct ARC_VFSPageCache *cache, struct ARC_VFSPage *page) {
+	if (cache->nr_pages >= cache->bucket_count * 2) {
+		vfs_pcache_rehash(cache);
+	}
+
+	struct ARC_VFSPage **bucket = &cache->buckets[page->index & (cache->bucket_count - 1)];
+	page->hash_next = *bucket;
+	*bucket = page;
+
+	vfs_pcache_lru_push(cache, page);
+	cache->nr_pages++;
+	__atomic_add_fetch(&vfs_pcache_total, 1, __ATOMIC_RELAXED);
+}
+
+static void vfs_pcache_remove(struct ARC_VFSPageCache *cache, struct ARC_VFSPage *page) {
+	struct ARC_VFSPage **link = &cache->buckets[page->index & (cache->bucket_count - 1)];
+
+	while (*link != NULL && *link != page) {
+		link = &(*link)->hash_next;
+	}
+
+	if (*link == page) {
+		*link = page->hash_next;
+	}
+
+	vfs_pcache_lru_unlink(cache, page);
+
+	if (page->dirty) {
+		cache->nr_dirty--;
+	}
+
+	cache->nr_pages--;
+	__atomic_sub_fetch(&vfs_pcache_total, 1, __ATOMIC_RELAXED);
+}
+
+static void vfs_pcache_mark_dirty(struct ARC_VFSPageCache *cache, struct ARC_VFSPage *page) {
+	if (page->dirty) {
+		return;
+	}
+
+	if (cache->nr_dirty == 0) {
+		cache->dirty_since = vfs_cpu_clock();
+	}
+
+	page->dirty = 1;
+	cache->nr_dirty++;
+}
+
+// Put a cache that has dirty pages on the list of vfs_pcache_flush_aged
+// NOTE: Expects the cache's lock not to be held
+static void vfs_pcache_track(struct ARC_VFSPageCache *cache) {
+	if (__atomic_load_n(&cache->tracked, __ATOMIC_ACQUIRE) || __atomic_load_n(&cache->nr_dirty, __ATOMIC_RELAXED) == 0) {
+		return;
+	}
+
+	mutex_lock(&vfs_pcache_dirty_lock);
+
+	// NOTE: A cache being flushed may have been found clean and still be
+	//       listed, vfs_pcache_flush_aged leaves it there once it sees this
+	if (!cache->listed) {
+		cache->dirty_prev = NULL;
+		cache->dirty_next = vfs_pcache_dirty;
+
+		if (vfs_pcache_dirty != NULL) {
+			vfs_pcache_dirty->dirty_prev = cache;
+		}
+
+		__atomic_store_n(&vfs_pcache_dirty, cache, __ATOMIC_RELAXED);
+		cache->listed = 1;
+	}
+
+	__atomic_store_n(&cache->tracked, 1, __ATOMIC_RELEASE);
+
+	mutex_unlock(&vfs_pcache_dirty_lock);
+}
+
+// NOTE: Expects vfs_pcache_dirty_lock to be held
+static void vfs_pcache_untrack(struct ARC_VFSPageCache *cache) {
+	if (!cache->listed) {
+		return;
+	}
+
+	if (cache->dirty_prev != NULL) {
+		cache->dirty_prev->dirty_next = cache->dirty_next;
+	} else if (vfs_pcache_dirty == cache) {
+		__atomic_store_n(&vfs_pcache_dirty, cache->dirty_next, __ATOMIC_RELAXED);
+	}
+
+	if (cache->dirty_next != NULL) {
+		cache->dirty_next->dirty_prev = cache->dirty_prev;
+	}
+
+	cache->dirty_next = NULL;
+	cache->dirty_prev = NULL;
+	cache->listed = 0;
+}
+
+static int vfs_pcache_write_page(struct ARC_VFSNode *node, struct ARC_VFSPageCache *cache, struct ARC_File *desc, struct ARC_VFSPage *page) {
+	if (!page->dirty) {
+		return 0;
+	}
+
+	struct ARC_Resource *res = node->resource;
+
+	if (res->driver->write == NULL) {
+		return -1;
+	}
+
+	struct ARC_File internal_desc = { 0 };
+	memcpy(&internal_desc, desc, sizeof(internal_desc));
+	internal_desc.offset = page->index * ARC_VFS_PAGE_SIZE;
+
+	if (ARC_VFS_TIMED(ARC_VFS_LAT_WRITE, res->driver->write(page->data, 1, page->valid, &internal_desc, res)) != page->valid) {
+		ARC_DEBUG(ERR, "Failed to write back page %lu of \"%s\"\n", page->index, node->name);
+		return -2;
+	}
+
+	if (page->write_pins == 0) {
+		page->dirty = 0;
+		cache->nr_dirty--;
+	}
+
+	return 0;
+}
+
+static int vfs_pcache_writeback_locked(struct ARC_VFSNode *node, struct ARC_VFSPageCache *cache, struct ARC_File *desc) {
+	int err = 0;
+
+	for (struct ARC_VFSPage *page = cache->lru_head; page != NULL && cache->nr_dirty > 0; page = page->lru_next) {
+		if (vfs_pcache_write_page(node, cache, desc, page) != 0) {
+			err = -1;
+		}
+	}
+
+	return err;
+}
+
+// Get a blank page for the cache, recycling the node's own least recently used
+// page if it holds too many or the cache as a whole is full
+static void vfs_pcache_free_page(struct ARC_VFSPage *page) {
+	free(page->data);
+	free(page);
+}
+
+static struct ARC_VFSPage *vfs_pcache_new_page(struct ARC_VFSNode *node, struct ARC_VFSPageCache *cache, struct ARC_File *desc) {
+	struct ARC_VFSPage *page = cache->lru_tail;
+	bool recycle = cache->nr_pages >= ARC_VFS_PCACHE_NODE_MAX
+	               || __atomic_load_n(&vfs_pcache_total, __ATOMIC_RELAXED) >= ARC_VFS_PCACHE_GLOBAL_MAX;
+
+	while (page != NULL && page->pins > 0) {
+		// Mapped somewhere, the next least recently used one
+		page = page->lru_prev;
+	}
+
+	// NOTE: A page that cannot be written back is kept, allocating past
+	//       the limit is better than losing data
+	if (recycle && page != NULL && vfs_pcache_write_page(node, cache, desc, page) == 0) {
+		vfs_pcache_remove(cache, page);
+
+		uint8_t *data = page->data;
+		memset(page, 0, sizeof(*page));
+		page->data = data;
+	} else {
+		page = (struct ARC_VFSPage *)alloc(sizeof(*page));
+
+		if (page == NULL) {
+			return NULL;
+		}
+
+		memset(page, 0, sizeof(*page));
+		page->data = (uint8_t *)alloc(ARC_VFS_PAGE_SIZE);
+
+		if (page->data == NULL) {
+			free(page);
+			return NULL;
+		}
+	}
+
+	memset(page->data, 0, ARC_VFS_PAGE_SIZE);
+
+	return page;
+}
+
+// Read up to count pages starting at index from the driver, stopping at the
+// first one that is already cached. Returns the page at index.
+static struct ARC_VFSPage *vfs_pcache_fill(struct ARC_VFSNode *node, struct ARC_VFSPageCache *cache, struct ARC_File *desc, uint64_t index, uint32_t count) {
+	struct ARC_VFSPage *pages[ARC_VFS_PCACHE_RA_MAX] = { 0 };
+	struct ARC_VFSIOVec iov[ARC_VFS_PCACHE_RA_MAX] = { 0 };
+	struct ARC_Resource *res = node->resource;
+
+	// NOTE: Known since the cache was made, vfs_pcache_get fetched it
+	mutex_lock(&node->cold.property_lock);
+	size_t size = node->cold.stat.st_size;
+	mutex_unlock(&node->cold.property_lock);
+
+	if (size > 0) {
+		// Do not read ahead past the end of the file
+		uint64_t last = (size - 1) / ARC_VFS_PAGE_SIZE;
+		count = index < last ? min(count, last - index + 1) : 1;
+	}
+
+	count = max(min(count, ARC_VFS_PCACHE_RA_MAX), 1);
+
+	uint32_t n = 0;
+	for (; n < count; n++) {
+		if (n > 0 && vfs_pcache_find(cache, index + n) != NULL) {
+			break;
+		}
+
+		pages[n] = vfs_pcache_new_page(node, cache, desc);
+
+		if (pages[n] == NULL) {
+			break;
+		}
+
+		pages[n]->index = index + n;
+		iov[n].base = pages[n]->data;
+		iov[n].len = ARC_VFS_PAGE_SIZE;
+	}
+
+	if (n == 0) {
+		return NULL;
+	}
+
+	struct ARC_File internal_desc = { 0 };
+	memcpy(&internal_desc, desc, sizeof(internal_desc));
+
+	struct ARC_VFSDriverExt *ext = vfs_driver_ext(res->driver);
+
+	if (ext != NULL && ext->readv != NULL) {
+		// All of the pages in one request
+		size_t got = ARC_VFS_TIMED(ARC_VFS_LAT_READ, ext->readv(iov, n, index * ARC_VFS_PAGE_SIZE, &internal_desc, res));
+
+		for (uint32_t i = 0; i < n; i++) {
+			size_t start = i * ARC_VFS_PAGE_SIZE;
+			pages[i]->valid = got > start ? min(got - start, ARC_VFS_PAGE_SIZE) : 0;
+		}
+	} else {
+		for (uint32_t i = 0; i < n; i++) {
+			internal_desc.offset = pages[i]->index * ARC_VFS_PAGE_SIZE;
+			pages[i]->valid = ARC_VFS_TIMED(ARC_VFS_LAT_READ, res->driver->read(pages[i]->data, 1, ARC_VFS_PAGE_SIZE, &internal_desc, res));
+
+			if (pages[i]->valid < ARC_VFS_PAGE_SIZE) {
+				// End of the file, the rest stays empty
+				break;
+			}
+		}
+	}
+
+	if (pages[0]->valid == 0 && index * ARC_VFS_PAGE_SIZE < size) {
+		// NOTE: Reads report failure as nothing read, which the size says
+		//       is not the end of the file, so none of it is kept
+		ARC_DEBUG(ERR, "Failed to read page %lu of \"%s\"\n", index, node->name);
+
+		for (uint32_t i = 0; i < n; i++) {
+			vfs_pcache_free_page(pages[i]);
+		}
+
+		return NULL;
+	}
+
+	// Keep the first page even if it is empty, it is past the end of the
+	// file and records where that is
+	vfs_pcache_insert(cache, pages[0]);
+
+	for (uint32_t i = 1; i < n; i++) {
+		if (pages[i]->valid == 0) {
+			vfs_pcache_free_page(pages[i]);
+			continue;
+		}
+
+		vfs_pcache_insert(cache, pages[i]);
+	}
+
+	// The page that was asked for is the most recently used
+	vfs_pcache_touch(cache, pages[0]);
+
+	return pages[0];
+}
+
+// Start a new read-ahead window at index, twice the size of the last one
+static void vfs_pcache_readahead(struct ARC_VFSNode *node, struct ARC_VFSPageCache *cache, struct ARC_File *desc, struct ARC_VFSReadahead *ra, uint64_t index) {
+	ra->start = index;
+	ra->size = ra->size == 0 ? ARC_VFS_PCACHE_RA_MIN : min(ra->size * 2, ARC_VFS_PCACHE_RA_MAX);
+	// NOTE: The next window is already fetched once the reader is halfway
+	//       through this one, so a steady stream never waits on a miss
+	ra->marker = index + ra->size / 2;
+
+	if (vfs_pcache_find(cache, index) == NULL) {
+		vfs_pcache_fill(node, cache, desc, index, ra->size);
+	}
+}
+
+// Account for a read at offset, returns whether it continues a stream
+static bool vfs_pcache_ra_update(struct ARC_VFSReadahead *ra, long offset) {
+	if (ra == NULL) {
+		return false;
+	}
+
+	if (offset == ra->next) {
+		ra->run++;
+	} else {
+		// Random access, forget the window
+		ra->run = 0;
+		ra->size = 0;
+	}
+
+	// A first read from the start of the file is taken as the start of a stream
+	return ra->run > 0 || offset == 0;
+}
+
+size_t vfs_pcache_read(struct ARC_VFSNode *node, struct ARC_File *desc, struct ARC_VFSReadahead *ra, void *buffer, size_t len, long offset) {
+	struct ARC_VFSPageCache *cache = vfs_pcache_get(node);
+	struct ARC_Resource *res = node->resource;
+
+	if (cache == NULL) {
+		struct ARC_File internal_desc = { 0 };
+		memcpy(&internal_desc, desc, sizeof(internal_desc));
+		internal_desc.offset = offset;
+
+		return ARC_VFS_TIMED(ARC_VFS_LAT_READ, res->driver->read(buffer, 1, len, &internal_desc, res));
+	}
+
+	mutex_lock(&cache->lock);
+
+	bool sequential = vfs_pcache_ra_update(ra, offset);
+
+	size_t done = 0;
+
+	while (done < len) {
+		uint64_t index = (offset + done) / ARC_VFS_PAGE_SIZE;
+		size_t in_page = (offset + done) % ARC_VFS_PAGE_SIZE;
+		struct ARC_VFSPage *page = vfs_pcache_find(cache, index);
+
+		if (sequential && (page == NULL || (ra->size > 0 && index == ra->marker))) {
+			vfs_pcache_readahead(node, cache, desc, ra, page == NULL ? index : ra->start + ra->size);
+			page = vfs_pcache_find(cache, index);
+		}
+
+		if (page == NULL) {
+			// Only the pages this request covers
+			size_t left = (in_page + len - done + ARC_VFS_PAGE_SIZE - 1) / ARC_VFS_PAGE_SIZE;
+			page = vfs_pcache_fill(node, cache, desc, index, min(left, ARC_VFS_PCACHE_RA_MAX));
+		} else {
+			vfs_pcache_touch(cache, page);
+		}
+
+		if (page == NULL || in_page >= page->valid) {
+			break;
+		}
+
+		size_t count = min(page->valid - in_page, len - done);
+		memcpy((uint8_t *)buffer + done, page->data + in_page, count);
+		done += count;
+
+		if (page->valid < ARC_VFS_PAGE_SIZE) {
+			// A short page is the last one of the file
+			break;
+		}
+	}
+
+	if (ra != NULL) {
+		ra->next = offset + done;
+	}
+
+	mutex_unlock(&cache->lock);
+
+	return done;
+}
+
+size_t vfs_pcache_write(struct ARC_VFSNode *node, struct ARC_File *desc, void *buffer, size_t len, long offset) {
+	struct ARC_Resource *res = node->resource;
+
+	if (res->driver->write == NULL) {
+		return 0;
+	}
+
+	struct ARC_VFSPageCache *cache = vfs_pcache_get(node);
+
+	if (cache == NULL) {
+		struct ARC_File internal_desc = { 0 };
+		memcpy(&internal_desc, desc, sizeof(internal_desc));
+		internal_desc.offset = offset;
+
+		size_t ret = ARC_VFS_TIMED(ARC_VFS_LAT_WRITE, res->driver->write(buffer, 1, len, &internal_desc, res));
+		vfs_node_stat_invalidate(node);
+
+		return ret;
+	}
+
+	mutex_lock(&cache->lock);
+
+	size_t done = 0;
+
+	while (done < len) {
+		uint64_t index = (offset + done) / ARC_VFS_PAGE_SIZE;
+		size_t in_page = (offset + done) % ARC_VFS_PAGE_SIZE;
+		size_t count = min(ARC_VFS_PAGE_SIZE - in_page, len - done);
+		struct ARC_VFSPage *page = vfs_pcache_find(cache, index);
+
+		if (page == NULL) {
+			if ((in_page > 0 || count < ARC_VFS_PAGE_SIZE) && index * ARC_VFS_PAGE_SIZE < (uint64_t)node->cold.stat.st_size) {
+				// Only part of the page is overwritten, the rest has to come from the file
+				page = vfs_pcache_fill(node, cache, desc, index, 1);
+			} else if ((page = vfs_pcache_new_page(node, cache, desc)) != NULL) {
+				page->index = index;
+				vfs_pcache_insert(cache, page);
+			}
+
+			if (page == NULL) {
+				break;
+			}
+		} else {
+			vfs_pcache_touch(cache, page);
+		}
+
+		if (in_page > page->valid) {
+			// Writing past the end leaves a hole of zeroes
+			memset(page->data + page->valid, 0, in_page - page->valid);
+		}
+
+		memcpy(page->data + in_page, (uint8_t *)buffer + done, count);
+		page->valid = max(page->valid, in_page + count);
+		vfs_pcache_mark_dirty(cache, page);
+
+		done += count;
+	}
+
+	mutex_lock(&node->cold.property_lock);
+
+	if (offset + done > (size_t)node->cold.stat.st_size) {
+		node->cold.stat.st_size = offset + done;
+	}
+
+	mutex_unlock(&node->cold.property_lock);
+
+	if (cache->nr_dirty > ARC_VFS_PCACHE_DIRTY_MAX
+	    || (cache->nr_dirty > 0 && vfs_cpu_clock() - cache->dirty_since > ARC_VFS_PCACHE_DIRTY_TICKS)) {
+		vfs_pcache_writeback_locked(node, cache, desc);
+	}
+
+	mutex_unlock(&cache->lock);
+
+	vfs_pcache_track(cache);
+
+	return done;
+}
+
+void *vfs_pcache_pin(struct ARC_VFSNode *node, struct ARC_File *desc, struct ARC_VFSReadahead *ra, uint64_t index, bool write) {
+	struct ARC_VFSPageCache *cache = vfs_pcache_get(node);
+
+	if (cache == NULL) {
+		return NULL;
+	}
+
+	mutex_lock(&cache->lock);
+
+	bool sequential = vfs_pcache_ra_update(ra, index * ARC_VFS_PAGE_SIZE);
+	struct ARC_VFSPage *page = vfs_pcache_find(cache, index);
+
+	if (sequential && (page == NULL || (ra->size > 0 && index == ra->marker))) {
+		vfs_pcache_readahead(node, cache, desc, ra, page == NULL ? index : ra->start + ra->size);
+		page = vfs_pcache_find(cache, index);
+	}
+
+	if (page == NULL) {
+		page = vfs_pcache_fill(node, cache, desc, index, 1);
+	} else {
+		vfs_pcache_touch(cache, page);
+	}
+
+	if (page != NULL) {
+		page->pins++;
+
+		if (write) {
+			// NOTE: Stores through the mapping cannot be seen, so the page
+			//       is taken to be dirty for as long as it is mapped
+			page->write_pins++;
+			vfs_pcache_mark_dirty(cache, page);
+		}
+	}
+
+	if (ra != NULL) {
+		ra->next = (index + 1) * ARC_VFS_PAGE_SIZE;
+	}
+
+	mutex_unlock(&cache->lock);
+
+	if (write) {
+		vfs_pcache_track(cache);
+	}
+
+	return page == NULL ? NULL : page->data;
+}
+
+int vfs_pcache_unpin(struct ARC_VFSNode *node, uint64_t index, bool write) {
+	if (node == NULL) {
+		return -1;
+	}
+
+	struct ARC_VFSPageCache *cache = __atomic_load_n(&node->cold.pcache, __ATOMIC_ACQUIRE);
+
+	if (cache == NULL) {
+		return -2;
+	}
+
+	mutex_lock(&cache->lock);
+
+	struct ARC_VFSPage *page = vfs_pcache_find(cache, index);
+
+	if (page == NULL || page->pins == 0) {
+		mutex_unlock(&cache->lock);
+		ARC_DEBUG(ERR, "Page %lu of \"%s\" is not pinned\n", index, node->name);
+		return -3;
+	}
+
+	page->pins--;
+
+	if (write && page->write_pins > 0) {
+		// Still dirty, the next write back catches the last stores
+		page->write_pins--;
+	}
+
+	mutex_unlock(&cache->lock);
+
+	return 0;
+}
+
+int vfs_pcache_writeback(struct ARC_VFSNode *node) {
+	if (node == NULL) {
+		return -1;
+	}
+
+	struct ARC_VFSPageCache *cache = __atomic_load_n(&node->cold.pcache, __ATOMIC_ACQUIRE);
+
+	if (cache == NULL) {
+		return 0;
+	}
+
+	if (__atomic_load_n(&cache->nr_dirty, __ATOMIC_ACQUIRE) == 0) {
+		// NOTE: Writes that finished before the call are seen, one racing
+		//       with it was not asked for
+		return 0;
+	}
+
+	struct ARC_File desc = { .mode = ARC_STD_PERM, .node = node };
+
+	mutex_lock(&cache->lock);
+	int err = vfs_pcache_writeback_locked(node, cache, &desc);
+	mutex_unlock(&cache->lock);
+
+	return err;
+}
+
+void vfs_pcache_destroy(struct ARC_VFSNode *node, bool writeback) {
+	if (node == NULL) {
+		return;
+	}
+
+	struct ARC_VFSPageCache *cache = __atomic_exchange_n(&node->cold.pcache, NULL, __ATOMIC_ACQ_REL);
+
+	if (cache == NULL) {
+		return;
+	}
+
+	mutex_lock(&vfs_pcache_dirty_lock);
+
+	while (cache->flushing) {
+		// Being written back, wait for vfs_pcache_flush_aged to let go
+		mutex_unlock(&vfs_pcache_dirty_lock);
+		mutex_lock(&vfs_pcache_flush_lock);
+		mutex_unlock(&vfs_pcache_flush_lock);
+		mutex_lock(&vfs_pcache_dirty_lock);
+	}
+
+	vfs_pcache_untrack(cache);
+
+	mutex_unlock(&vfs_pcache_dirty_lock);
+
+	if (writeback) {
+		struct ARC_File desc = { .mode = ARC_STD_PERM, .node = node };
+		vfs_pcache_writeback_locked(node, cache, &desc);
+	}
+
+	struct ARC_VFSPage *page = cache->lru_head;
+
+	while (page != NULL) {
+		struct ARC_VFSPage *next = page->lru_next;
+		vfs_pcache_free_page(page);
+		page = next;
+	}
+
+	__atomic_sub_fetch(&vfs_pcache_total, cache->nr_pages, __ATOMIC_RELAXED);
+
+	free(cache->buckets);
+	free(cache);
+}
+
+size_t vfs_pcache_flush_aged() {
+	if (__atomic_load_n(&vfs_pcache_dirty, __ATOMIC_RELAXED) == NULL) {
+		return 0;
+	}
+
+	size_t flushed = 0;
+	struct ARC_VFSPageCache *picked = NULL;
+
+	mutex_lock(&vfs_pcache_flush_lock);
+
+	// Pick the caches to look at, the list itself is only held for that
+	mutex_lock(&vfs_pcache_dirty_lock);
+
+	uint64_t now = vfs_cpu_clock();
+
+	for (struct ARC_VFSPageCache *cache = vfs_pcache_dirty; cache != NULL; cache = cache->dirty_next) {
+		// NOTE: Read without the cache's lock, which may be held across I/O,
+		//       a cache that is misjudged is looked at again next time
+		size_t nr_dirty = __atomic_load_n(&cache->nr_dirty, __ATOMIC_RELAXED);
+		uint64_t since = __atomic_load_n(&cache->dirty_since, __ATOMIC_RELAXED);
+
+		if (nr_dirty > 0 && now - since <= ARC_VFS_PCACHE_DIRTY_TICKS) {
+			continue;
+		}
+
+		// NOTE: The node is not pinned, that would fail a delete racing
+		//       with the flush. vfs_pcache_destroy waits for flushing to be
+		//       cleared instead, and nothing frees the node before it
+		cache->flushing = 1;
+		cache->flush_next = picked;
+		picked = cache;
+	}
+
+	mutex_unlock(&vfs_pcache_dirty_lock);
+
+	for (struct ARC_VFSPageCache *cache = picked; cache != NULL; cache = cache->flush_next) {
+		mutex_lock(&cache->lock);
+
+		if (cache->nr_dirty > 0 && now - cache->dirty_since > ARC_VFS_PCACHE_DIRTY_TICKS) {
+			struct ARC_File desc = { .mode = ARC_STD_PERM, .node = cache->node };
+
+			if (vfs_pcache_writeback_locked(cache->node, cache, &desc) == 0) {
+				flushed++;
+			}
+		}
+
+		if (cache->nr_dirty == 0) {
+			// A write from here on sets it again, and keeps it listed
+			__atomic_store_n(&cache->tracked, 0, __ATOMIC_RELEASE);
+		}
+
+		mutex_unlock(&cache->lock);
+	}
+
+	mutex_lock(&vfs_pcache_dirty_lock);
+
+	for (struct ARC_VFSPageCache *cache = picked; cache != NULL;) {
+		struct ARC_VFSPageCache *next = cache->flush_next;
+
+		if (!cache->tracked) {
+			vfs_pcache_untrack(cache);
+		}
+
+		cache->flush_next = NULL;
+		cache->flushing = 0;
+		cache = next;
+	}
+
+	mutex_unlock(&vfs_pcache_dirty_lock);
+	mutex_unlock(&vfs_pcache_flush_lock);
+
+	return flushed;
+}
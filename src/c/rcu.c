@@ -0,0 +1,159 @@
+/**
+ * @file rcu.c
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan - Operating System Kernel
+ * Copyright (C) 2023-2025 awewsomegamer
+ *
+ * This file is part of Arctan.
+ *
+ * Arctan is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+ * Two-parity epoch scheme. Readers count themselves in the slot of the
+ * epoch's parity on their processor. An object retired during epoch E is put
+ * on the limbo list of E's parity, the epoch is only advanced from E + 1 to
+ * E + 2 once every reader counted under E's parity has left, at which point
+ * that limbo list is reclaimed.
+*/
+#include <fs/rcu.h>
+#include <fs/percpu.h>
+#include <global.h>
+#include <mm/allocator.h>
+#include <lib/atomics.h>
+
+struct vfs_rcu_cpu {
+	uint64_t readers[2];
+} ARC_VFS_CACHE_ALIGNED;
+
+struct vfs_rcu_ptr {
+	struct ARC_VFSRCUHead head;
+	void *ptr;
+};
+
+static struct vfs_rcu_cpu vfs_rcu_cpus[ARC_VFS_MAX_CPUS] = { 0 };
+static uint64_t vfs_rcu_epoch = 0;
+static struct ARC_VFSRCUHead *vfs_rcu_limbo[2] = { 0 };
+static ARC_GenericSpinlock vfs_rcu_lock = 0;
+
+int init_vfs_rcu() {
+	init_static_spinlock(&vfs_rcu_lock);
+
+	return 0;
+}
+
+uint32_t vfs_rcu_read_lock() {
+	uint32_t cpu = vfs_current_cpu();
+
+	while (1) {
+		uint32_t parity = __atomic_load_n(&vfs_rcu_epoch, __ATOMIC_SEQ_CST) & 1;
+		ARC_ATOMIC_INC(vfs_rcu_cpus[cpu].readers[parity]);
+
+		// If the epoch moved on while we were counting ourselves, the
+		// reclaimer may have already summed our slot, try again
+		if ((__atomic_load_n(&vfs_rcu_epoch, __ATOMIC_SEQ_CST) & 1) == parity) {
+			return (cpu << 1) | parity;
+		}
+
+		ARC_ATOMIC_DEC(vfs_rcu_cpus[cpu].readers[parity]);
+	}
+}
+
+void vfs_rcu_read_unlock(uint32_t token) {
+	ARC_ATOMIC_DEC(vfs_rcu_cpus[token >> 1].readers[token & 1]);
+}
+
+static struct ARC_VFSRCUHead *vfs_rcu_advance() {
+	struct ARC_VFSRCUHead *list = NULL;
+
+	spinlock_lock(&vfs_rcu_lock);
+
+	uint32_t old = (vfs_rcu_epoch & 1) ^ 1;
+	uint64_t readers = 0;
+
+	for (int i = 0; i < ARC_VFS_MAX_CPUS; i++) {
+		readers += __atomic_load_n(&vfs_rcu_cpus[i].readers[old], __ATOMIC_SEQ_CST);
+	}
+
+	if (readers == 0) {
+		list = vfs_rcu_limbo[old];
+		vfs_rcu_limbo[old] = NULL;
+		__atomic_add_fetch(&vfs_rcu_epoch, 1, __ATOMIC_SEQ_CST);
+	}
+
+	spinlock_unlock(&vfs_rcu_lock);
+
+	return list;
+}
+
+void vfs_rcu_reclaim() {
+	struct ARC_VFSRCUHead *list = vfs_rcu_advance();
+
+	while (list != NULL) {
+		struct ARC_VFSRCUHead *next = list->next;
+		list->reclaim(list);
+		list = next;
+	}
+}
+
+void vfs_rcu_retire(struct ARC_VFSRCUHead *head, void (*reclaim)(struct ARC_VFSRCUHead *head)) {
+	if (head == NULL || reclaim == NULL) {
+		return;
+	}
+
+	head->reclaim = reclaim;
+
+	spinlock_lock(&vfs_rcu_lock);
+	uint32_t parity = vfs_rcu_epoch & 1;
+	head->next = vfs_rcu_limbo[parity];
+	vfs_rcu_limbo[parity] = head;
+	spinlock_unlock(&vfs_rcu_lock);
+
+	vfs_rcu_reclaim();
+}
+
+void vfs_rcu_synchronize() {
+	// Wait out two full epochs, after which every reader that was already in
+	// has left
+	uint64_t target = __atomic_load_n(&vfs_rcu_epoch, __ATOMIC_SEQ_CST) + 2;
+
+	while (__atomic_load_n(&vfs_rcu_epoch, __ATOMIC_SEQ_CST) < target) {
+		vfs_rcu_reclaim();
+	}
+}
+
+static void vfs_rcu_reclaim_ptr(struct ARC_VFSRCUHead *head) {
+	struct vfs_rcu_ptr *ptr = (struct vfs_rcu_ptr *)head;
+	free(ptr->ptr);
+	free(ptr);
+}
+
+void vfs_rcu_free(void *ptr) {
+	if (ptr == NULL) {
+		return;
+	}
+
+	struct vfs_rcu_ptr *holder = (struct vfs_rcu_ptr *)alloc(sizeof(*holder));
+
+	if (holder == NULL) {
+		vfs_rcu_synchronize();
+		free(ptr);
+		return;
+	}
+
+	holder->ptr = ptr;
+	vfs_rcu_retire(&holder->head, vfs_rcu_reclaim_ptr);
+}
@@ -0,0 +1,200 @@
+/**
+ * @file ref.c
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan - Operating System Kernel
+ * Copyright (C) 2023-2025 awewsomegamer
+ *
+ * This file is part of Arctan.
+ *
+ * Arctan is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+ * Per processor reference counts, in the style of percpu-ref. While a node
+ * is counted per processor, references are taken and dropped in the slot of
+ * the current processor from within a read-side section. Collapsing the count
+ * unpublishes the slots, waits for every such section to finish, and only then
+ * adds their sum to ref_count.
+*/
+#include <fs/ref.h>
+#include <fs/vfs.h>
+#include <fs/rcu.h>
+#include <global.h>
+#include <mm/allocator.h>
+#include <lib/atomics.h>
+
+static uint32_t vfs_ref_percpu_nodes = 0;
+
+static void vfs_node_get_atomic(struct ARC_VFSNode *node) {
+	ARC_ATOMIC_INC(node->ref_count);
+
+	if (node->type != ARC_VFS_N_DIR && node->type != ARC_VFS_N_MOUNT && node->type != ARC_VFS_N_ROOT) {
+		return;
+	}
+
+	// NOTE: ref_count's cache line has just been written anyway
+	if (__atomic_add_fetch(&node->ref_heat, 1, __ATOMIC_RELAXED) % ARC_VFS_REF_HEAT == 0) {
+		vfs_node_ref_percpu(node, 0);
+	}
+}
+
+void vfs_node_get_rcu(struct ARC_VFSNode *node) {
+	struct ARC_VFSRefCPU *cpus = __atomic_load_n(&node->ref_cpus, __ATOMIC_ACQUIRE);
+
+	if (cpus != NULL) {
+		// NOTE: The slot is only a hint, another processor may be in it too
+		ARC_ATOMIC_INC(cpus[vfs_current_cpu()].count);
+		return;
+	}
+
+	vfs_node_get_atomic(node);
+}
+
+void vfs_node_get(struct ARC_VFSNode *node) {
+	// NOTE: Only the slots need the read-side section, a count that goes to
+	//       ref_count is right no matter what state the node is in
+	if (__atomic_load_n(&node->ref_cpus, __ATOMIC_ACQUIRE) == NULL) {
+		vfs_node_get_atomic(node);
+		return;
+	}
+
+	uint32_t token = vfs_rcu_read_lock();
+	vfs_node_get_rcu(node);
+	vfs_rcu_read_unlock(token);
+}
+
+void vfs_node_put(struct ARC_VFSNode *node) {
+	if (__atomic_load_n(&node->ref_cpus, __ATOMIC_ACQUIRE) == NULL) {
+		ARC_ATOMIC_DEC(node->ref_count);
+		return;
+	}
+
+	uint32_t token = vfs_rcu_read_lock();
+	struct ARC_VFSRefCPU *cpus = __atomic_load_n(&node->ref_cpus, __ATOMIC_ACQUIRE);
+
+	if (cpus != NULL) {
+		ARC_ATOMIC_DEC(cpus[vfs_current_cpu()].count);
+	} else {
+		ARC_ATOMIC_DEC(node->ref_count);
+	}
+
+	vfs_rcu_read_unlock(token);
+}
+
+int vfs_node_ref_percpu(struct ARC_VFSNode *node, bool force) {
+	if (node == NULL) {
+		return -1;
+	}
+
+	uint8_t expected = ARC_VFS_REF_ATOMIC;
+
+	if (!__atomic_compare_exchange_n(&node->ref_state, &expected, ARC_VFS_REF_SWITCHING, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+		// Already switched, being switched, or collapsed
+		return expected == ARC_VFS_REF_PERCPU ? 0 : -2;
+	}
+
+	if (ARC_ATOMIC_INC(vfs_ref_percpu_nodes) > ARC_VFS_REF_MAX_PERCPU && !force) {
+		ARC_ATOMIC_DEC(vfs_ref_percpu_nodes);
+		__atomic_store_n(&node->ref_state, ARC_VFS_REF_ATOMIC, __ATOMIC_RELEASE);
+
+		return -3;
+	}
+
+	// NOTE: ARC_VFS_MAX_CPUS cache lines is at least a page, which keeps the
+	//       slots aligned
+	struct ARC_VFSRefCPU *cpus = (struct ARC_VFSRefCPU *)alloc(sizeof(*cpus) * ARC_VFS_MAX_CPUS);
+
+	if (cpus == NULL) {
+		ARC_DEBUG(ERR, "Failed to allocate per processor counts for \"%s\"\n", node->name);
+		ARC_ATOMIC_DEC(vfs_ref_percpu_nodes);
+		__atomic_store_n(&node->ref_state, ARC_VFS_REF_ATOMIC, __ATOMIC_RELEASE);
+
+		return -4;
+	}
+
+	memset(cpus, 0, sizeof(*cpus) * ARC_VFS_MAX_CPUS);
+
+	__atomic_store_n(&node->ref_cpus, cpus, __ATOMIC_RELEASE);
+	__atomic_store_n(&node->ref_state, ARC_VFS_REF_PERCPU, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+bool vfs_node_ref_collapse(struct ARC_VFSNode *node) {
+	if (node == NULL) {
+		return 0;
+	}
+
+	uint8_t state = __atomic_load_n(&node->ref_state, __ATOMIC_ACQUIRE);
+
+	while (state != ARC_VFS_REF_EXACT) {
+		if (state == ARC_VFS_REF_SWITCHING) {
+			// Whoever is switching it over, or folding it back, holds no
+			// locks, let it finish
+			state = __atomic_load_n(&node->ref_state, __ATOMIC_ACQUIRE);
+			continue;
+		}
+
+		uint8_t next = state == ARC_VFS_REF_PERCPU ? ARC_VFS_REF_SWITCHING : ARC_VFS_REF_EXACT;
+
+		if (__atomic_compare_exchange_n(&node->ref_state, &state, next, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+			state = next;
+			break;
+		}
+	}
+
+	if (state == ARC_VFS_REF_EXACT) {
+		// Never was counted per processor, or someone else folded it
+		return 0;
+	}
+
+	// NOTE: ref_state stays at ARC_VFS_REF_SWITCHING until the slots have been
+	//       added up, so nobody else sees it exact before it is
+	struct ARC_VFSRefCPU *cpus = __atomic_exchange_n(&node->ref_cpus, NULL, __ATOMIC_ACQ_REL);
+
+	// Everyone who could still see the slots is done with them after this
+	vfs_rcu_synchronize();
+
+	int64_t sum = 0;
+
+	for (int i = 0; i < ARC_VFS_MAX_CPUS; i++) {
+		sum += __atomic_load_n(&cpus[i].count, __ATOMIC_ACQUIRE);
+	}
+
+	__atomic_add_fetch(&node->ref_count, (uint64_t)sum, __ATOMIC_SEQ_CST);
+
+	free(cpus);
+	ARC_ATOMIC_DEC(vfs_ref_percpu_nodes);
+
+	__atomic_store_n(&node->ref_state, ARC_VFS_REF_EXACT, __ATOMIC_RELEASE);
+
+	return 1;
+}
+
+void vfs_node_ref_restore(struct ARC_VFSNode *node, bool percpu) {
+	if (node == NULL) {
+		return;
+	}
+
+	uint8_t expected = ARC_VFS_REF_EXACT;
+	__atomic_compare_exchange_n(&node->ref_state, &expected, ARC_VFS_REF_ATOMIC, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+
+	if (percpu) {
+		// NOTE: Only switches it over from ARC_VFS_REF_ATOMIC, whoever
+		//       restored it first may already have
+		vfs_node_ref_percpu(node, 1);
+	}
+}
@@ -0,0 +1,84 @@
+/**
+ * @file rwlock.c
+ *
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan - Operating System Kernel
+ * Copyright (C) 2023-2025 awewsomegamer
+ *
+ * This file is part of Arctan.
+ *
+ * Arctan is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+ * Reader-writer locks on the branches of the node graph.
+*/
+#include <fs/rwlock.h>
+#include <fs/percpu.h>
+
+// Checks of readers a writer spins through before it starts yielding to them
+#define ARC_VFS_RWLOCK_SPINS 1024
+
+void init_vfs_rwlock(struct ARC_VFSRWLock *lock) {
+	init_static_mutex(&lock->writer);
+	lock->readers = 0;
+	lock->writing = 0;
+}
+
+void vfs_rwlock_read(struct ARC_VFSRWLock *lock) {
+	while (1) {
+		if (__atomic_load_n(&lock->writing, __ATOMIC_ACQUIRE) == 0) {
+			// NOTE: Announce first, then check, a writer does it the other
+			//       way around so that one of the two always sees the other
+			__atomic_add_fetch(&lock->readers, 1, __ATOMIC_SEQ_CST);
+
+			if (__atomic_load_n(&lock->writing, __ATOMIC_SEQ_CST) == 0) {
+				return;
+			}
+
+			__atomic_sub_fetch(&lock->readers, 1, __ATOMIC_RELEASE);
+		}
+
+		// Sleep until the writer is done
+		mutex_lock(&lock->writer);
+		mutex_unlock(&lock->writer);
+	}
+}
+
+void vfs_rwlock_read_unlock(struct ARC_VFSRWLock *lock) {
+	__atomic_sub_fetch(&lock->readers, 1, __ATOMIC_RELEASE);
+}
+
+void vfs_rwlock_write(struct ARC_VFSRWLock *lock) {
+	mutex_lock(&lock->writer);
+	__atomic_store_n(&lock->writing, 1, __ATOMIC_SEQ_CST);
+
+	// NOTE: Most readers only hold the lock for a lookup, but some copy out a
+	//       batch of a directory or walk all of its children, and any of
+	//       them may be preempted, so the spin is bounded
+	for (uint32_t spins = 0; __atomic_load_n(&lock->readers, __ATOMIC_SEQ_CST) > 0; spins++) {
+		if (spins < ARC_VFS_RWLOCK_SPINS) {
+			vfs_cpu_relax();
+		} else {
+			smp_yield();
+		}
+	}
+}
+
+void vfs_rwlock_write_unlock(struct ARC_VFSRWLock *lock) {
+	__atomic_store_n(&lock->writing, 0, __ATOMIC_RELEASE);
+	mutex_unlock(&lock->writer);
+}
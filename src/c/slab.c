@@ -0,0 +1,184 @@
+/**
+ * @file slab.c
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan - Operating System Kernel
+ * Copyright (C) 2023-2025 awewsomegamer
+ *
+ * This file is part of Arctan.
+ *
+ * Arctan is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+ * Per-processor object caches. Objects are carved out of large chunks from
+ * the general allocator, chunks are never handed back. Each processor keeps
+ * a free list under its own (normally uncontended) lock, and only trades a
+ * batch of objects with the shared depot when its list runs dry or grows
+ * past twice the batch size.
+*/
+#include <fs/slab.h>
+#include <global.h>
+#include <mm/allocator.h>
+#include <lib/util.h>
+
+#define ARC_VFS_SLAB_CHUNK 0x4000
+#define ARC_VFS_SLAB_BATCH 32
+
+int init_vfs_slab(struct ARC_VFSSlabCache *cache, char *name, size_t obj_size) {
+	if (cache == NULL || obj_size == 0) {
+		return -1;
+	}
+
+	memset(cache, 0, sizeof(*cache));
+
+	cache->name = name;
+	// Objects hold the free list link while free and must stay aligned, those
+	// laid out by cache line are kept on cache line boundaries
+	cache->align = obj_size % ARC_VFS_CACHE_LINE == 0 ? ARC_VFS_CACHE_LINE : 16;
+	cache->obj_size = (max(obj_size, sizeof(void *)) + cache->align - 1) & ~(cache->align - 1);
+	cache->batch = min(ARC_VFS_SLAB_BATCH, max(ARC_VFS_SLAB_CHUNK / cache->obj_size, 1));
+
+	for (int i = 0; i < ARC_VFS_MAX_CPUS; i++) {
+		init_static_spinlock(&cache->cpus[i].lock);
+	}
+
+	init_static_spinlock(&cache->depot_lock);
+
+	return 0;
+}
+
+// Take up to cache->batch objects off of *list
+static void *vfs_slab_take_batch(struct ARC_VFSSlabCache *cache, void **list, size_t *count) {
+	void *head = *list;
+	void *tail = head;
+	size_t taken = 1;
+
+	if (head == NULL) {
+		return NULL;
+	}
+
+	while (taken < cache->batch && *(void **)tail != NULL) {
+		tail = *(void **)tail;
+		taken++;
+	}
+
+	*list = *(void **)tail;
+	*(void **)tail = NULL;
+	*count -= taken;
+
+	return head;
+}
+
+static void *vfs_slab_grow(struct ARC_VFSSlabCache *cache, size_t *count) {
+	size_t bytes = max(ARC_VFS_SLAB_CHUNK, cache->obj_size);
+	// NOTE: The allocator makes no promise past the alignment of any C type,
+	//       so the chunk is over-allocated and its start rounded up. Chunks are
+	//       never handed back, the original pointer need not be kept.
+	uint8_t *raw = (uint8_t *)alloc(bytes + cache->align - 1);
+
+	if (raw == NULL) {
+		ARC_DEBUG(ERR, "Failed to grow slab cache %s\n", cache->name);
+		return NULL;
+	}
+
+	uint8_t *chunk = (uint8_t *)(((uintptr_t)raw + cache->align - 1) & ~(uintptr_t)(cache->align - 1));
+
+	size_t objs = bytes / cache->obj_size;
+
+	for (size_t i = 0; i < objs - 1; i++) {
+		*(void **)(chunk + i * cache->obj_size) = chunk + (i + 1) * cache->obj_size;
+	}
+
+	*(void **)(chunk + (objs - 1) * cache->obj_size) = NULL;
+	*count = objs;
+
+	__atomic_add_fetch(&cache->reserved, bytes + cache->align - 1, __ATOMIC_RELAXED);
+
+	return chunk;
+}
+
+void *vfs_slab_alloc(struct ARC_VFSSlabCache *cache) {
+	if (cache == NULL) {
+		return NULL;
+	}
+
+	struct ARC_VFSSlabCPU *cpu = &cache->cpus[vfs_current_cpu()];
+
+	spinlock_lock(&cpu->lock);
+
+	if (cpu->free == NULL) {
+		spinlock_lock(&cache->depot_lock);
+		size_t before = cache->depot_count;
+		cpu->free = vfs_slab_take_batch(cache, &cache->depot, &cache->depot_count);
+		cpu->count = before - cache->depot_count;
+		spinlock_unlock(&cache->depot_lock);
+	}
+
+	if (cpu->free == NULL) {
+		cpu->free = vfs_slab_grow(cache, &cpu->count);
+	}
+
+	void *obj = cpu->free;
+
+	if (obj != NULL) {
+		cpu->free = *(void **)obj;
+		cpu->count--;
+	}
+
+	spinlock_unlock(&cpu->lock);
+
+	if (obj != NULL) {
+		memset(obj, 0, cache->obj_size);
+	}
+
+	return obj;
+}
+
+void vfs_slab_free(struct ARC_VFSSlabCache *cache, void *obj) {
+	if (cache == NULL || obj == NULL) {
+		return;
+	}
+
+	struct ARC_VFSSlabCPU *cpu = &cache->cpus[vfs_current_cpu()];
+
+	spinlock_lock(&cpu->lock);
+
+	*(void **)obj = cpu->free;
+	cpu->free = obj;
+	cpu->count++;
+
+	if (cpu->count <= cache->batch * 2) {
+		spinlock_unlock(&cpu->lock);
+		return;
+	}
+
+	size_t count = cpu->count;
+	void *batch = vfs_slab_take_batch(cache, &cpu->free, &cpu->count);
+	size_t moved = count - cpu->count;
+
+	spinlock_unlock(&cpu->lock);
+
+	void *tail = batch;
+	while (*(void **)tail != NULL) {
+		tail = *(void **)tail;
+	}
+
+	spinlock_lock(&cache->depot_lock);
+	*(void **)tail = cache->depot;
+	cache->depot = batch;
+	cache->depot_count += moved;
+	spinlock_unlock(&cache->depot_lock);
+}
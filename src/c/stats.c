@@ -0,0 +1,211 @@
+/**
+ * @file stats.c
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan - Operating System Kernel
+ * Copyright (C) 2023-2025 awewsomegamer
+ *
+ * This file is part of Arctan.
+ *
+ * Arctan is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+ * Collection and presentation of the VFS's statistics.
+*/
+#include <fs/stats.h>
+#include <fs/vfs.h>
+#include <fs/graph.h>
+#include <fs/ref.h>
+#include <mm/allocator.h>
+#include <lib/resource.h>
+#include <lib/util.h>
+#include <global.h>
+#include <inttypes.h>
+
+struct ARC_VFSStatsCPU vfs_stats_cpus[ARC_VFS_MAX_CPUS] = { 0 };
+
+#if !defined(__x86_64__) && !defined(__i386__) && !defined(__aarch64__) && !defined(__riscv)
+uint64_t vfs_clock_ticks = 0;
+#endif
+
+static const char *vfs_stats_counter_names[ARC_VFS_STAT_COUNT] = {
+	[ARC_VFS_STAT_LOOKUP_HIT] = "lookup_hit",
+	[ARC_VFS_STAT_LOOKUP_MISS] = "lookup_miss",
+	[ARC_VFS_STAT_LOOKUP_NEG] = "lookup_negative",
+	[ARC_VFS_STAT_NCACHE_EVICT] = "ncache_evict",
+	[ARC_VFS_STAT_ATTR_HIT] = "attr_hit",
+	[ARC_VFS_STAT_ATTR_MISS] = "attr_miss",
+};
+
+static const char *vfs_stats_latency_names[ARC_VFS_LAT_COUNT] = {
+	[ARC_VFS_LAT_STAT] = "stat",
+	[ARC_VFS_LAT_LOCATE] = "locate",
+	[ARC_VFS_LAT_READ] = "read",
+	[ARC_VFS_LAT_WRITE] = "write",
+	[ARC_VFS_LAT_CREATE] = "create",
+	[ARC_VFS_LAT_REMOVE] = "remove",
+	[ARC_VFS_LAT_BRANCH_LOCK] = "branch_lock",
+};
+
+int init_vfs_stats() {
+	memset(vfs_stats_cpus, 0, sizeof(vfs_stats_cpus));
+
+	return 0;
+}
+
+void vfs_stats_collect(struct ARC_VFSStats *out) {
+	if (out == NULL) {
+		return;
+	}
+
+	memset(out, 0, sizeof(*out));
+
+	for (int cpu = 0; cpu < ARC_VFS_MAX_CPUS; cpu++) {
+		struct ARC_VFSStats *stats = &vfs_stats_cpus[cpu].stats;
+
+		for (int i = 0; i < ARC_VFS_STAT_COUNT; i++) {
+			out->counters[i] += __atomic_load_n(&stats->counters[i], __ATOMIC_RELAXED);
+		}
+
+		for (int i = 0; i < ARC_VFS_LAT_COUNT; i++) {
+			struct ARC_VFSLatency *lat = &stats->latency[i];
+
+			out->latency[i].count += __atomic_load_n(&lat->count, __ATOMIC_RELAXED);
+			out->latency[i].total += __atomic_load_n(&lat->total, __ATOMIC_RELAXED);
+
+			for (int j = 0; j < ARC_VFS_HIST_BUCKETS; j++) {
+				out->latency[i].buckets[j] += __atomic_load_n(&lat->buckets[j], __ATOMIC_RELAXED);
+			}
+		}
+	}
+}
+
+// Append to buf for as long as it fits, len keeps counting regardless
+#define VFS_STATS_EMIT(...) (len += snprintf(len < size ? buf + len : NULL, len < size ? size - len : 0, __VA_ARGS__))
+
+size_t vfs_stats_render(char *buf, size_t size) {
+	struct ARC_VFSStats stats;
+	vfs_stats_collect(&stats);
+
+	size_t len = 0;
+
+	if (buf == NULL) {
+		size = 0;
+	}
+
+	for (int i = 0; i < ARC_VFS_STAT_COUNT; i++) {
+		VFS_STATS_EMIT("%s %"PRIu64"\n", vfs_stats_counter_names[i], stats.counters[i]);
+	}
+
+	// Latencies are in ticks of the time stamp counter
+	for (int i = 0; i < ARC_VFS_LAT_COUNT; i++) {
+		struct ARC_VFSLatency *lat = &stats.latency[i];
+		uint64_t mean = lat->count == 0 ? 0 : lat->total / lat->count;
+
+		VFS_STATS_EMIT("%s count %"PRIu64" total %"PRIu64" mean %"PRIu64"\n", vfs_stats_latency_names[i], lat->count, lat->total, mean);
+
+		for (int j = 0; j < ARC_VFS_HIST_BUCKETS; j++) {
+			if (lat->buckets[j] != 0) {
+				VFS_STATS_EMIT("\t%d %"PRIu64"\n", j, lat->buckets[j]);
+			}
+		}
+	}
+
+	return len;
+}
+
+#undef VFS_STATS_EMIT
+
+static size_t vfs_stats_read(void *buffer, size_t size, size_t count, struct ARC_File *file, struct ARC_Resource *res) {
+	(void)res;
+
+	size_t want = size * count;
+	size_t len = vfs_stats_render(NULL, 0);
+	// NOTE: Leave room for whatever was recorded in the meantime
+	size_t cap = len + len / 2 + 1;
+	char *text = (char *)alloc(cap);
+
+	if (text == NULL) {
+		return 0;
+	}
+
+	len = min(vfs_stats_render(text, cap), cap - 1);
+
+	size_t offset = file->offset < 0 ? 0 : (size_t)file->offset;
+	size_t copy = offset >= len ? 0 : min(want, len - offset);
+
+	memcpy(buffer, text + offset, copy);
+	free(text);
+
+	return copy;
+}
+
+static size_t vfs_stats_write(void *buffer, size_t size, size_t count, struct ARC_File *file, struct ARC_Resource *res) {
+	(void)buffer;
+	(void)size;
+	(void)count;
+	(void)file;
+	(void)res;
+
+	return 0;
+}
+
+static int vfs_stats_stat(struct ARC_Resource *res, char *filename, struct stat *stat) {
+	(void)res;
+	(void)filename;
+
+	memset(stat, 0, sizeof(*stat));
+	stat->st_mode = S_IFREG | 0444;
+
+	return 0;
+}
+
+static struct ARC_DriverDef vfs_stats_def = {
+	.read = vfs_stats_read,
+	.write = vfs_stats_write,
+	.stat = vfs_stats_stat,
+};
+
+static struct ARC_Resource vfs_stats_resource = { .driver = &vfs_stats_def };
+
+int vfs_stats_publish(struct ARC_VFSNode *start, char *path) {
+	if (start == NULL || path == NULL) {
+		return -1;
+	}
+
+	struct ARC_VFSNodeInfo info = {
+		.type = ARC_VFS_N_FILE,
+		.mode = 0444,
+		.driver_index = (uint64_t)-1,
+		.resource_overwrite = &vfs_stats_resource,
+	};
+
+	// NOTE: The resource is not the kind that can be uninitialized, the
+	//       reference is kept so that the node is never deleted
+	struct ARC_VFSNode *node = NULL;
+
+	if (vfs_create_filepath(path, start, 1, &info, &node, NULL) != ARC_VFS_PATH_RESOLVED) {
+		ARC_DEBUG(ERR, "Failed to create %s\n", path);
+
+		if (node != NULL) {
+			vfs_node_put(node);
+		}
+
+		return -2;
+	}
+
+	return 0;
+}
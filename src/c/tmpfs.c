@@ -0,0 +1,491 @@
+/**
+ * @file tmpfs.c
+ *
+ *
+ * @author awewsomegamer <awewsomegamer@gmail.com>
+ *
+ * @LICENSE
+ * Arctan - Operating System Kernel
+ * Copyright (C) 2023-2025 awewsomegamer
+ *
+ * This file is part of Arctan.
+ *
+ * Arctan is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @DESCRIPTION
+ * The tmpfs. Each file is guarded by one mutex. The radix tree under it
+ * only loses pages when the file is truncated while nothing maps it, so a
+ * page once handed out to a mapping stays put.
+*/
+#include <fs/tmpfs.h>
+#include <fs/pcache.h>
+#include <fs/slab.h>
+#include <global.h>
+#include <mm/allocator.h>
+#include <lib/atomics.h>
+#include <lib/util.h>
+
+// log2(ARC_VFS_TMPFS_FANOUT)
+#define ARC_VFS_TMPFS_SHIFT __builtin_ctz(ARC_VFS_TMPFS_FANOUT)
+// Levels needed to index every page of a 64-bit offset
+#define ARC_VFS_TMPFS_HEIGHT_MAX ((64 - __builtin_ctzll(ARC_VFS_PAGE_SIZE) + ARC_VFS_TMPFS_SHIFT - 1) / ARC_VFS_TMPFS_SHIFT)
+
+struct ARC_VFSTmpfsRadix {
+	void *slots[ARC_VFS_TMPFS_FANOUT];
+};
+
+struct ARC_VFSTmpfsFile {
+	ARC_GenericMutex lock;
+	size_t size;
+	/// Root of the radix tree, the page at index zero itself if height is zero.
+	void *root;
+	/// Levels of radix nodes above the pages.
+	uint32_t height;
+	/// Live mappings of the file, its pages are not freed while there are any.
+	uint32_t maps;
+	/// Set once the data has moved out of inline_data and into the tree.
+	uint8_t paged;
+	uint8_t inline_data[ARC_VFS_TMPFS_INLINE];
+};
+
+static struct ARC_VFSSlabCache vfs_tmpfs_radix_slab = { 0 };
+static struct ARC_VFSSlabCache vfs_tmpfs_file_slab = { 0 };
+/// Free pages, the first word of each is the link.
+static void *vfs_tmpfs_pool = NULL;
+static size_t vfs_tmpfs_pool_count = 0;
+static ARC_GenericSpinlock vfs_tmpfs_pool_lock;
+
+int init_vfs_tmpfs() {
+	init_static_spinlock(&vfs_tmpfs_pool_lock);
+
+	if (init_vfs_slab(&vfs_tmpfs_radix_slab, "vfs_tmpfs_radix", sizeof(struct ARC_VFSTmpfsRadix)) != 0) {
+		return -1;
+	}
+
+	return init_vfs_slab(&vfs_tmpfs_file_slab, "vfs_tmpfs_file", sizeof(struct ARC_VFSTmpfsFile));
+}
+
+static void *vfs_tmpfs_page_alloc() {
+	spinlock_lock(&vfs_tmpfs_pool_lock);
+
+	void *page = vfs_tmpfs_pool;
+
+	if (page != NULL) {
+		vfs_tmpfs_pool = *(void **)page;
+		vfs_tmpfs_pool_count--;
+	}
+
+	spinlock_unlock(&vfs_tmpfs_pool_lock);
+
+	if (page == NULL) {
+		page = alloc(ARC_VFS_PAGE_SIZE);
+	}
+
+	if (page != NULL) {
+		memset(page, 0, ARC_VFS_PAGE_SIZE);
+	}
+
+	return page;
+}
+
+static void vfs_tmpfs_page_free(void *page) {
+	spinlock_lock(&vfs_tmpfs_pool_lock);
+
+	if (vfs_tmpfs_pool_count < ARC_VFS_TMPFS_POOL_MAX) {
+		*(void **)page = vfs_tmpfs_pool;
+		vfs_tmpfs_pool = page;
+		vfs_tmpfs_pool_count++;
+		page = NULL;
+	}
+
+	spinlock_unlock(&vfs_tmpfs_pool_lock);
+
+	if (page != NULL) {
+		free(page);
+	}
+}
+
+// Number of pages a tree of the given height can index
+static uint64_t vfs_tmpfs_capacity(uint32_t height) {
+	if (height >= ARC_VFS_TMPFS_HEIGHT_MAX) {
+		return UINT64_MAX;
+	}
+
+	return 1ULL << (height * ARC_VFS_TMPFS_SHIFT);
+}
+
+static size_t vfs_tmpfs_slot(uint64_t index, uint32_t level) {
+	return (index >> ((level - 1) * ARC_VFS_TMPFS_SHIFT)) & (ARC_VFS_TMPFS_FANOUT - 1);
+}
+
+// NOTE: Expects the file's lock to be held, returns NULL for a hole
+static void *vfs_tmpfs_lookup(struct ARC_VFSTmpfsFile *file, uint64_t index) {
+	if (index >= vfs_tmpfs_capacity(file->height)) {
+		return NULL;
+	}
+
+	void *slot = file->root;
+
+	for (uint32_t level = file->height; level > 0 && slot != NULL; level--) {
+		slot = ((struct ARC_VFSTmpfsRadix *)slot)->slots[vfs_tmpfs_slot(index, level)];
+	}
+
+	return slot;
+}
+
+// Get the page at index, filling in the hole if there is one
+// NOTE: Expects the file's lock to be held
+static void *vfs_tmpfs_insert(struct ARC_VFSTmpfsFile *file, uint64_t index) {
+	while (index >= vfs_tmpfs_capacity(file->height)) {
+		if (file->root != NULL) {
+			// The tree so far becomes the first slot of a new root
+			struct ARC_VFSTmpfsRadix *radix = (struct ARC_VFSTmpfsRadix *)vfs_slab_alloc(&vfs_tmpfs_radix_slab);
+
+			if (radix == NULL) {
+				return NULL;
+			}
+
+			radix->slots[0] = file->root;
+			file->root = radix;
+		}
+
+		file->height++;
+	}
+
+	void **slot = &file->root;
+
+	for (uint32_t level = file->height; level > 0; level--) {
+		if (*slot == NULL) {
+			*slot = vfs_slab_alloc(&vfs_tmpfs_radix_slab);
+
+			if (*slot == NULL) {
+				return NULL;
+			}
+		}
+
+		slot = &((struct ARC_VFSTmpfsRadix *)*slot)->slots[vfs_tmpfs_slot(index, level)];
+	}
+
+	if (*slot == NULL) {
+		*slot = vfs_tmpfs_page_alloc();
+	}
+
+	return *slot;
+}
+
+static void vfs_tmpfs_free_tree(void *slot, uint32_t level) {
+	if (slot == NULL) {
+		return;
+	}
+
+	if (level == 0) {
+		vfs_tmpfs_page_free(slot);
+		return;
+	}
+
+	struct ARC_VFSTmpfsRadix *radix = (struct ARC_VFSTmpfsRadix *)slot;
+
+	for (int i = 0; i < ARC_VFS_TMPFS_FANOUT; i++) {
+		vfs_tmpfs_free_tree(radix->slots[i], level - 1);
+	}
+
+	vfs_slab_free(&vfs_tmpfs_radix_slab, radix);
+}
+
+// Drop every page from index first onwards, or only zero them if the file
+// is mapped. NOTE: Expects the file's lock to be held
+static void vfs_tmpfs_cut(struct ARC_VFSTmpfsFile *file, void **slot, uint32_t level, uint64_t base, uint64_t first) {
+	if (*slot == NULL) {
+		return;
+	}
+
+	if (level == 0) {
+		if (base < first) {
+			// Still within the file, only reached when the tree is a
+			// single page
+			return;
+		}
+
+		if (file->maps > 0) {
+			memset(*slot, 0, ARC_VFS_PAGE_SIZE);
+		} else {
+			vfs_tmpfs_page_free(*slot);
+			*slot = NULL;
+		}
+
+		return;
+	}
+
+	if (base >= first && file->maps == 0) {
+		vfs_tmpfs_free_tree(*slot, level);
+		*slot = NULL;
+
+		return;
+	}
+
+	struct ARC_VFSTmpfsRadix *radix = (struct ARC_VFSTmpfsRadix *)*slot;
+	uint64_t span = 1ULL << ((level - 1) * ARC_VFS_TMPFS_SHIFT);
+
+	for (int i = 0; i < ARC_VFS_TMPFS_FANOUT; i++) {
+		uint64_t child = base + i * span;
+
+		if (child + span > first) {
+			vfs_tmpfs_cut(file, &radix->slots[i], level - 1, child, first);
+		}
+	}
+}
+
+// Move the inline data into the first page
+// NOTE: Expects the file's lock to be held
+static int vfs_tmpfs_make_paged(struct ARC_VFSTmpfsFile *file) {
+	if (file->paged) {
+		return 0;
+	}
+
+	if (file->size > 0) {
+		void *page = vfs_tmpfs_insert(file, 0);
+
+		if (page == NULL) {
+			return -1;
+		}
+
+		memcpy(page, file->inline_data, file->size);
+	}
+
+	file->paged = 1;
+
+	return 0;
+}
+
+int vfs_tmpfs_create(struct ARC_VFSNode *node) {
+	if (node == NULL) {
+		return -1;
+	}
+
+	struct ARC_VFSTmpfsFile *file = (struct ARC_VFSTmpfsFile *)vfs_slab_alloc(&vfs_tmpfs_file_slab);
+
+	if (file == NULL) {
+		ARC_DEBUG(ERR, "Failed to allocate file for \"%s\"\n", node->name);
+		return -2;
+	}
+
+	init_static_mutex(&file->lock);
+	node->cold.tmpfs = file;
+
+	return 0;
+}
+
+size_t vfs_tmpfs_read(struct ARC_VFSNode *node, void *buffer, size_t len, long offset) {
+	struct ARC_VFSTmpfsFile *file = node->cold.tmpfs;
+
+	if (file == NULL || buffer == NULL || offset < 0) {
+		return 0;
+	}
+
+	mutex_lock(&file->lock);
+
+	if ((size_t)offset >= file->size) {
+		mutex_unlock(&file->lock);
+		return 0;
+	}
+
+	len = min(len, file->size - offset);
+
+	if (!file->paged) {
+		memcpy(buffer, file->inline_data + offset, len);
+		mutex_unlock(&file->lock);
+
+		return len;
+	}
+
+	size_t done = 0;
+
+	while (done < len) {
+		uint64_t pos = offset + done;
+		size_t in_page = pos % ARC_VFS_PAGE_SIZE;
+		size_t chunk = min(len - done, ARC_VFS_PAGE_SIZE - in_page);
+		uint8_t *page = (uint8_t *)vfs_tmpfs_lookup(file, pos / ARC_VFS_PAGE_SIZE);
+
+		if (page == NULL) {
+			memset((uint8_t *)buffer + done, 0, chunk);
+		} else {
+			memcpy((uint8_t *)buffer + done, page + in_page, chunk);
+		}
+
+		done += chunk;
+	}
+
+	mutex_unlock(&file->lock);
+
+	return done;
+}
+
+size_t vfs_tmpfs_write(struct ARC_VFSNode *node, void *buffer, size_t len, long offset) {
+	struct ARC_VFSTmpfsFile *file = node->cold.tmpfs;
+
+	if (file == NULL || buffer == NULL || offset < 0) {
+		return 0;
+	}
+
+	mutex_lock(&file->lock);
+
+	size_t done = 0;
+
+	if (!file->paged && offset + len <= ARC_VFS_TMPFS_INLINE) {
+		// NOTE: Truncation zeroes whatever it cuts off, so whatever lies
+		//       between the old end and offset is still zero
+		memcpy(file->inline_data + offset, buffer, len);
+		done = len;
+	} else if (vfs_tmpfs_make_paged(file) == 0) {
+		while (done < len) {
+			uint64_t pos = offset + done;
+			size_t in_page = pos % ARC_VFS_PAGE_SIZE;
+			size_t chunk = min(len - done, ARC_VFS_PAGE_SIZE - in_page);
+			uint8_t *page = (uint8_t *)vfs_tmpfs_insert(file, pos / ARC_VFS_PAGE_SIZE);
+
+			if (page == NULL) {
+				ARC_DEBUG(ERR, "Out of memory writing \"%s\"\n", node->name);
+				break;
+			}
+
+			memcpy(page + in_page, (uint8_t *)buffer + done, chunk);
+			done += chunk;
+		}
+	}
+
+	if (done > 0 && offset + done > file->size) {
+		file->size = offset + done;
+
+		mutex_lock(&node->cold.property_lock);
+		node->cold.stat.st_size = file->size;
+		mutex_unlock(&node->cold.property_lock);
+	}
+
+	mutex_unlock(&file->lock);
+
+	return done;
+}
+
+int vfs_tmpfs_truncate(struct ARC_VFSNode *node, size_t size) {
+	struct ARC_VFSTmpfsFile *file = node->cold.tmpfs;
+
+	if (file == NULL) {
+		return -1;
+	}
+
+	mutex_lock(&file->lock);
+
+	if (!file->paged && size > ARC_VFS_TMPFS_INLINE && vfs_tmpfs_make_paged(file) != 0) {
+		mutex_unlock(&file->lock);
+		ARC_DEBUG(ERR, "Out of memory truncating \"%s\"\n", node->name);
+
+		return -2;
+	}
+
+	if (size < file->size) {
+		if (!file->paged) {
+			memset(file->inline_data + size, 0, file->size - size);
+		} else {
+			uint64_t first = (size + ARC_VFS_PAGE_SIZE - 1) / ARC_VFS_PAGE_SIZE;
+			uint8_t *last = size % ARC_VFS_PAGE_SIZE == 0 ? NULL : (uint8_t *)vfs_tmpfs_lookup(file, size / ARC_VFS_PAGE_SIZE);
+
+			if (last != NULL) {
+				memset(last + size % ARC_VFS_PAGE_SIZE, 0, ARC_VFS_PAGE_SIZE - size % ARC_VFS_PAGE_SIZE);
+			}
+
+			vfs_tmpfs_cut(file, &file->root, file->height, 0, first);
+		}
+	}
+
+	file->size = size;
+
+	mutex_lock(&node->cold.property_lock);
+	node->cold.stat.st_size = size;
+	mutex_unlock(&node->cold.property_lock);
+
+	mutex_unlock(&file->lock);
+
+	return 0;
+}
+
+void vfs_tmpfs_map(struct ARC_VFSNode *node, int delta) {
+	struct ARC_VFSTmpfsFile *file = node->cold.tmpfs;
+
+	if (file == NULL) {
+		return;
+	}
+
+	mutex_lock(&file->lock);
+	file->maps += delta;
+	mutex_unlock(&file->lock);
+}
+
+void *vfs_tmpfs_page(struct ARC_VFSNode *node, uint64_t index) {
+	struct ARC_VFSTmpfsFile *file = node->cold.tmpfs;
+
+	if (file == NULL) {
+		return NULL;
+	}
+
+	mutex_lock(&file->lock);
+
+	void *page = NULL;
+
+	if (vfs_tmpfs_make_paged(file) == 0) {
+		page = vfs_tmpfs_insert(file, index);
+	}
+
+	mutex_unlock(&file->lock);
+
+	return page;
+}
+
+void vfs_tmpfs_destroy(struct ARC_VFSNode *node) {
+	struct ARC_VFSTmpfsFile *file = node->cold.tmpfs;
+
+	if (file == NULL) {
+		return;
+	}
+
+	node->cold.tmpfs = NULL;
+
+	vfs_tmpfs_free_tree(file->root, file->height);
+	vfs_slab_free(&vfs_tmpfs_file_slab, file);
+}
+
+size_t vfs_tmpfs_shrink(size_t count) {
+	size_t freed = 0;
+
+	while (freed < count) {
+		spinlock_lock(&vfs_tmpfs_pool_lock);
+
+		void *page = vfs_tmpfs_pool;
+
+		if (page != NULL) {
+			vfs_tmpfs_pool = *(void **)page;
+			vfs_tmpfs_pool_count--;
+		}
+
+		spinlock_unlock(&vfs_tmpfs_pool_lock);
+
+		if (page == NULL) {
+			break;
+		}
+
+		free(page);
+		freed++;
+	}
+
+	return freed;
+}
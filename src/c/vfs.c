@@ -26,6 +26,18 @@
 */
 #include <fs/vfs.h>
 #include <fs/graph.h>
+#include <fs/dcache.h>
+#include <fs/rcu.h>
+#include <fs/ncache.h>
+#include <fs/driver_ext.h>
+#include <fs/pcache.h>
+#include <fs/tmpfs.h>
+#include <fs/nsimage.h>
+#include <fs/fstate.h>
+#include <fs/aio.h>
+#include <fs/ref.h>
+#include <fs/mount.h>
+#include <fs/stats.h>
 #include <abi-bits/seek-whence.h>
 #include <abi-bits/fcntl.h>
 #include <global.h>
@@ -33,39 +45,72 @@
 #include <lib/util.h>
 #include <lib/resource.h>
 #include <lib/ringbuffer.h>
-
-#define NODE_CACHE_SIZE 1024
+#include <lib/perms.h>
 
 static struct ARC_VFSNode vfs_root = { 0 };
 
-static struct ARC_VFSNode *vfs_node_cache[1024] = { 0 };
-static uint64_t vfs_node_cache_idx = 0;
-static ARC_GenericSpinlock vfs_node_cache_lock = 0;
-
-static struct ARC_VFSNode *vfs_get_starting_node(char *filepath) {
+// NOTE: Relative paths start at dir, which the caller keeps open throughout
+static struct ARC_VFSNode *vfs_get_starting_node(struct ARC_File *dir, char *filepath) {
 	if (*filepath == '/') {
 		return &vfs_root;
-	} else {
-		ARC_DEBUG(ERR, "Non-absolute (%s) paths unsupported\n", filepath);
 	}
 
-	return NULL;
+	if (dir == NULL || dir->node == NULL) {
+		ARC_DEBUG(ERR, "Relative path (%s) without a directory\n", filepath);
+		return NULL;
+	}
+
+	if (dir->node->type != ARC_VFS_N_DIR && dir->node->type != ARC_VFS_N_MOUNT) {
+		ARC_DEBUG(ERR, "Cannot start %s at \"%s\", it is not a directory\n", filepath, dir->node->name);
+		return NULL;
+	}
+
+	return dir->node;
 }
 
 int init_vfs() {
 	vfs_root.type = ARC_VFS_N_DIR;
 	vfs_root.name = "";
-	init_static_mutex(&vfs_root.branch_lock);
-	init_static_mutex(&vfs_root.property_lock);
-	init_static_spinlock(&vfs_node_cache_lock);
+	init_vfs_rwlock(&vfs_root.branch_lock);
+	init_static_mutex(&vfs_root.cold.property_lock);
+	init_vfs_dcache();
+	init_vfs_ncache();
+	init_vfs_rcu();
+	init_vfs_graph();
+	init_vfs_mount();
+	init_vfs_driver_ext();
+	init_vfs_pcache();
+	init_vfs_tmpfs();
+	init_vfs_fstate();
+	init_vfs_aio();
+	init_vfs_stats();
 
 	// NOTE: This is here such that it is impossible to
 	//       delete the root node
-	ARC_ATOMIC_INC(vfs_root.ref_count);
+	vfs_node_get(&vfs_root);
+	// Every absolute path starts here
+	vfs_node_ref_percpu(&vfs_root, 1);
+
+	vfs_stats_publish(&vfs_root, "/proc/vfs/stats");
 
 	return 0;
 }
 
+int vfs_load_image(void *image, size_t size) {
+	return vfs_image_load(&vfs_root, image, size);
+}
+
+size_t vfs_reclaim(size_t count) {
+	// Pooled pages cost nothing to give back, idle nodes may be wanted again
+	size_t freed = vfs_tmpfs_shrink(count);
+
+	if (freed < count) {
+		freed += vfs_ncache_shrink(count - freed);
+	}
+
+	return freed;
+}
+
 int vfs_mount(char *mountpoint, struct ARC_Resource *resource) {
 	if (mountpoint == NULL || resource == NULL) {
 		ARC_DEBUG(ERR, "Resource or mount path are NULL\n");
@@ -74,36 +119,91 @@ int vfs_mount(char *mountpoint, struct ARC_Resource *resource) {
 
 	// Mountpoint should already exist
 	struct ARC_VFSNode *node = NULL;
-	char *upto = vfs_traverse_filepath(mountpoint, vfs_get_starting_node(mountpoint), 1, &node);
+	int status = vfs_traverse_filepath(mountpoint, vfs_get_starting_node(NULL, mountpoint), 1, &node, NULL);
 
-	if (upto == NULL || node == NULL) {
+	if (status < 0 || node == NULL) {
 		ARC_DEBUG(ERR, "Traversal failed\n");
 		return -2;
 	}
 
-	if (*upto != 0) {
+	if (status != ARC_VFS_PATH_RESOLVED) {
 		ARC_DEBUG(ERR, "Traversla failed\n");
-		free(upto);
+		vfs_node_put(node);
 		return -3;
 	}
 
-	free(upto);
-
-	// TODO: Account for if node->children != NULL, should be able to just
-	//       save the pointer and mount the resource
-	if (node->type != ARC_VFS_N_DIR || node->children != NULL) {
-		ARC_DEBUG(ERR, "Cannot mount on directory with children or non-directories\n");
+	// NOTE: Whatever the directory holds is put back once it is unmounted,
+	//       ref_count remains incremented to ensure it cannot be deleted
+	if (vfs_mount_attach(node, resource, NULL) != 0) {
+		ARC_DEBUG(ERR, "Cannot mount on %s\n", mountpoint);
+		vfs_node_put(node);
 		return -4;
 	}
 
-	mutex_lock(&node->property_lock);
+	return 0;
+}
+
+int vfs_bind(char *source, char *target) {
+	if (source == NULL || target == NULL) {
+		ARC_DEBUG(ERR, "Source or target path are NULL\n");
+		return -1;
+	}
+
+	struct ARC_VFSNode *from = NULL;
+	int status = vfs_load_filepath(source, vfs_get_starting_node(NULL, source), 1, &from, NULL);
+
+	if (status != ARC_VFS_PATH_RESOLVED || from == NULL) {
+		ARC_DEBUG(ERR, "Failed to find %s\n", source);
+
+		if (from != NULL) {
+			vfs_node_put(from);
+		}
+
+		return -2;
+	}
+
+	// NOTE: The target is given the source's place within its resource,
+	//       directories that only exist in memory have none
+	struct ARC_Resource *resource = NULL;
+	char *prefix = NULL;
+
+	if (from->type == ARC_VFS_N_DIR || from->type == ARC_VFS_N_MOUNT) {
+		resource = vfs_mount_resource(from);
+	}
+
+	if (resource != NULL) {
+		prefix = vfs_get_mount_path(from);
+	}
+
+	vfs_node_put(from);
+
+	if (prefix == NULL) {
+		ARC_DEBUG(ERR, "Cannot bind %s, it is not a directory of a mount\n", source);
+		return -3;
+	}
+
+	struct ARC_VFSNode *node = NULL;
+	status = vfs_load_filepath(target, vfs_get_starting_node(NULL, target), 1, &node, NULL);
+
+	if (status != ARC_VFS_PATH_RESOLVED || node == NULL) {
+		ARC_DEBUG(ERR, "Failed to find %s\n", target);
+
+		if (node != NULL) {
+			vfs_node_put(node);
+		}
 
-	node->type = ARC_VFS_N_MOUNT;
-	node->resource = resource;
+		free(prefix);
+		return -4;
+	}
 
-	mutex_unlock(&node->property_lock);
+	int err = vfs_mount_attach(node, resource, prefix);
+	free(prefix);
 
-	// ref_count remains incremented to ensure it cannot be deleted
+	if (err != 0) {
+		ARC_DEBUG(ERR, "Cannot bind %s on %s\n", source, target);
+		vfs_node_put(node);
+		return -5;
+	}
 
 	return 0;
 }
@@ -119,19 +219,21 @@ int vfs_unmount(struct ARC_VFSNode *node) {
 		return -2;
 	}
 
-	mutex_lock(&node->property_lock);
+	int err = vfs_mount_detach(node);
 
-	node->type = ARC_VFS_N_MOUNT;
-	node->resource = NULL;
-
-	mutex_unlock(&node->property_lock);
-
-	ARC_ATOMIC_DEC(node->ref_count);
+	if (err != 0) {
+		ARC_DEBUG(ERR, "Failed to unmount \"%s\" (%d)\n", node->name, err);
+		return -3;
+	}
 
 	return 0;
 }
 
 int vfs_open(char *path, int flags, uint32_t mode, struct ARC_File **ret) {
+	return vfs_openat(NULL, path, flags, mode, ret);
+}
+
+int vfs_openat(struct ARC_File *dir, char *path, int flags, uint32_t mode, struct ARC_File **ret) {
 	if (ret != NULL) {
 		*ret = NULL;
 	}
@@ -141,38 +243,42 @@ int vfs_open(char *path, int flags, uint32_t mode, struct ARC_File **ret) {
 	}
 
 	struct ARC_VFSNode *node = NULL;
-	char *upto = vfs_load_filepath(path, vfs_get_starting_node(path), 1, &node);
+	struct ARC_VFSPathSpan upto = { 0 };
+	int status = vfs_load_filepath(path, vfs_get_starting_node(dir, path), 1, &node, &upto);
 
-	if (upto == NULL) {
+	if (status < 0 && node == NULL) {
 		ARC_DEBUG(ERR, "Traversal failed\n");
 		return -2;
 	}
 
-	if (flags & O_CREAT) {
-		// TODO: Fix, node info should NOT be NULL
-		char *c_upto = vfs_create_filepath(upto, node, 1, NULL, &node);
-		free(upto);
-		upto = c_upto;
+	if (status == ARC_VFS_PATH_PARTIAL && (flags & O_CREAT)) {
+		struct ARC_VFSNodeInfo info = {
+		        .type = ARC_VFS_N_FILE,
+			.mode = mode,
+			.driver_index = (uint64_t)-1
+		};
+
+		struct ARC_VFSNode *parent = node;
+		status = vfs_create_filepath(path + upto.offset, parent, 1, &info, &node, NULL);
+		vfs_node_put(parent);
 	}
 
-	if (upto == NULL) {
+	if (status < 0) {
 		ARC_DEBUG(ERR, "Traversal failed\n");
+		vfs_node_put(node);
 		return -3;
 	}
 
-	if (*upto != 0) {
+	if (status != ARC_VFS_PATH_RESOLVED) {
 		ARC_DEBUG(ERR, "Traversal failed\n");
-		free(upto);
+		vfs_node_put(node);
 		return -4;
 	}
 
-	free(upto);
-
 	struct ARC_File *file = (struct ARC_File *)alloc(sizeof(*file));
 
 	if (file == NULL) {
-		ticket_unlock(&node->branch_lock);
-		ARC_ATOMIC_DEC(node->ref_count);
+		vfs_node_put(node);
 
 		return -5;
 	}
@@ -182,6 +288,18 @@ int vfs_open(char *path, int flags, uint32_t mode, struct ARC_File **ret) {
 	file->mode = mode;
 	file->node = node;
 
+	struct ARC_VFSNode *target = node->link != NULL ? node->link : node;
+
+	if ((flags & O_TRUNC) && target->cold.tmpfs != NULL) {
+		// NOTE: Drivers have no way to truncate, only the tmpfs is
+		vfs_tmpfs_truncate(target, 0);
+	}
+
+	// NOTE: Without its state the file is still usable, it is just never
+	//       read ahead
+	vfs_fstate_create(file);
+	vfs_ncache_touch(node);
+
 	*ret = file;
 
 	// Reference counter will be decremented by close function
@@ -213,12 +331,27 @@ size_t vfs_read(void *buffer, size_t size, size_t count, struct ARC_File *file)
 
 	struct ARC_Resource *res = node->resource;
 
+	if (node->cold.tmpfs != NULL) {
+		size_t ret = vfs_tmpfs_read(node, buffer, size * count, file->offset);
+		file->offset += ret;
+		ARC_ATOMIC_DEC(file->ref_count);
+
+		return ret;
+	}
+
 	if (res == NULL) {
 		ARC_ATOMIC_DEC(file->ref_count);
 		return 0;
 	}
 
-	int ret = res->driver->read(buffer, size, count, &internal_desc, res);
+	size_t ret = 0;
+
+	if (vfs_pcache_usable(node)) {
+		struct ARC_VFSFileState *state = vfs_fstate_get(file);
+		ret = vfs_pcache_read(node, &internal_desc, state == NULL ? NULL : &state->ra, buffer, size * count, file->offset);
+	} else {
+		ret = ARC_VFS_TIMED(ARC_VFS_LAT_READ, res->driver->read(buffer, size, count, &internal_desc, res));
+	}
 
 	file->offset += ret;
 
@@ -251,12 +384,27 @@ size_t vfs_write(void *buffer, size_t size, size_t count, struct ARC_File *file)
 
 	struct ARC_Resource *res = node->resource;
 
+	if (node->cold.tmpfs != NULL) {
+		size_t ret = vfs_tmpfs_write(node, buffer, size * count, file->offset);
+		file->offset += ret;
+		ARC_ATOMIC_DEC(file->ref_count);
+
+		return ret;
+	}
+
 	if (res == NULL) {
 		ARC_ATOMIC_DEC(file->ref_count);
 		return 0;
 	}
 
-	int ret = res->driver->write(buffer, size, count, &internal_desc, res);
+	size_t ret = 0;
+
+	if (vfs_pcache_usable(node)) {
+		ret = vfs_pcache_write(node, &internal_desc, buffer, size * count, file->offset);
+	} else {
+		ret = ARC_VFS_TIMED(ARC_VFS_LAT_WRITE, res->driver->write(buffer, size, count, &internal_desc, res));
+		vfs_node_stat_invalidate(node);
+	}
 
 	file->offset += ret;
 
@@ -265,350 +413,1040 @@ size_t vfs_write(void *buffer, size_t size, size_t count, struct ARC_File *file)
 	return ret;
 }
 
-int vfs_seek(struct ARC_File *file, long offset, int whence) {
-	if (file == NULL) {
-		return -1;
+// Transfer between iov and file starting at offset, without touching file->offset
+static size_t vfs_transfer(struct ARC_VFSIOVec *iov, int iovcnt, long offset, struct ARC_File *file, bool write) {
+	if (iov == NULL || iovcnt <= 0 || offset < 0 || file == NULL) {
+		return 0;
 	}
 
 	ARC_ATOMIC_INC(file->ref_count);
 
-	if (file->node == NULL) {
+	struct ARC_VFSNode *node = file->node;
+
+	if (node == NULL) {
 		ARC_ATOMIC_DEC(file->ref_count);
-		return -2;
+		return 0;
 	}
 
-	long size = file->node->stat.st_size;
+	struct ARC_File internal_desc = { 0 };
+	memcpy(&internal_desc, file, sizeof(internal_desc));
 
-	if (file->node->link != NULL) {
-		size = file->node->link->stat.st_size;
+	if (node->link != NULL) {
+		node = node->link;
+		internal_desc.node = node;
 	}
 
-	switch (whence) {
-		case SEEK_SET: {
-			if (0 <= offset && offset < size) {
-				file->offset = offset;
+	struct ARC_Resource *res = node->resource;
+
+	if (res == NULL && node->cold.tmpfs == NULL) {
+		ARC_ATOMIC_DEC(file->ref_count);
+		return 0;
+	}
+
+	struct ARC_VFSDriverExt *ext = res == NULL ? NULL : vfs_driver_ext(res->driver);
+	size_t (*vectored)(struct ARC_VFSIOVec *, int, long, struct ARC_File *, struct ARC_Resource *) = NULL;
+
+	if (ext != NULL) {
+		vectored = write ? ext->writev : ext->readv;
+	}
+
+	size_t total = 0;
+
+	if (node->cold.tmpfs != NULL) {
+		for (int i = 0; i < iovcnt; i++) {
+			if (iov[i].base == NULL || iov[i].len == 0) {
+				continue;
 			}
 
-			break;
+			size_t ret = 0;
+			if (write) {
+				ret = vfs_tmpfs_write(node, iov[i].base, iov[i].len, offset + total);
+			} else {
+				ret = vfs_tmpfs_read(node, iov[i].base, iov[i].len, offset + total);
+			}
+
+			total += ret;
+
+			if (ret < iov[i].len) {
+				break;
+			}
 		}
+	} else if (vfs_pcache_usable(node)) {
+		struct ARC_VFSFileState *state = write ? NULL : vfs_fstate_get(file);
 
-		case SEEK_CUR: {
-			if (0 <= file->offset + offset && file->offset + offset < size) {
-				file->offset += offset;
+		for (int i = 0; i < iovcnt; i++) {
+			if (iov[i].base == NULL || iov[i].len == 0) {
+				continue;
 			}
 
-			break;
+			size_t ret = 0;
+			if (write) {
+				ret = vfs_pcache_write(node, &internal_desc, iov[i].base, iov[i].len, offset + total);
+			} else {
+				ret = vfs_pcache_read(node, &internal_desc, state == NULL ? NULL : &state->ra, iov[i].base, iov[i].len, offset + total);
+			}
+
+			total += ret;
+
+			if (ret < iov[i].len) {
+				break;
+			}
 		}
+	} else if (vectored != NULL) {
+		// The whole array goes to the driver in one dispatch
+		total = ARC_VFS_TIMED(write ? ARC_VFS_LAT_WRITE : ARC_VFS_LAT_READ, vectored(iov, iovcnt, offset, &internal_desc, res));
+	} else {
+		// NOTE: Drivers take the position from the descriptor, the private
+		//       copy is moved along instead of the caller's
+		for (int i = 0; i < iovcnt; i++) {
+			if (iov[i].base == NULL || iov[i].len == 0) {
+				continue;
+			}
 
-		case SEEK_END: {
-			if (0 <= size - offset - 1 && size - offset - 1 < size) {
-				file->offset = size - offset - 1;
+			internal_desc.offset = offset + total;
+
+			size_t ret = 0;
+			if (write) {
+				ret = ARC_VFS_TIMED(ARC_VFS_LAT_WRITE, res->driver->write(iov[i].base, 1, iov[i].len, &internal_desc, res));
+			} else {
+				ret = ARC_VFS_TIMED(ARC_VFS_LAT_READ, res->driver->read(iov[i].base, 1, iov[i].len, &internal_desc, res));
 			}
 
-			break;
+			total += ret;
+
+			if (ret < iov[i].len) {
+				// Short transfer, the file ended or the driver failed
+				break;
+			}
 		}
 	}
 
+	if (write && total > 0 && res != NULL && node->cold.pcache == NULL) {
+		// The driver has changed the size and times behind the cached attributes
+		vfs_node_stat_invalidate(node);
+	}
+
 	ARC_ATOMIC_DEC(file->ref_count);
 
-	return 0;
+	return total;
 }
 
-int vfs_close(struct ARC_File *file) {
-	if (file == NULL || file->node == NULL) {
-		return -1;
-	}
-
-	if (file->ref_count > 0) {
-		return -2;
+size_t vfs_readv(struct ARC_VFSIOVec *iov, int iovcnt, struct ARC_File *file) {
+	if (file == NULL) {
+		return 0;
 	}
 
-	struct ARC_VFSNode *node = file->node;
+	size_t ret = vfs_transfer(iov, iovcnt, file->offset, file, 0);
+	file->offset += ret;
 
-	ARC_ATOMIC_DEC(node->ref_count);
-	free(file);
+	return ret;
+}
 
-	if (node->ref_count > 0) {
+size_t vfs_writev(struct ARC_VFSIOVec *iov, int iovcnt, struct ARC_File *file) {
+	if (file == NULL) {
 		return 0;
 	}
 
-	spinlock_lock(&vfs_node_cache_lock);
-	uint64_t idx = ARC_ATOMIC_INC(vfs_node_cache_idx);
-	vfs_node_cache_idx %= NODE_CACHE_SIZE;
-	spinlock_unlock(&vfs_node_cache_lock);
+	size_t ret = vfs_transfer(iov, iovcnt, file->offset, file, 1);
+	file->offset += ret;
 
-	idx--;
+	return ret;
+}
 
-	vfs_delete_node(vfs_node_cache[idx], 1);
-	vfs_node_cache[idx] = node;
+size_t vfs_preadv(struct ARC_VFSIOVec *iov, int iovcnt, long offset, struct ARC_File *file) {
+	return vfs_transfer(iov, iovcnt, offset, file, 0);
+}
 
-	return 0;
+size_t vfs_pwritev(struct ARC_VFSIOVec *iov, int iovcnt, long offset, struct ARC_File *file) {
+	return vfs_transfer(iov, iovcnt, offset, file, 1);
 }
 
-// TODO: What if the given filepath is a directory?
-int vfs_stat(char *filepath, struct stat *stat) {
-	if (filepath == NULL || stat == NULL) {
-		return -1;
-	}
+size_t vfs_pread(void *buffer, size_t size, size_t count, long offset, struct ARC_File *file) {
+	struct ARC_VFSIOVec iov = { .base = buffer, .len = size * count };
+	return vfs_transfer(&iov, 1, offset, file, 0);
+}
 
-	struct ARC_VFSNode *node = NULL;
-	char *upto = vfs_load_filepath(filepath, vfs_get_starting_node(filepath), 1, &node);
+size_t vfs_pwrite(void *buffer, size_t size, size_t count, long offset, struct ARC_File *file) {
+	struct ARC_VFSIOVec iov = { .base = buffer, .len = size * count };
+	return vfs_transfer(&iov, 1, offset, file, 1);
+}
 
-	if (upto == NULL) {
-		return -2;
+int vfs_mmap(struct ARC_File *file, long offset, size_t length, int prot, struct ARC_VFSMapping **ret) {
+	if (ret != NULL) {
+		*ret = NULL;
 	}
 
-	if (*upto != 0) {
-		ARC_ATOMIC_DEC(node->ref_count);
-		free(upto);
-		return -3;
+	if (file == NULL || file->node == NULL || length == 0 || ret == NULL || (prot & ARC_VFS_MAP_READ) == 0) {
+		return -1;
 	}
 
-	int ret = node->resource->driver->stat(node->resource, NULL, stat);
-
-	ARC_ATOMIC_DEC(node->ref_count);
-
-	return ret;
-}
-
-int vfs_create(char *path, struct ARC_VFSNodeInfo *info) {
-	if (path == NULL || info == NULL) {
-		return -1;
+	if (offset < 0 || offset % ARC_VFS_PAGE_SIZE != 0) {
+		ARC_DEBUG(ERR, "Mapping offset %ld is not page aligned\n", offset);
+		return -2;
 	}
 
-	char *upto = vfs_create_filepath(path, vfs_get_starting_node(path), 1, info, NULL);
+	struct ARC_VFSNode *node = file->node;
 
-	if (upto == NULL) {
-		return -2;
+	if (node->link != NULL) {
+		node = node->link;
 	}
 
-	if (*upto != 0) {
-		free(upto);
+	if (!vfs_pcache_usable(node) && node->cold.tmpfs == NULL) {
+		ARC_DEBUG(ERR, "Cannot map \"%s\", it is not cached\n", node->name);
 		return -3;
 	}
 
-	return 0;
-}
+	struct ARC_VFSMapping *map = (struct ARC_VFSMapping *)alloc(sizeof(*map));
 
-int vfs_remove(char *filepath, bool recurse) {
-	if (filepath == NULL) {
-		return -1;
+	if (map == NULL) {
+		return -4;
 	}
 
-	struct ARC_VFSNode *node = NULL;
-	char *upto = vfs_traverse_filepath(filepath, vfs_get_starting_node(filepath), 0, &node);
+	memset(map, 0, sizeof(*map));
+	map->page_count = (length + ARC_VFS_PAGE_SIZE - 1) / ARC_VFS_PAGE_SIZE;
+	map->pages = (void **)alloc(map->page_count * sizeof(void *));
 
-	if (upto == NULL) {
-		return -2;
+	if (map->pages == NULL) {
+		free(map);
+		return -5;
 	}
 
-	ARC_ATOMIC_DEC(node->ref_count);
+	memset(map->pages, 0, map->page_count * sizeof(void *));
+	map->file = file;
+	map->node = node;
+	map->offset = offset;
+	map->length = length;
+	map->prot = prot;
 
-	if (*upto != 0) {
-		free(upto);
-		return -3;
-	}
+	vfs_tmpfs_map(node, 1);
 
-	if (recurse) {
-		vfs_delete_node_recursive(node, 1 | (1 << 1));
-	} else {
-		vfs_delete_node(node, 1 | (1 << 1));
-	}
+	// Held until vfs_munmap, vfs_close refuses to free the file until then
+	ARC_ATOMIC_INC(file->ref_count);
+
+	*ret = map;
 
 	return 0;
 }
 
-int vfs_link(char *a, char *b, int32_t mode) {
-	if (a == NULL || b == NULL || mode == 0) {
-		// Invalid parameters
-		return -1;
+void *vfs_mmap_fault(struct ARC_VFSMapping *map, size_t offset) {
+	if (map == NULL || offset >= map->length) {
+		return NULL;
 	}
 
-	struct ARC_VFSNode *node_a = NULL;
-	char *upto = vfs_load_filepath(a, vfs_get_starting_node(a), 1, &node_a);
+	size_t page = offset / ARC_VFS_PAGE_SIZE;
+	void *data = __atomic_load_n(&map->pages[page], __ATOMIC_ACQUIRE);
 
-	if (upto == NULL) {
-		// Something has gone very wrong
-		return -2;
+	if (data != NULL) {
+		return data;
 	}
 
-	if (*upto != 0) {
-		// The path to link to does not exist
-		ARC_ATOMIC_DEC(node_a->ref_count);
+	struct ARC_File internal_desc = { 0 };
+	memcpy(&internal_desc, map->file, sizeof(internal_desc));
+	internal_desc.node = map->node;
 
-		free(upto);
-		return -3;
+	struct ARC_VFSFileState *state = vfs_fstate_get(map->file);
+	uint64_t index = map->offset / ARC_VFS_PAGE_SIZE + page;
+	bool write = (map->prot & ARC_VFS_MAP_WRITE) != 0;
+
+	if (map->node->cold.tmpfs != NULL) {
+		// Already in memory, and never moves
+		data = vfs_tmpfs_page(map->node, index);
+	} else {
+		data = vfs_pcache_pin(map->node, &internal_desc, state == NULL ? NULL : &state->ra, index, write);
 	}
 
-	free(upto);
+	if (data == NULL) {
+		ARC_DEBUG(ERR, "Failed to fault in page %lu of \"%s\"\n", index, map->node->name);
+		return NULL;
+	}
 
-	struct ARC_VFSNode *node_b = NULL;
-	upto = vfs_load_filepath(b, vfs_get_starting_node(b), 1, &node_b);
+	void *expected = NULL;
+	if (!__atomic_compare_exchange_n(&map->pages[page], &expected, data, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+		// Faulted in by someone else at the same time
+		if (map->node->cold.tmpfs == NULL) {
+			vfs_pcache_unpin(map->node, index, write);
+		}
 
-	if (upto == NULL) {
-		// Something has gone very wrong
-		return -4;
+		return expected;
 	}
 
-	if (*upto == 0) {
-		// The path that is going to be linked to already exists, do not
-		// overwrite it
-		ARC_ATOMIC_DEC(node_a->ref_count);
-		ARC_ATOMIC_DEC(node_b->ref_count);
+	return data;
+}
 
-		return -5;
+int vfs_msync(struct ARC_VFSMapping *map) {
+	if (map == NULL) {
+		return -1;
 	}
 
-	struct ARC_VFSNodeInfo info = {
-	        .type = ARC_VFS_N_LINK,
-		.mode = mode == -1 ? MASKED_READ(node_a->stat.st_mode, 0, 0x1FF) : MASKED_READ(mode, 0, 0x1FF),
-		.driver_index = (uint64_t)-1
-        };
+	if ((map->prot & ARC_VFS_MAP_WRITE) == 0) {
+		return 0;
+	}
 
-	char *c_upto = vfs_create_filepath(upto, node_b, 1, &info, &node_b);
-	free(upto);
+	return vfs_pcache_writeback(map->node);
+}
 
-	if (c_upto == NULL) {
-		// Something has gone very wrong with the creation
-		return -5;
+int vfs_munmap(struct ARC_VFSMapping *map) {
+	if (map == NULL) {
+		return -1;
 	}
 
-	if (*c_upto != 0) {
-		// The creation has not completed all the way
-		ARC_ATOMIC_DEC(node_a->ref_count);
-		ARC_ATOMIC_DEC(node_b->ref_count);
-		free(c_upto);
-		return -6;
-	}
+	bool write = (map->prot & ARC_VFS_MAP_WRITE) != 0;
+	uint64_t first = map->offset / ARC_VFS_PAGE_SIZE;
 
-	struct ARC_File fake = { .node = node_b };
-	char *rel_path = vfs_get_path(b, a);
-	vfs_write(rel_path, 1, strlen(rel_path), &fake);
+	for (size_t i = 0; i < map->page_count; i++) {
+		if (map->pages[i] != NULL && map->node->cold.tmpfs == NULL) {
+			vfs_pcache_unpin(map->node, first + i, write);
+		}
+	}
 
-	mutex_lock(&node_b->branch_lock);
-	node_b->link = node_a;
-	mutex_unlock(&node_b->branch_lock);
+	int ret = vfs_msync(map);
 
-	ARC_ATOMIC_DEC(node_b->ref_count);
+	vfs_tmpfs_map(map->node, -1);
+	ARC_ATOMIC_DEC(map->file->ref_count);
 
-	// NOTE: ref_count of Node A is left incremented as it is now in use by this link
+	free(map->pages);
+	free(map);
 
-	return 0;
+	return ret;
 }
 
-int vfs_rename(char *a, char *b) {
-	if (a == NULL || b == NULL) {
-		// Invalid parameters
+int vfs_seek(struct ARC_File *file, long offset, int whence) {
+	if (file == NULL) {
 		return -1;
 	}
 
-	struct ARC_VFSNode *node_a = NULL;
-	char *upto = vfs_load_filepath(a, vfs_get_starting_node(a), 1, &node_a);
+	ARC_ATOMIC_INC(file->ref_count);
 
-	if (upto == NULL) {
-		// Something has gone very wrong
+	if (file->node == NULL) {
+		ARC_ATOMIC_DEC(file->ref_count);
 		return -2;
 	}
 
-	if (*upto != 0) {
-		// The path to rename does not exist
-		ARC_ATOMIC_DEC(node_a->ref_count);
-		free(upto);
-		return -3;
-	}
+	struct ARC_VFSNode *node = file->node->link != NULL ? file->node->link : file->node;
+	struct stat stat = { 0 };
+	vfs_node_stat(node, &stat);
 
-	free(upto);
+	long size = stat.st_size;
 
-	struct ARC_VFSNode *node_b = NULL;
-	upto = vfs_load_filepath(b, vfs_get_starting_node(b), 1, &node_b);
+	switch (whence) {
+		case SEEK_SET: {
+			if (0 <= offset && offset < size) {
+				file->offset = offset;
+			}
+
+			break;
+		}
+
+		case SEEK_CUR: {
+			if (0 <= file->offset + offset && file->offset + offset < size) {
+				file->offset += offset;
+			}
+
+			break;
+		}
+
+		case SEEK_END: {
+			if (0 <= size - offset - 1 && size - offset - 1 < size) {
+				file->offset = size - offset - 1;
+			}
+
+			break;
+		}
+	}
+
+	ARC_ATOMIC_DEC(file->ref_count);
+
+	return 0;
+}
+
+int vfs_close(struct ARC_File *file) {
+	if (file == NULL || file->node == NULL) {
+		return -1;
+	}
+
+	if (file->ref_count > 0) {
+		return -2;
+	}
+
+	struct ARC_VFSNode *node = file->node;
+	vfs_fstate_destroy(file);
+	free(file);
+
+	// NOTE: Not a guarantee of durability, a failed write back is left to the
+	//       next one, see vfs_fsync
+	vfs_pcache_writeback(node);
+
+	// NOTE: Cached while the reference is still held, once it is dropped the
+	//       node may be deleted at any point
+	vfs_ncache_insert(node);
+	vfs_node_put(node);
+
+	return 0;
+}
+
+int vfs_stat(char *filepath, struct stat *stat) {
+	return vfs_statat(NULL, filepath, stat);
+}
+
+static int vfs_sync(struct ARC_File *file, int datasync) {
+	if (file == NULL || file->node == NULL) {
+		return -1;
+	}
+
+	struct ARC_VFSNode *node = file->node;
+
+	if (node->link != NULL) {
+		node = node->link;
+	}
+
+	struct ARC_Resource *res = node->resource;
+
+	if (vfs_pcache_writeback(node) != 0) {
+		return -2;
+	}
+
+	struct ARC_VFSDriverExt *ext = res == NULL ? NULL : vfs_driver_ext(res->driver);
+
+	if (ext != NULL && ext->sync != NULL && ext->sync(res, datasync) != 0) {
+		return -3;
+	}
+
+	return 0;
+}
+
+int vfs_fsync(struct ARC_File *file) {
+	return vfs_sync(file, 0);
+}
+
+int vfs_fdatasync(struct ARC_File *file) {
+	return vfs_sync(file, 1);
+}
+
+int vfs_chdir(struct ARC_File **cwd, char *path) {
+	if (cwd == NULL || path == NULL) {
+		return -1;
+	}
+
+	struct ARC_File *dir = NULL;
+
+	if (vfs_openat(*cwd, path, 0, ARC_STD_PERM, &dir) != 0) {
+		return -2;
+	}
+
+	if (dir->node->type != ARC_VFS_N_DIR && dir->node->type != ARC_VFS_N_MOUNT) {
+		ARC_DEBUG(ERR, "Cannot change into %s, it is not a directory\n", path);
+		vfs_close(dir);
+		return -3;
+	}
+
+	if (*cwd != NULL && vfs_close(*cwd) != 0) {
+		vfs_close(dir);
+		return -4;
+	}
+
+	*cwd = dir;
+
+	return 0;
+}
+
+char *vfs_getcwd(struct ARC_File *cwd) {
+	if (cwd == NULL || cwd->node == NULL) {
+		return NULL;
+	}
+
+	char *rel = vfs_get_path_from_nodes(&vfs_root, cwd->node);
+
+	if (rel == NULL) {
+		return NULL;
+	}
+
+	size_t len = strlen(rel);
+	char *path = (char *)alloc(len + 2);
+
+	if (path != NULL) {
+		path[0] = '/';
+		memcpy(path + 1, rel, len + 1);
+	}
+
+	free(rel);
+
+	return path;
+}
+
+// TODO: What if the given filepath is a directory?
+int vfs_statat(struct ARC_File *dir, char *filepath, struct stat *stat) {
+	if (filepath == NULL || stat == NULL) {
+		return -1;
+	}
+
+	struct ARC_VFSNode *node = NULL;
+	int status = vfs_load_filepath(filepath, vfs_get_starting_node(dir, filepath), 1, &node, NULL);
+
+	if (node == NULL) {
+		return -2;
+	}
+
+	if (status != ARC_VFS_PATH_RESOLVED) {
+		vfs_node_put(node);
+		return -3;
+	}
 
-	if (upto == NULL) {
+	int ret = vfs_node_stat(node, stat);
+
+	vfs_node_put(node);
+
+	return ret;
+}
+
+int vfs_create(char *path, struct ARC_VFSNodeInfo *info) {
+	return vfs_createat(NULL, path, info);
+}
+
+int vfs_createat(struct ARC_File *dir, char *path, struct ARC_VFSNodeInfo *info) {
+	if (path == NULL || info == NULL) {
+		return -1;
+	}
+
+	int status = vfs_create_filepath(path, vfs_get_starting_node(dir, path), 1, info, NULL, NULL);
+
+	if (status < 0) {
+		return -2;
+	}
+
+	if (status != ARC_VFS_PATH_RESOLVED) {
+		return -3;
+	}
+
+	return 0;
+}
+
+int vfs_remove(char *filepath, bool recurse) {
+	return vfs_removeat(NULL, filepath, recurse);
+}
+
+int vfs_removeat(struct ARC_File *dir, char *filepath, bool recurse) {
+	if (filepath == NULL) {
+		return -1;
+	}
+
+	struct ARC_VFSNode *node = NULL;
+	int status = vfs_traverse_filepath(filepath, vfs_get_starting_node(dir, filepath), 0, &node, NULL);
+
+	if (node == NULL) {
+		return -2;
+	}
+
+	vfs_node_put(node);
+
+	if (status != ARC_VFS_PATH_RESOLVED) {
+		return -3;
+	}
+
+	if (recurse) {
+		vfs_delete_node_recursive(node, 1 | (1 << 1));
+	} else {
+		vfs_delete_node(node, 1 | (1 << 1));
+	}
+
+	return 0;
+}
+
+int vfs_link(char *a, char *b, int32_t mode) {
+	if (a == NULL || b == NULL || mode == 0) {
+		// Invalid parameters
+		return -1;
+	}
+
+	struct ARC_VFSNode *node_a = NULL;
+	int status = vfs_load_filepath(a, vfs_get_starting_node(NULL, a), 1, &node_a, NULL);
+
+	if (node_a == NULL) {
+		// Something has gone very wrong
+		return -2;
+	}
+
+	if (status != ARC_VFS_PATH_RESOLVED) {
+		// The path to link to does not exist
+		vfs_node_put(node_a);
+
+		return -3;
+	}
+
+	struct ARC_VFSNode *node_b = NULL;
+	struct ARC_VFSPathSpan upto = { 0 };
+	status = vfs_load_filepath(b, vfs_get_starting_node(NULL, b), 1, &node_b, &upto);
+
+	if (node_b == NULL) {
 		// Something has gone very wrong
+		vfs_node_put(node_a);
+		return -4;
+	}
+
+	if (status != ARC_VFS_PATH_PARTIAL) {
+		// The path that is going to be linked to already exists, do not
+		// overwrite it
+		vfs_node_put(node_a);
+		vfs_node_put(node_b);
+
+		return -5;
+	}
+
+	struct stat stat_a = { 0 };
+	vfs_node_stat(node_a, &stat_a);
+
+	struct ARC_VFSNodeInfo info = {
+	        .type = ARC_VFS_N_LINK,
+		.mode = mode == -1 ? MASKED_READ(stat_a.st_mode, 0, 0x1FF) : MASKED_READ(mode, 0, 0x1FF),
+		.driver_index = (uint64_t)-1
+        };
+
+	struct ARC_VFSNode *parent = node_b;
+	status = vfs_create_filepath(b + upto.offset, parent, 1, &info, &node_b, NULL);
+	vfs_node_put(parent);
+
+	if (status < 0) {
+		// Something has gone very wrong with the creation
+		vfs_node_put(node_a);
+		vfs_node_put(node_b);
 		return -5;
 	}
 
-	if (*upto == 0) {
+	if (status != ARC_VFS_PATH_RESOLVED) {
+		// The creation has not completed all the way
+		vfs_node_put(node_a);
+		vfs_node_put(node_b);
+		return -6;
+	}
+
+	struct ARC_File fake = { .node = node_b };
+	char *rel_path = vfs_get_path(b, a);
+	vfs_write(rel_path, 1, strlen(rel_path), &fake);
+
+	vfs_branch_lock(node_b);
+	node_b->link = node_a;
+	vfs_branch_unlock(node_b);
+
+	vfs_node_put(node_b);
+
+	// NOTE: ref_count of Node A is left incremented as it is now in use by this link
+
+	return 0;
+}
+
+int vfs_rename(char *a, char *b) {
+	if (a == NULL || b == NULL) {
+		// Invalid parameters
+		return -1;
+	}
+
+	struct ARC_VFSNode *node_a = NULL;
+	// NOTE: A link is renamed itself, not its target
+	int status = vfs_load_filepath(a, vfs_get_starting_node(NULL, a), 0, &node_a, NULL);
+
+	if (node_a == NULL) {
+		// Something has gone very wrong
+		return -2;
+	}
+
+	if (status != ARC_VFS_PATH_RESOLVED) {
+		// The path to rename does not exist
+		vfs_node_put(node_a);
+		return -3;
+	}
+
+	struct ARC_VFSNode *node_b = NULL;
+	struct ARC_VFSPathSpan upto = { 0 };
+	status = vfs_load_filepath(b, vfs_get_starting_node(NULL, b), 1, &node_b, &upto);
+
+	if (node_b == NULL) {
+		// Something has gone very wrong
+		vfs_node_put(node_a);
+		return -5;
+	}
+
+	if (status != ARC_VFS_PATH_PARTIAL) {
 		// File path already exists, cannot overwrite
-		ARC_ATOMIC_DEC(node_a->ref_count);
-		ARC_ATOMIC_DEC(node_b->ref_count);
+		vfs_node_put(node_a);
+		vfs_node_put(node_b);
 
-		free(upto);
 		return -6;
 	}
 
+	struct stat stat_a = { 0 };
+	vfs_node_stat(node_a, &stat_a);
+
 	struct ARC_VFSNodeInfo info = {
 	        .type = ARC_VFS_N_DIR,
 		.flags = 1,
-		.mode = node_a->stat.st_mode,
+		.mode = stat_a.st_mode,
 		.driver_index = (uint64_t)-1
         };
 
-	char *c_upto = vfs_create_filepath(upto, node_b, 1 | (1 << 1), &info, &node_b);
-	free(upto);
+	struct ARC_VFSNode *parent = node_b;
+	char *rest = b + upto.offset;
+	status = vfs_create_filepath(rest, parent, 1 | (1 << 1), &info, &node_b, &upto);
+	vfs_node_put(parent);
 
-	if (c_upto == NULL) {
+	if (status < 0) {
 		// Something has gone very wrong
-		ARC_ATOMIC_DEC(node_a->ref_count);
-		ARC_ATOMIC_DEC(node_b->ref_count);
+		vfs_node_put(node_a);
+		vfs_node_put(node_b);
 
 		return -6;
 	}
 
-	// TODO: There is probably a better way to find out if this is the last
-	//       component from the traversal function
-	int sep_count = 0;
-	while (*c_upto != 0) {
-		if (*c_upto == '/') {
-			sep_count++;
-		}
+	// Only the last component should be left
+	char *c_upto = rest + upto.offset;
+
+	if (upto.length == 0 || memchr(c_upto, '/', upto.length) != NULL) {
+		vfs_node_put(node_a);
+		vfs_node_put(node_b);
 
-		c_upto++;
+		return -7;
 	}
 
-	if (sep_count > 0) {
-		ARC_ATOMIC_DEC(node_a->ref_count);
-		ARC_ATOMIC_DEC(node_b->ref_count);
+	c_upto = strndup(c_upto, upto.length);
 
-		free(c_upto);
-		return -7;
+	if (c_upto == NULL) {
+		vfs_node_put(node_a);
+		vfs_node_put(node_b);
+
+		return -8;
 	}
 
 	// TODO: Tell the drivers about this
 	// TODO: What if A and B are on different mount points?
-	mutex_lock(&node_a->parent->branch_lock);
+	struct ARC_VFSNode *parent_a = node_a->parent;
 
-	if (node_a->prev != NULL) {
-		// Update Node A's prev->next pointer
-		node_a->prev->next = node_a->next;
-	} else {
-		// Otherwise it is the first in the list, update parent
-		node_a->parent->children = node_a->next;
+	vfs_branch_lock(parent_a);
+	vfs_branch_write_begin(parent_a);
+	vfs_detach_node(node_a);
+	vfs_branch_write_end(parent_a);
+	vfs_branch_unlock(parent_a);
+
+	// Update Node B's linked list
+	vfs_branch_lock(node_b);
+	vfs_branch_write_begin(node_b);
+
+	vfs_rename_node(node_a, c_upto);
+	vfs_attach_node(node_b, node_a);
+
+	vfs_branch_write_end(node_b);
+	vfs_branch_unlock(node_b);
+
+	vfs_node_put(node_a);
+	vfs_node_put(node_b);
+
+	return 0;
+}
+
+struct vfs_batch_entry {
+	struct ARC_VFSBatchOp *op;
+	/// Length of the directory part of op->path, zero for the root.
+	size_t dir_len;
+	/// Zero for creates and renames, one for removes.
+	int phase;
+};
+
+static int vfs_batch_order(struct vfs_batch_entry *a, struct vfs_batch_entry *b) {
+	if (a->phase != b->phase) {
+		return a->phase - b->phase;
 	}
 
-	// Update Node A's next->prev pointer
-	if (node_a->next != NULL) {
-		node_a->next->prev = node_a->prev;
+	int cmp = memcmp(a->op->path, b->op->path, min(a->dir_len, b->dir_len));
+
+	if (cmp == 0) {
+		// An ancestor is a prefix of its descendants
+		cmp = (a->dir_len > b->dir_len) - (a->dir_len < b->dir_len);
 	}
 
-	mutex_unlock(&node_a->parent->branch_lock);
+	// Removes go from the leaves up
+	return a->phase == 0 ? cmp : -cmp;
+}
 
-	// Update Node B's linked list
-	mutex_lock(&node_b->branch_lock);
+// Stable, so that operations in one directory keep their order
+static void vfs_batch_sort(struct vfs_batch_entry *entries, struct vfs_batch_entry *scratch, size_t count) {
+	for (size_t width = 1; width < count; width *= 2) {
+		for (size_t lo = 0; lo < count; lo += width * 2) {
+			size_t mid = min(lo + width, count);
+			size_t hi = min(lo + width * 2, count);
+			size_t i = lo;
+			size_t j = mid;
+			size_t k = lo;
+
+			while (i < mid && j < hi) {
+				scratch[k++] = vfs_batch_order(&entries[j], &entries[i]) < 0 ? entries[j++] : entries[i++];
+			}
+
+			while (i < mid) {
+				scratch[k++] = entries[i++];
+			}
+
+			while (j < hi) {
+				scratch[k++] = entries[j++];
+			}
+		}
 
-	if (node_b->children != NULL) {
-		node_b->children->prev = node_a;
+		memcpy(entries, scratch, sizeof(*entries) * count);
 	}
+}
 
-	node_a->next = node_b->children;
-	node_b->children = node_a;
-	node_a->parent = node_b;
+static void vfs_batch_create(struct ARC_VFSNode *parent, struct vfs_batch_entry *run, size_t count) {
+	char *names[ARC_VFS_CREATE_CHUNK];
+	struct ARC_VFSNodeInfo *infos[ARC_VFS_CREATE_CHUNK];
+	int results[ARC_VFS_CREATE_CHUNK];
 
-	mutex_unlock(&node_b->branch_lock);
+	for (size_t i = 0; i < count; i++) {
+		names[i] = run[i].op->path + run[i].dir_len + 1;
+		infos[i] = &run[i].op->info;
+	}
 
-	ARC_ATOMIC_DEC(node_a->ref_count);
-	ARC_ATOMIC_DEC(node_b->ref_count);
+	vfs_create_children(parent, names, infos, count, results, NULL);
 
-	return 0;
+	for (size_t i = 0; i < count; i++) {
+		run[i].op->result = results[i];
+	}
+}
+
+static void vfs_batch_remove(struct ARC_VFSNode *parent, struct vfs_batch_entry *run, size_t count) {
+	struct ARC_VFSNode *nodes[ARC_VFS_DELETE_CHUNK];
+	struct ARC_VFSBatchOp *found[ARC_VFS_DELETE_CHUNK];
+	int results[ARC_VFS_DELETE_CHUNK];
+	size_t n = 0;
+
+	for (size_t i = 0; i < count; i++) {
+		struct ARC_VFSNode *node = NULL;
+		// NOTE: A link is removed itself, not its target
+		int status = vfs_load_filepath(run[i].op->path + run[i].dir_len + 1, parent, 0, &node, NULL);
+
+		if (status != ARC_VFS_PATH_RESOLVED || node == NULL || node->parent != parent) {
+			if (node != NULL) {
+				vfs_node_put(node);
+			}
+
+			run[i].op->result = -3;
+			continue;
+		}
+
+		nodes[n] = node;
+		found[n++] = run[i].op;
+	}
+
+	vfs_delete_children(parent, nodes, n, 1 << 1, results);
+
+	for (size_t i = 0; i < n; i++) {
+		found[i]->result = results[i];
+	}
+}
+
+static char *vfs_batch_last_slash(char *path) {
+	char *last = NULL;
+
+	for (; path != NULL && *path != 0; path++) {
+		if (*path == '/') {
+			last = path;
+		}
+	}
+
+	return last;
+}
+
+// Whether the target of a rename is in the directory its source is in
+static bool vfs_batch_rename_local(struct vfs_batch_entry *entry) {
+	char *target = entry->op->target;
+	char *last = vfs_batch_last_slash(target);
+
+	return last != NULL && (size_t)(last - target) == entry->dir_len && last[1] != 0
+	       && memcmp(target, entry->op->path, entry->dir_len) == 0;
+}
+
+// Renames within parent, all under one hold of its branch_lock
+static void vfs_batch_rename(struct ARC_VFSNode *parent, struct vfs_batch_entry *run, size_t count) {
+	struct ARC_VFSNode *nodes[ARC_VFS_CREATE_CHUNK];
+	char *names[ARC_VFS_CREATE_CHUNK];
+
+	for (size_t i = 0; i < count; i++) {
+		struct ARC_VFSBatchOp *op = run[i].op;
+		// NOTE: A link is renamed itself, not its target
+		int status = vfs_load_filepath(op->path + run[i].dir_len + 1, parent, 0, &nodes[i], NULL);
+		char *name = op->target + run[i].dir_len + 1;
+		names[i] = strndup(name, strlen(name));
+
+		if (status != ARC_VFS_PATH_RESOLVED || nodes[i] == NULL || names[i] == NULL) {
+			op->result = names[i] == NULL ? -8 : -3;
+		}
+	}
+
+	vfs_branch_lock(parent);
+
+	for (size_t i = 0; i < count; i++) {
+		struct ARC_VFSBatchOp *op = run[i].op;
+
+		if (op->result != 0) {
+			continue;
+		}
+
+		if (nodes[i]->parent != parent) {
+			// Moved elsewhere since it was found
+			op->result = -3;
+			continue;
+		}
+
+		if (vfs_lookup_child(parent, names[i], strlen(names[i])) != NULL) {
+			// Cannot overwrite
+			op->result = -6;
+			continue;
+		}
+
+		vfs_branch_write_begin(parent);
+		vfs_detach_node(nodes[i]);
+		vfs_rename_node(nodes[i], names[i]);
+		vfs_attach_node(parent, nodes[i]);
+		vfs_branch_write_end(parent);
+
+		names[i] = NULL;
+	}
+
+	vfs_branch_unlock(parent);
+
+	for (size_t i = 0; i < count; i++) {
+		if (nodes[i] != NULL) {
+			vfs_node_put(nodes[i]);
+		}
+
+		if (names[i] != NULL) {
+			free(names[i]);
+		}
+	}
+}
+
+// Every entry of group is in the same directory and phase
+static void vfs_batch_group(struct vfs_batch_entry *group, size_t count) {
+	size_t dir_len = group[0].dir_len;
+	char *dir = dir_len == 0 ? strndup("/", 1) : strndup(group[0].op->path, dir_len);
+	bool creates = false;
+
+	for (size_t i = 0; i < count; i++) {
+		group[i].op->result = 0;
+		creates |= group[i].op->op == ARC_VFS_BATCH_CREATE;
+	}
+
+	struct ARC_VFSNode *parent = NULL;
+	struct ARC_VFSPathSpan upto = { 0 };
+	int status = dir == NULL ? -1 : vfs_load_filepath(dir, &vfs_root, 1, &parent, &upto);
+
+	if (status == ARC_VFS_PATH_PARTIAL && creates) {
+		struct ARC_VFSNodeInfo info = { .type = ARC_VFS_N_DIR, .driver_index = (uint64_t)-1 };
+		struct ARC_VFSNode *base = parent;
+
+		parent = NULL;
+		status = vfs_create_filepath(dir + upto.offset, base, 1, &info, &parent, NULL);
+		vfs_node_put(base);
+	}
+
+	if (dir != NULL) {
+		free(dir);
+	}
+
+	if (status != ARC_VFS_PATH_RESOLVED) {
+		ARC_DEBUG(ERR, "Failed to find the directory of %s\n", group[0].op->path);
+
+		if (parent != NULL) {
+			vfs_node_put(parent);
+		}
+
+		for (size_t i = 0; i < count; i++) {
+			group[i].op->result = -2;
+		}
+
+		return;
+	}
+
+	// Consecutive operations of one kind are done together
+	for (size_t i = 0; i < count;) {
+		int op = group[i].op->op;
+		bool local = op == ARC_VFS_BATCH_RENAME && vfs_batch_rename_local(&group[i]);
+		size_t run = i + 1;
+
+		while (run < count && run - i < ARC_VFS_CREATE_CHUNK && group[run].op->op == op
+		       && (op != ARC_VFS_BATCH_RENAME || vfs_batch_rename_local(&group[run]) == local)) {
+			run++;
+		}
+
+		if (op == ARC_VFS_BATCH_CREATE) {
+			vfs_batch_create(parent, &group[i], run - i);
+		} else if (op == ARC_VFS_BATCH_REMOVE) {
+			vfs_batch_remove(parent, &group[i], run - i);
+		} else if (local) {
+			vfs_batch_rename(parent, &group[i], run - i);
+		} else {
+			for (size_t j = i; j < run; j++) {
+				group[j].op->result = vfs_rename(group[j].op->path, group[j].op->target);
+			}
+		}
+
+		i = run;
+	}
+
+	vfs_node_put(parent);
+}
+
+int vfs_batch(struct ARC_VFSBatchOp *ops, size_t count) {
+	if (ops == NULL) {
+		return -1;
+	}
+
+	if (count == 0) {
+		return 0;
+	}
+
+	struct vfs_batch_entry *entries = (struct vfs_batch_entry *)alloc(sizeof(*entries) * count * 2);
+
+	if (entries == NULL) {
+		return -2;
+	}
+
+	size_t n = 0;
+	int failed = 0;
+
+	for (size_t i = 0; i < count; i++) {
+		struct ARC_VFSBatchOp *op = &ops[i];
+		char *last = vfs_batch_last_slash(op->path);
+
+		if (last == NULL || *op->path != '/' || last[1] == 0 || op->op < ARC_VFS_BATCH_CREATE || op->op > ARC_VFS_BATCH_RENAME
+		    || (op->op == ARC_VFS_BATCH_RENAME && op->target == NULL)) {
+			op->result = -1;
+			failed++;
+			continue;
+		}
+
+		entries[n].op = op;
+		entries[n].dir_len = last - op->path;
+		entries[n].phase = op->op == ARC_VFS_BATCH_REMOVE;
+		n++;
+	}
+
+	vfs_batch_sort(entries, entries + count, n);
+
+	for (size_t i = 0; i < n;) {
+		size_t end = i + 1;
+
+		while (end < n && vfs_batch_order(&entries[i], &entries[end]) == 0) {
+			end++;
+		}
+
+		vfs_batch_group(&entries[i], end - i);
+
+		for (size_t j = i; j < end; j++) {
+			failed += entries[j].op->result != 0;
+		}
+
+		i = end;
+	}
+
+	free(entries);
+
+	return failed;
 }
 
 static int internal_vfs_list(struct ARC_VFSNode *node, int level, int org) {
@@ -638,12 +1476,12 @@ static int internal_vfs_list(struct ARC_VFSNode *node, int level, int org) {
 			printf("\t");
 		}
 		if (children->type != ARC_VFS_N_LINK) {
-			printf("%s (%s, %o, 0x%"PRIx64" B)\n", children->name, names[children->type], children->stat.st_mode, children->stat.st_size);
+			printf("%s (%s, %o, 0x%"PRIx64" B)\n", children->name, names[children->type], children->cold.stat.st_mode, children->cold.stat.st_size);
 		} else {
 			if (children->link == NULL) {
-				printf("%s (Broken Link, %o, 0x%"PRIx64" B) -/> NULL\n", children->name, children->stat.st_mode, children->stat.st_size);
+				printf("%s (Broken Link, %o, 0x%"PRIx64" B) -/> NULL\n", children->name, children->cold.stat.st_mode, children->cold.stat.st_size);
 			} else {
-				printf("%s (Link, %o, 0x%"PRIx64" B) -> %s\n", children->name, children->stat.st_mode, children->stat.st_size, children->link->name);
+				printf("%s (Link, %o, 0x%"PRIx64" B) -> %s\n", children->name, children->cold.stat.st_mode, children->cold.stat.st_size, children->link->name);
 			}
 		}
 
@@ -660,14 +1498,174 @@ int vfs_list(char *path, int recurse) {
 	}
 
 	struct ARC_VFSNode *node = NULL;
-	char *upto = vfs_traverse_filepath(path, vfs_get_starting_node(path), 1, &node);
+	int status = vfs_traverse_filepath(path, vfs_get_starting_node(NULL, path), 1, &node, NULL);
 
-	if (upto == NULL || *upto != 0) {
+	if (node == NULL) {
+		return -2;
+	}
+
+	if (status != ARC_VFS_PATH_RESOLVED) {
+		vfs_node_put(node);
 		return -2;
 	}
 
 	internal_vfs_list(node, recurse, recurse);
 
+	vfs_node_put(node);
+
+	return 0;
+}
+
+int vfs_opendir(char *path, struct ARC_VFSDir **ret) {
+	if (ret != NULL) {
+		*ret = NULL;
+	}
+
+	if (path == NULL || ret == NULL) {
+		return -1;
+	}
+
+	struct ARC_VFSNode *node = NULL;
+	int status = vfs_load_filepath(path, vfs_get_starting_node(NULL, path), 1, &node, NULL);
+
+	if (node == NULL) {
+		return -2;
+	}
+
+	if (status != ARC_VFS_PATH_RESOLVED) {
+		vfs_node_put(node);
+		return -3;
+	}
+
+	if (node->type != ARC_VFS_N_DIR && node->type != ARC_VFS_N_MOUNT && node->type != ARC_VFS_N_ROOT) {
+		ARC_DEBUG(ERR, "Cannot open %s, not a directory\n", path);
+		vfs_node_put(node);
+		return -4;
+	}
+
+	struct ARC_VFSDir *dir = (struct ARC_VFSDir *)alloc(sizeof(*dir));
+
+	if (dir == NULL) {
+		vfs_node_put(node);
+		return -5;
+	}
+
+	memset(dir, 0, sizeof(*dir));
+	dir->node = node;
+
+	// NOTE: Counted before the directory is loaded, whatever the idle node
+	//       cache evicts from then on is kept until vfs_closedir
+	ARC_ATOMIC_INC(node->cold.dir_cursors);
+	vfs_populate_node(node);
+
+	// Reference counter will be decremented by vfs_closedir
+	*ret = dir;
+
+	return 0;
+}
+
+// Find the child to resume from, the one after the last entry given out
+// NOTE: It is expected that the caller has locked the directory's branch_lock
+static struct ARC_VFSNode *vfs_readdir_resume(struct ARC_VFSDir *dir) {
+	struct ARC_VFSNode *node = dir->node;
+
+	if (dir->last_seq == 0) {
+		return node->children;
+	}
+
+	struct ARC_VFSNode *last = vfs_lookup_child(node, dir->last_name, dir->last_len);
+
+	if (last != NULL && last->cold.dir_seq == dir->last_seq) {
+		return last->next;
+	}
+
+	// The last entry was removed or renamed, everything that followed it
+	// has a smaller sequence number
+	struct ARC_VFSNode *child = node->children;
+
+	while (child != NULL && child->cold.dir_seq >= dir->last_seq) {
+		child = child->next;
+	}
+
+	return child;
+}
+
+int vfs_readdir(struct ARC_VFSDir *dir, void *buffer, size_t size) {
+	if (dir == NULL || buffer == NULL) {
+		return -1;
+	}
+
+	struct ARC_VFSNode *node = dir->node;
+	struct ARC_VFSNode *last = NULL;
+	size_t written = 0;
+
+	vfs_branch_lock_shared(node);
+
+	for (struct ARC_VFSNode *child = vfs_readdir_resume(dir); child != NULL; child = child->next) {
+		size_t name_len = child->name_len;
+		// Keep every record 8 byte aligned
+		size_t reclen = (sizeof(struct ARC_VFSDirent) + name_len + 1 + 7) & ~(size_t)7;
+
+		if (written + reclen > size) {
+			break;
+		}
+
+		struct ARC_VFSDirent *ent = (struct ARC_VFSDirent *)((uint8_t *)buffer + written);
+		ent->id = child->id;
+		ent->reclen = reclen;
+		ent->name_len = name_len;
+		ent->type = child->type;
+		memcpy(ent->name, child->name, name_len + 1);
+
+		written += reclen;
+		last = child;
+	}
+
+	int ret = (int)written;
+
+	if (last != NULL) {
+		size_t name_len = last->name_len;
+		// NOTE: If this fails the next batch resumes by sequence number alone
+		char *name = strndup(last->name, name_len);
+
+		free(dir->last_name);
+		dir->last_name = name;
+		dir->last_len = name == NULL ? 0 : name_len;
+		dir->last_seq = last->cold.dir_seq;
+	} else if (vfs_readdir_resume(dir) != NULL) {
+		// Not even the next entry fits
+		ret = -2;
+	}
+
+	vfs_branch_unlock_shared(node);
+
+	return ret;
+}
+
+void vfs_rewinddir(struct ARC_VFSDir *dir) {
+	if (dir == NULL) {
+		return;
+	}
+
+	free(dir->last_name);
+	dir->last_name = NULL;
+	dir->last_len = 0;
+	dir->last_seq = 0;
+
+	// NOTE: A no-op unless loading it in full failed before
+	vfs_populate_node(dir->node);
+}
+
+int vfs_closedir(struct ARC_VFSDir *dir) {
+	if (dir == NULL) {
+		return -1;
+	}
+
+	ARC_ATOMIC_DEC(dir->node->cold.dir_cursors);
+	vfs_node_put(dir->node);
+	free(dir->last_name);
+	free(dir);
+
 	return 0;
 }
 